@@ -21,6 +21,10 @@ public:
     }
 
     virtual GraphObject operator[](const VarId var_id) = 0;
+
+    // id of the value of `var_id`, only known by the bindings that materialize a BindingId (and the ones that
+    // forward to them). The others return ObjectId::get_not_found()
+    virtual ObjectId get_id(const VarId) { return ObjectId::get_not_found(); }
 };
 
 #endif // BASE__BINDING_H_
@@ -0,0 +1,92 @@
+/*
+ * BindingIdBatch holds many bindings (rows) of a BindingId, stored by column: the values of a variable in
+ * all the rows are consecutive, so operators can write a whole column in a loop (see BindingIdIter::next_batch).
+ *
+ * A batch is created for the BindingId that the iterators receive in `begin`, iterators read the values of
+ * the variables they don't assign from it. Memory for `max_capacity` rows is allocated once, the capacity
+ * can be lowered to make iterators return fewer rows per call (e.g. at the start of a query with LIMIT).
+ */
+
+#ifndef BASE__BINDING_ID_BATCH_H_
+#define BASE__BINDING_ID_BATCH_H_
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+#include "base/binding/binding_id.h"
+
+class BindingIdBatch {
+public:
+    static constexpr uint_fast32_t DEFAULT_CAPACITY = 1024;
+
+    BindingIdBatch(BindingId& binding, uint_fast32_t max_capacity = DEFAULT_CAPACITY) :
+        binding      (binding),
+        max_capacity (max_capacity),
+        capacity     (max_capacity),
+        size         (0),
+        columns      (binding.var_count() * max_capacity) { }
+
+    BindingIdBatch(const BindingIdBatch& other) = delete;
+
+    inline BindingId& get_binding() const noexcept { return binding; }
+
+    inline uint_fast32_t get_capacity() const noexcept { return capacity; }
+
+    inline void set_capacity(uint_fast32_t new_capacity) noexcept {
+        assert(new_capacity > 0);
+        capacity = std::min(new_capacity, max_capacity);
+    }
+
+    inline uint_fast32_t get_size() const noexcept { return size; }
+
+    inline void set_size(uint_fast32_t new_size) noexcept {
+        assert(new_size <= capacity);
+        size = new_size;
+    }
+
+    inline ObjectId* column(VarId var_id) noexcept {
+        return columns.data() + var_id.id * max_capacity;
+    }
+
+    inline const ObjectId* column(VarId var_id) const noexcept {
+        return columns.data() + var_id.id * max_capacity;
+    }
+
+    // writes the values of the binding in the rows [0, count) of every column
+    inline void fill_from_binding(uint_fast32_t count) noexcept {
+        for (std::size_t i = 0; i < binding.var_count(); i++) {
+            std::fill_n(column(VarId(i)), count, binding[VarId(i)]);
+        }
+    }
+
+    // writes the values of the binding in the row
+    inline void set_row(uint_fast32_t row, const BindingId& source) noexcept {
+        for (std::size_t i = 0; i < source.var_count(); i++) {
+            column(VarId(i))[row] = source[VarId(i)];
+        }
+    }
+
+    // writes the values of the row in the binding
+    inline void get_row(uint_fast32_t row, BindingId& target) const noexcept {
+        for (std::size_t i = 0; i < target.var_count(); i++) {
+            target.add(VarId(i), column(VarId(i))[row]);
+        }
+    }
+
+    // copies the row `other_row` of `other`, a batch of the same binding, into the row `row`
+    inline void copy_row(uint_fast32_t row, const BindingIdBatch& other, uint_fast32_t other_row) noexcept {
+        for (std::size_t i = 0; i < binding.var_count(); i++) {
+            column(VarId(i))[row] = other.column(VarId(i))[other_row];
+        }
+    }
+
+private:
+    BindingId& binding;
+    const uint_fast32_t max_capacity;
+    uint_fast32_t capacity;
+    uint_fast32_t size;
+    std::vector<ObjectId> columns;
+};
+
+#endif // BASE__BINDING_ID_BATCH_H_
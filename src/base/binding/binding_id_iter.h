@@ -4,6 +4,7 @@
 #include <ostream>
 
 #include "base/binding/binding_id.h"
+#include "base/binding/binding_id_batch.h"
 
 // Abstract class
 class BindingIdIter {
@@ -22,6 +23,31 @@ public:
     // It modifies the parent_binding to include the new results.
     virtual bool next() = 0;
 
+    // Writes the next binding_ids into the rows of `batch` (up to its capacity) and returns how many were
+    // written, 0 means there are no more and it must not be called again until reset.
+    // `batch` must be a batch of the parent_binding. Every variable of the binding is written in each row,
+    // afterwards the variables that the iter assigns have undefined values in the parent_binding.
+    // This implementation calls `next` for each row, iters that can produce many rows at once override it.
+    virtual uint_fast32_t next_batch(BindingIdBatch& batch) {
+        uint_fast32_t count = 0;
+        while (count < batch.get_capacity() && next()) {
+            batch.set_row(count, batch.get_binding());
+            count++;
+        }
+        batch.set_size(count);
+        return count;
+    }
+
+    // Divides the results the iter would return after a begin with `parent_binding` in at most `max_parts`
+    // parts, so copies of the iter can return them in different threads (see Exchange). Returns the number of
+    // parts, 1 means the iter can't be divided. Parts are in the order the iter returns its results
+    virtual uint_fast32_t split(BindingId& /*parent_binding*/, uint_fast32_t /*max_parts*/) {
+        return 1;
+    }
+
+    // The next begin or reset will only return the results of `part`, after a split returned more than 1 part
+    virtual void set_part(uint_fast32_t /*part*/) { }
+
     // Every var that the iter sets in the binding_id when it returns true is setted to null
     virtual void assign_nulls() = 0;
 
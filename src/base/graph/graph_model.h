@@ -50,6 +50,10 @@ public:
     virtual ObjectId get_object_id(const GraphObject&) const = 0;
     virtual GraphObject get_graph_object(ObjectId) const = 0;
     virtual GraphObject get_property_value(GraphObject& var, const ObjectId key) const = 0;
+
+    // true if the ids this returns true for have the same order as their objects, so they can be compared
+    // without get_graph_object
+    virtual bool is_ordered_id(ObjectId) const { return false; }
 };
 
 #endif // BASE__GRAPH_MODEL_H_
\ No newline at end of file
@@ -5,6 +5,12 @@
 
 class StringExternal {
 public:
+    // Databases created with sorted strings have their strings in a region of the object file, ordered by
+    // their bytes. Two strings inside [sorted_begin, sorted_end) are compared by their address.
+    // Both are nullptr when the database doesn't have sorted strings
+    static const char* sorted_begin;
+    static const char* sorted_end;
+
     char* id;
 
     StringExternal() = delete;
@@ -14,27 +20,40 @@ public:
     ~StringExternal() = default;
 
     inline bool operator==(const StringExternal& rhs) const noexcept {
-        return strcmp(this->id, rhs.id) == 0;
+        return compare(rhs) == 0;
     }
 
     inline bool operator!=(const StringExternal& rhs) const noexcept {
-        return strcmp(this->id, rhs.id) != 0;
+        return compare(rhs) != 0;
     }
 
     inline bool operator<=(const StringExternal& rhs) const noexcept {
-        return strcmp(this->id, rhs.id) <= 0;
+        return compare(rhs) <= 0;
     }
 
     inline bool operator>=(const StringExternal& rhs) const noexcept {
-        return strcmp(this->id, rhs.id) >= 0;
+        return compare(rhs) >= 0;
     }
 
     inline bool operator<(const StringExternal& rhs) const noexcept {
-        return strcmp(this->id, rhs.id) < 0;
+        return compare(rhs) < 0;
     }
 
     inline bool operator>(const StringExternal& rhs) const noexcept {
-        return strcmp(this->id, rhs.id) > 0;
+        return compare(rhs) > 0;
+    }
+
+private:
+    inline bool is_sorted() const noexcept {
+        return id >= sorted_begin && id < sorted_end;
+    }
+
+    // negative if this string goes before `rhs`, 0 if they are equal and positive otherwise
+    inline int compare(const StringExternal& rhs) const noexcept {
+        if (is_sorted() && rhs.is_sorted()) {
+            return (id > rhs.id) - (id < rhs.id);
+        }
+        return strcmp(this->id, rhs.id);
     }
 };
 
@@ -2,6 +2,7 @@
 #include <climits>
 #include <experimental/filesystem>
 #include <iostream>
+#include <thread>
 
 #include <boost/program_options.hpp>
 
@@ -12,6 +13,7 @@
 #include "relational_model/models/quad_model/import/bulk_import.h"
 #include "storage/buffer_manager.h"
 #include "storage/file_manager.h"
+#include "storage/index/object_file/object_file.h"
 
 using namespace std;
 namespace po = boost::program_options;
@@ -20,6 +22,9 @@ int main(int argc, char **argv) {
     string input_filename;
     string db_folder;
     int buffer_size;
+    int threads;
+    bool sorted_strings;
+    bool compress_objects;
 
 	try {
         // Parse arguments
@@ -30,6 +35,12 @@ int main(int argc, char **argv) {
             ("buffer-size,b", po::value<int>(&buffer_size)->default_value(BufferManager::DEFAULT_SHARED_BUFFER_POOL_SIZE),
                 "set buffer pool size")
             ("filename,f", po::value<string>(&input_filename)->required(), "import filename")
+            ("threads,t", po::value<int>(&threads)->default_value(max(1U, thread::hardware_concurrency())),
+                "set the number of threads used to create the indexes")
+            ("sorted-strings,", po::bool_switch(&sorted_strings),
+                "store the strings sorted so their ids have the same order")
+            ("compress-objects,", po::bool_switch(&compress_objects),
+                "compress the object file, objects can't be added to the database later")
         ;
 
         po::positional_options_description p;
@@ -52,6 +63,11 @@ int main(int argc, char **argv) {
             return 1;
         }
 
+        if (threads <= 0) {
+            cerr << "Threads must be a positive number.\n";
+            return 1;
+        }
+
         { // check db_folder is empty or does not exists
             namespace fs = std::experimental::filesystem;
             if (fs::exists(db_folder) && !fs::is_empty(db_folder)) {
@@ -63,7 +79,10 @@ int main(int argc, char **argv) {
         cout << "Creating new database\n";
         cout << "  input file:  " << input_filename << "\n";
         cout << "  db folder:   " << db_folder << "\n";
-        cout << "  buffer size: " << buffer_size << "\n\n";
+        cout << "  buffer size: " << buffer_size << "\n";
+        cout << "  threads:     " << threads << "\n";
+        cout << "  sorted strings: " << (sorted_strings ? "yes" : "no") << "\n";
+        cout << "  compress objects: " << (compress_objects ? "yes" : "no") << "\n\n";
 
         auto start = chrono::system_clock::now();
         cout << "Initializing system...\n";
@@ -76,10 +95,20 @@ int main(int argc, char **argv) {
             cout << "  done in " << model_duration.count() << " ms\n\n";
 
             // start the import
-            auto import = BulkImport(input_filename, model);
+            auto import = BulkImport(input_filename, model, threads, sorted_strings);
             import.start_import();
 
         }
+        if (compress_objects) {
+            namespace fs = std::experimental::filesystem;
+            cout << "Compressing the object file...\n";
+            auto object_file_path = db_folder + "/object_file.dat";
+            auto size = fs::file_size(object_file_path);
+            auto compressed_size = ObjectFile::compress(object_file_path,
+                                                        object_file_path + ObjectFile::COMPRESSED_SUFFIX);
+            fs::remove(object_file_path);
+            cout << "  " << size << " bytes compressed into " << compressed_size << " bytes\n\n";
+        }
         auto end = chrono::system_clock::now();
         chrono::duration<float, milli> duration = end - start;
         cout << "Total duration: " << duration.count() << " ms\n";
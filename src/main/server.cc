@@ -2,7 +2,7 @@
  * server is a executable that listens for tcp conections asking for queries,
  * and it send the results to the client.
  *
- * There are 5 methods:
+ * There are 6 methods:
  *
  * - main: parses the program options (e.g: buffer size, port, database folder).
  *   Then it creates the proper GraphModel and calls the method `server`.
@@ -16,9 +16,14 @@
  *
  * - session: read a query from the client, it parses the query, getting a logical
  *   plan and then a physical plan. Then it enumerates all results from the phisical plan,
- *   sending them to the client via TcpBuffer. It removes the ThreadKey from
+ *   sending them to the client via TcpBuffer. The execution statistics of the query and the buffer
+ *   statistics since the server started (and the object cache statistics, if it's enabled) are printed in
+ *   the console. It removes the ThreadKey from
  *   `running_threads` before ending.
  *
+ * - save_buffer_pages: saves periodically the list of pages in the shared buffer, so the next time the
+ *   server starts the buffer can be warmed up with them.
+ *
  * - execute_timeouts: it checks periodically the head of `running_threads_queue` to see
  *   if timeout should be thrown. If a timeout needs to be thrown, it will mark a boolean
  *   attribute and the physical plan is the responsable to check that attribute.
@@ -47,6 +52,7 @@
 #include "base/parser/logical_plan/op/op_select.h"
 #include "base/parser/query_parser.h"
 #include "base/thread/thread_key.h"
+#include "relational_model/execution/binding_id_iter/exchange.h"
 #include "relational_model/models/quad_model/quad_model.h"
 #include "storage/buffer_manager.h"
 #include "storage/file_manager.h"
@@ -65,6 +71,9 @@ std::queue<ThreadKey> running_threads_queue;
 std::unordered_map<ThreadKey, ThreadInfo, ThreadKeyHasher> running_threads;
 std::mutex running_threads_mutex;
 
+// its statistics are printed after each query, nullptr when the object cache is disabled
+const ObjectCache* object_cache = nullptr;
+
 
 void session(ThreadKey thread_key, ThreadInfo* thread_info, tcp::socket sock, GraphModel* model) {
     auto remove_thread_from_running_threads = [&]() {
@@ -127,6 +136,15 @@ void session(ThreadKey thread_key, ThreadInfo* thread_info, tcp::socket sock, Gr
             remove_thread_from_running_threads();
             return;
         }
+        catch (const std::runtime_error& e) {
+            std::cerr << "Unexpected error: " << e.what() << endl;
+            os << "---------------------------------------\n";
+            os << "Unexpected error: " << e.what() << "\n";
+            os << "---------------------------------------\n";
+            tcp_buffer.set_error(db_server::ErrorCode::unexpected_error);
+            remove_thread_from_running_threads();
+            return;
+        }
         chrono::duration<float, std::milli> parser_duration = chrono::system_clock::now() - start;
         uint64_t result_count = 0;
         try {
@@ -150,6 +168,12 @@ void session(ThreadKey thread_key, ThreadInfo* thread_info, tcp::socket sock, Gr
             cout << "\nPlan Executed:\n";
             physical_plan->analyze(cout, 2);
             cout << "\nResults:" << result_count << "\n";
+            cout << "\nBuffer since server start:\n";
+            buffer_manager.get_stats().print(cout, 2);
+            if (object_cache != nullptr) {
+                cout << "\nObject cache since server start:\n";
+                object_cache->get_stats().print(cout, 2);
+            }
 
             // write execution stats in output stream
             os << "---------------------------------------\n";
@@ -168,6 +192,17 @@ void session(ThreadKey thread_key, ThreadInfo* thread_info, tcp::socket sock, Gr
             os << "Query Parser/Optimizer time: " << parser_duration.count() << " ms.\n";
             tcp_buffer.set_error(db_server::ErrorCode::timeout);
         }
+        catch (const ConnectionException&) {
+            throw;
+        }
+        catch (const std::runtime_error& e) {
+            // e.g. a page that does not exist in a read-only file, the server keeps running
+            std::cerr << "Unexpected error: " << e.what() << endl;
+            os << "---------------------------------------\n";
+            os << "Unexpected error: " << e.what() << "\n";
+            os << "Found " << result_count << " results before the error.\n";
+            tcp_buffer.set_error(db_server::ErrorCode::unexpected_error);
+        }
     }
     catch (const ConnectionException& e) {
         std::cerr << "Lost connection with client: " << e.what() << endl;
@@ -215,6 +250,19 @@ void execute_timeouts(std::chrono::seconds timeout_duration) {
 }
 
 
+void save_buffer_pages(std::chrono::seconds interval) {
+    while (true) {
+        std::this_thread::sleep_for(interval);
+        try {
+            buffer_manager.save_page_list();
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Could not save the buffer pages: " << e.what() << endl;
+        }
+    }
+}
+
+
 void server(unsigned short port, GraphModel* model, std::chrono::seconds timeout_duration) {
     boost::asio::io_context io_context;
 
@@ -248,6 +296,17 @@ int main(int argc, char **argv) {
     int shared_buffer_size;
     int private_buffer_size;
     int max_threads;
+    int read_ahead_pages;
+    int save_buffer_interval;
+    int numa_node;
+    int dir_cache_levels;
+    int object_cache_size;
+    int leapfrog_threads;
+    int query_workers;
+    bool read_only;
+    string replacement_policy;
+    string huge_pages;
+    string numa_policy;
     string db_folder;
 
     try {
@@ -266,9 +325,63 @@ int main(int argc, char **argv) {
             (
                 "private-buffer-size,",
                 po::value<int>(&private_buffer_size)->default_value(BufferManager::DEFAULT_PRIVATE_BUFFER_POOL_SIZE),
-                "set private buffer pool size for each thread"
+                "set private buffer pool size for each thread, threads may borrow the pages other threads are not using"
             )
             ("max-threads,", po::value<int>(&max_threads)->default_value(8), "set max threads")
+            (
+                "read-only,",
+                po::bool_switch(&read_only),
+                "serve pages directly from memory-mapped files, the shared buffer is not allocated"
+            )
+            (
+                "read-ahead,",
+                po::value<int>(&read_ahead_pages)->default_value(BufferManager::DEFAULT_READ_AHEAD_PAGES),
+                "set how many leaf pages sequential scans read in advance, 0 disables it"
+            )
+            (
+                "save-buffer-interval,",
+                po::value<int>(&save_buffer_interval)->default_value(300),
+                "seconds between saves of the list of pages in the buffer, used to warm up the buffer at startup. 0 disables it"
+            )
+            (
+                "replacement-policy,",
+                po::value<string>(&replacement_policy)->default_value("gclock"),
+                "set the page replacement policy of the shared buffer: clock or gclock (scan-resistant)"
+            )
+            (
+                "huge-pages,",
+                po::value<string>(&huge_pages)->default_value("none"),
+                "back the buffers with huge pages: none, transparent, 2mb or 1gb (2mb and 1gb need reserved huge pages)"
+            )
+            (
+                "numa,",
+                po::value<string>(&numa_policy)->default_value("none"),
+                "set where the buffers are placed: none, interleave (all NUMA nodes) or bind (the node of --numa-node)"
+            )
+            ("numa-node,", po::value<int>(&numa_node)->default_value(0), "set the NUMA node used by --numa bind")
+            (
+                "dir-cache-levels,",
+                po::value<int>(&dir_cache_levels)->default_value(0),
+                "keep the first levels of the directory of every B+tree in memory, outside the buffer. 0 disables it"
+            )
+            (
+                "object-cache-size,",
+                po::value<int>(&object_cache_size)->default_value(0),
+                "set the MB of the cache of strings and identifiers materialized in the results. 0 disables it, "
+                "unless the object file is compressed (then it uses 64 MB)"
+            )
+            (
+                "leapfrog-threads,",
+                po::value<int>(&leapfrog_threads)->default_value(1),
+                "set the threads that run the leapfrog join of the pattern of a query, "
+                "1 runs it in the thread of the query"
+            )
+            (
+                "query-workers,",
+                po::value<int>(&query_workers)->default_value(0),
+                "set how many of the max threads are workers that queries borrow to scan the parts of their "
+                "outermost index scan in parallel, the rest run sessions. 0 disables it"
+            )
         ;
 
         po::positional_options_description p;
@@ -305,8 +418,81 @@ int main(int argc, char **argv) {
             return 1;
         }
 
+        if (read_ahead_pages < 0) {
+            cerr << "Read-ahead cannot be a negative number.\n";
+            return 1;
+        }
+
+        if (save_buffer_interval < 0) {
+            cerr << "Save buffer interval cannot be a negative number.\n";
+            return 1;
+        }
+
+        if (dir_cache_levels < 0) {
+            cerr << "Directory cache levels cannot be a negative number.\n";
+            return 1;
+        }
+
+        if (object_cache_size < 0) {
+            cerr << "Object cache size cannot be a negative number.\n";
+            return 1;
+        }
+
+        if (leapfrog_threads < 1) {
+            cerr << "Leapfrog threads must be at least 1.\n";
+            return 1;
+        }
+
+        if (query_workers < 0) {
+            cerr << "Query workers cannot be a negative number.\n";
+            return 1;
+        }
+
+        if (query_workers >= max_threads) {
+            cerr << "Query workers must be less than max threads.\n";
+            return 1;
+        }
+
+        if (replacement_policy != "clock" && replacement_policy != "gclock") {
+            cerr << "Replacement policy must be clock or gclock.\n";
+            return 1;
+        }
+
+        BufferMemoryOptions memory_options;
+        try {
+            memory_options.huge_pages  = BufferMemoryOptions::parse_huge_pages(huge_pages);
+            memory_options.numa_policy = BufferMemoryOptions::parse_numa_policy(numa_policy);
+            memory_options.numa_node   = numa_node;
+        } catch (const std::invalid_argument& e) {
+            cerr << e.what() << "\n";
+            return 1;
+        }
+
+        // each thread of a parallel leapfrog join has its own private buffer for its enumeration buffers.
+        // Query workers only scan indexes, they don't use private buffers
+        const int session_threads = max_threads - query_workers;
+        const int private_buffers = leapfrog_threads > 1 ? session_threads * (leapfrog_threads + 1)
+                                                         : session_threads;
+
         // Initialize model
-        QuadModel model(db_folder, shared_buffer_size, private_buffer_size, max_threads);
+        QuadModel model(db_folder, shared_buffer_size, private_buffer_size, private_buffers, read_only, memory_options);
+        model.leapfrog_threads = leapfrog_threads;
+        Exchange::set_max_workers(query_workers);
+        buffer_manager.set_replacement_policy(replacement_policy == "clock" ? ReplacementPolicy::CLOCK
+                                                                            : ReplacementPolicy::GCLOCK);
+        buffer_manager.start_read_ahead(read_ahead_pages);
+        if (dir_cache_levels > 0) {
+            auto cached_pages = model.cache_directories(dir_cache_levels);
+            cout << "Directory pages cached: " << cached_pages << "\n";
+        }
+        if (object_cache_size > 0) {
+            model.cache_objects(static_cast<uint64_t>(object_cache_size) * 1024 * 1024);
+        }
+        object_cache = model.object_cache.get();
+        buffer_manager.start_warm_up();
+        if (save_buffer_interval > 0) {
+            std::thread(save_buffer_pages, std::chrono::seconds(save_buffer_interval)).detach();
+        }
 
         cout << "Initializing server...\n";
         model.catalog().print();
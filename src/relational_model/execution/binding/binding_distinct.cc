@@ -15,3 +15,8 @@ std::ostream& BindingDistinct::print_to_ostream(std::ostream& os) const {
 GraphObject BindingDistinct::operator[](const VarId var) {
     return child_binding[var];
 }
+
+
+ObjectId BindingDistinct::get_id(const VarId var_id) {
+    return child_binding.get_id(var_id);
+}
@@ -15,6 +15,8 @@ public:
 
     GraphObject operator[](const VarId var_id) override;
 
+    ObjectId get_id(const VarId var_id) override;
+
 private:
     GraphModel& model;
     Binding& child_binding;
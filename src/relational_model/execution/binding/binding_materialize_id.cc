@@ -30,3 +30,8 @@ std::ostream& BindingMaterializeId::print_to_ostream(std::ostream& os) const {
 GraphObject BindingMaterializeId::operator[](const VarId var_id) {
     return model.get_graph_object(binding_id[var_id]);
 }
+
+
+ObjectId BindingMaterializeId::get_id(const VarId var_id) {
+    return binding_id[var_id];
+}
@@ -16,6 +16,8 @@ public:
 
     GraphObject operator[](const VarId var_id) override;
 
+    ObjectId get_id(const VarId var_id) override;
+
     void begin(BindingId&);
 
     void print_header(std::ostream&) const override { }
@@ -16,3 +16,8 @@ std::ostream& BindingWhere::print_to_ostream(std::ostream& os) const {
 GraphObject BindingWhere::operator[](VarId var_id) {
     return child_binding[var_id];
 }
+
+
+ObjectId BindingWhere::get_id(const VarId var_id) {
+    return child_binding.get_id(var_id);
+}
@@ -18,6 +18,8 @@ public:
 
     GraphObject operator[](const VarId var_id) override;
 
+    ObjectId get_id(const VarId var_id) override;
+
 private:
     const GraphModel& model;
     Binding& child_binding;
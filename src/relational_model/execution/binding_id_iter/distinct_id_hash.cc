@@ -36,6 +36,31 @@ bool DistinctIdHash::next() {
 }
 
 
+uint_fast32_t DistinctIdHash::next_batch(BindingIdBatch& batch) {
+    while (child_iter->next_batch(batch) > 0) {
+        // keep the distinct rows at the start of the batch
+        uint_fast32_t distinct = 0;
+        for (uint_fast32_t row = 0; row < batch.get_size(); row++) {
+            for (size_t i = 0; i < projected_vars.size(); i++) {
+                current_tuple[i] = batch.column(projected_vars[i])[row];
+            }
+            if (current_tuple_distinct()) {
+                if (distinct != row) {
+                    batch.copy_row(distinct, batch, row);
+                }
+                distinct++;
+            }
+        }
+        if (distinct > 0) {
+            batch.set_size(distinct);
+            return distinct;
+        }
+    }
+    batch.set_size(0);
+    return 0;
+}
+
+
 void DistinctIdHash::assign_nulls() {
     child_iter->assign_nulls();
 }
@@ -16,6 +16,7 @@ public:
     void begin(BindingId& parent_binding) override;
     void reset() override;
     bool next() override;
+    uint_fast32_t next_batch(BindingIdBatch& batch) override;
     void assign_nulls() override;
 
     void analyze(std::ostream&, int indent = 0) const override;
@@ -0,0 +1,338 @@
+#include "exchange.h"
+
+#include <algorithm>
+
+#include "storage/buffer_manager.h"
+
+using namespace std;
+
+std::atomic<uint_fast32_t> Exchange::available_workers(0);
+uint_fast32_t Exchange::max_workers = 0;
+
+Exchange::Exchange(vector<unique_ptr<BindingIdIter>> _pipelines,
+                   vector<VarId>                     _vars,
+                   bool                              _preserve_order) :
+    pipeline       (move(_pipelines[0])),
+    workers        (_pipelines.size() - 1),
+    vars           (move(_vars)),
+    preserve_order (_preserve_order),
+    next_part      (0),
+    stopping       (false)
+{
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i].pipeline = move(_pipelines[i + 1]);
+    }
+}
+
+
+Exchange::~Exchange() {
+    stop();
+}
+
+
+void Exchange::set_max_workers(uint_fast32_t workers) {
+    max_workers = workers;
+    available_workers = workers;
+}
+
+
+uint_fast32_t Exchange::get_max_workers() {
+    return max_workers;
+}
+
+
+uint_fast32_t Exchange::acquire_workers(uint_fast32_t wanted) {
+    auto available = available_workers.load();
+    uint_fast32_t acquired;
+    do {
+        acquired = std::min(wanted, available);
+    } while (acquired > 0 && !available_workers.compare_exchange_weak(available, available - acquired));
+    return acquired;
+}
+
+
+void Exchange::release_workers(uint_fast32_t workers) {
+    available_workers += workers;
+}
+
+
+void Exchange::begin(BindingId& _parent_binding) {
+    parent_binding = &_parent_binding;
+    for (auto& worker : workers) {
+        worker.binding = make_unique<BindingId>(parent_binding->var_count());
+    }
+    start();
+}
+
+
+void Exchange::reset() {
+    stop();
+    start();
+}
+
+
+void Exchange::start() {
+    next_part = 0;
+    stopping = false;
+    worker_error = nullptr;
+    queued_chunks = 0;
+    current_part = 0;
+    current_chunk.clear();
+    current_pos = 0;
+
+    // the pipeline is divided only if there are workers to run the parts
+    const auto acquired = acquire_workers(workers.size());
+    parts = 0;
+    for (uint_fast32_t i = 0; i < acquired; i++) {
+        workers[i].binding->add_all(*parent_binding);
+        parts = workers[i].pipeline->split(*workers[i].binding, acquired * PARTS_PER_WORKER);
+        if (parts <= 1) {
+            break;
+        }
+    }
+    started_workers = parts > 1 ? std::min<uint_fast32_t>(acquired, parts) : 0;
+    release_workers(acquired - started_workers);
+
+    if (started_workers == 0) {
+        if (pipeline_begun) {
+            pipeline->reset();
+        } else {
+            pipeline->begin(*parent_binding);
+            pipeline_begun = true;
+        }
+        return;
+    }
+
+    queues.clear();
+    queues.resize(preserve_order ? parts : 1);
+    finished_parts.assign(parts, false);
+    running_workers = started_workers;
+    for (uint_fast32_t i = 0; i < started_workers; i++) {
+        workers[i].thread = std::thread(&Exchange::run_worker, this, std::ref(workers[i]));
+    }
+}
+
+
+void Exchange::stop() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        stopping = true;
+    }
+    chunk_removed.notify_all();
+    for (auto& worker : workers) {
+        if (worker.thread.joinable()) {
+            worker.thread.join();
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        add_worker_buffer_stats();
+    }
+    release_workers(started_workers);
+    started_workers = 0;
+}
+
+
+void Exchange::add_worker_buffer_stats() {
+    buffer_manager.add_thread_stats(worker_buffer_stats);
+    worker_buffer_stats = BufferStats();
+}
+
+
+void Exchange::run_worker(Worker& worker) {
+    const auto row_size = parent_binding->var_count();
+    const auto buffer_stats_at_start = buffer_manager.get_thread_stats();
+    try {
+        BindingIdBatch batch(*worker.binding);
+        vector<ObjectId> chunk;
+        chunk.reserve(CHUNK_ROWS * row_size);
+
+        uint_fast32_t part;
+        while (!stopping && (part = next_part++) < parts) {
+            worker.pipeline->set_part(part);
+            if (worker.begun) {
+                worker.pipeline->reset();
+            } else {
+                worker.pipeline->begin(*worker.binding);
+                worker.begun = true;
+            }
+
+            uint_fast32_t count;
+            while (!stopping && (count = worker.pipeline->next_batch(batch)) > 0) {
+                for (uint_fast32_t row = 0; row < count; row++) {
+                    for (size_t i = 0; i < row_size; i++) {
+                        chunk.push_back(batch.column(VarId(i))[row]);
+                    }
+                }
+                if (chunk.size() >= CHUNK_ROWS * row_size) {
+                    push_chunk(part, move(chunk));
+                    chunk = vector<ObjectId>();
+                    chunk.reserve(CHUNK_ROWS * row_size);
+                }
+            }
+            // with preserve_order a chunk can't have results of 2 parts
+            if (preserve_order) {
+                if (!chunk.empty()) {
+                    push_chunk(part, move(chunk));
+                    chunk = vector<ObjectId>();
+                    chunk.reserve(CHUNK_ROWS * row_size);
+                }
+                finish_part(part);
+            }
+        }
+        if (!chunk.empty()) {
+            push_chunk(0, move(chunk));
+        }
+    } catch (...) {
+        // the error is thrown by the thread of the query, the other workers stop
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        if (worker_error == nullptr) {
+            worker_error = std::current_exception();
+        }
+        stopping = true;
+        chunk_removed.notify_all();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        worker_buffer_stats += buffer_manager.get_thread_stats() - buffer_stats_at_start;
+        running_workers--;
+    }
+    chunk_added.notify_one();
+}
+
+
+void Exchange::push_chunk(uint_fast32_t part, vector<ObjectId>&& chunk) {
+    const auto max_chunks = 2 * started_workers;
+    const auto queue = preserve_order ? part : 0;
+
+    std::unique_lock<std::mutex> lock(queue_mutex);
+    chunk_removed.wait(lock, [&] {
+        if (stopping) {
+            return true;
+        }
+        // the part being returned only waits for its own queue, the other parts may have filled the rest
+        if (preserve_order && part == current_part) {
+            return queues[queue].size() < max_chunks;
+        }
+        return queued_chunks < max_chunks;
+    });
+    if (stopping) {
+        return;
+    }
+    queues[queue].push_back(move(chunk));
+    queued_chunks++;
+    lock.unlock();
+    chunk_added.notify_one();
+}
+
+
+void Exchange::finish_part(uint_fast32_t part) {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        finished_parts[part] = true;
+    }
+    chunk_added.notify_one();
+}
+
+
+bool Exchange::pop_chunk() {
+    std::unique_lock<std::mutex> lock(queue_mutex);
+    while (true) {
+        if (worker_error != nullptr) {
+            std::rethrow_exception(worker_error);
+        }
+        if (preserve_order) {
+            if (current_part == parts) {
+                // the workers end after their last part, then their buffer counters are added
+                chunk_added.wait(lock, [&] { return running_workers == 0; });
+                add_worker_buffer_stats();
+                return false;
+            }
+            if (queues[current_part].empty() && finished_parts[current_part]) {
+                // the worker of the next part may be waiting for space
+                current_part++;
+                chunk_removed.notify_all();
+                continue;
+            }
+        } else if (queues[0].empty() && running_workers == 0) {
+            add_worker_buffer_stats();
+            return false;
+        }
+
+        auto& queue = queues[preserve_order ? current_part : 0];
+        if (!queue.empty()) {
+            current_chunk = move(queue.front());
+            queue.pop_front();
+            queued_chunks--;
+            current_pos = 0;
+            lock.unlock();
+            chunk_removed.notify_all();
+            return true;
+        }
+        chunk_added.wait(lock);
+    }
+}
+
+
+bool Exchange::next() {
+    if (started_workers == 0) {
+        return pipeline->next();
+    }
+    if (current_pos == current_chunk.size() && !pop_chunk()) {
+        return false;
+    }
+    for (size_t i = 0; i < parent_binding->var_count(); i++) {
+        parent_binding->add(VarId(i), current_chunk[current_pos++]);
+    }
+    results_found++;
+    return true;
+}
+
+
+uint_fast32_t Exchange::next_batch(BindingIdBatch& batch) {
+    if (started_workers == 0) {
+        return pipeline->next_batch(batch);
+    }
+    const auto capacity = batch.get_capacity();
+    const auto row_size = parent_binding->var_count();
+
+    uint_fast32_t count = 0;
+    while (count < capacity) {
+        if (current_pos == current_chunk.size() && !pop_chunk()) {
+            break;
+        }
+        const auto rows = std::min<size_t>(capacity - count, (current_chunk.size() - current_pos) / row_size);
+        for (size_t i = 0; i < row_size; i++) {
+            auto column = batch.column(VarId(i));
+            for (size_t r = 0; r < rows; r++) {
+                column[count + r] = current_chunk[current_pos + r*row_size + i];
+            }
+        }
+        current_pos += rows * row_size;
+        count += rows;
+    }
+    results_found += count;
+    batch.set_size(count);
+    return count;
+}
+
+
+void Exchange::assign_nulls() {
+    for (const auto& var : vars) {
+        parent_binding->add(var, ObjectId::get_null());
+    }
+}
+
+
+void Exchange::analyze(std::ostream& os, int indent) const {
+    os << std::string(indent, ' ');
+    os << "Exchange(workers: " << started_workers
+       << ", parts: " << parts
+       << ", preserve order: " << (preserve_order ? "yes" : "no")
+       << ", found: " << results_found << ",\n";
+    pipeline->analyze(os, indent + 2);
+    os << "\n";
+    os << std::string(indent, ' ');
+    os << ")";
+}
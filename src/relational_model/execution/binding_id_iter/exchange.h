@@ -0,0 +1,128 @@
+#ifndef RELATIONAL_MODEL__EXCHANGE_H_
+#define RELATIONAL_MODEL__EXCHANGE_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "base/binding/binding_id_iter.h"
+#include "base/ids/var_id.h"
+#include "storage/buffer_stats.h"
+
+/* Exchange runs copies of a pipeline (e.g. an IndexScan followed by IndexNestedLoopJoins) in many threads.
+ *
+ * At begin the pipeline is divided with BindingIdIter::split in up to PARTS_PER_WORKER parts per worker (an
+ * IndexScan uses the keys of the directory of its B+tree), and each worker runs its own copy of the pipeline
+ * on the next part when it finishes one, so workers that get expensive parts take fewer parts.
+ *
+ * Workers are borrowed from a budget shared by all the queries (see set_max_workers) and returned when the
+ * Exchange stops. When no worker is available or the pipeline can't be divided, the first copy runs in the
+ * thread of the query as if there were no Exchange.
+ *
+ * Workers write all the variables of their results in chunks of CHUNK_ROWS rows, which are given to the
+ * thread of the query through queues that hold at most 2 chunks per worker, so a query that stops early
+ * (e.g. with LIMIT) doesn't compute many results it won't use.
+ * Without `preserve_order` results are returned in any order. With `preserve_order` each part has its own
+ * queue and the parts are returned one after the other, in the order the pipeline would return them. The
+ * worker of the part being returned is the only one allowed to fill its queue when the others are full.
+ *
+ * The statistics printed by analyze are the ones of the copy that runs in the thread of the query. The buffer
+ * counters of each worker are added to the ones of the thread of the query when the worker ends, so the pages
+ * read by the workers are included in the buffer statistics of the query.
+ */
+class Exchange : public BindingIdIter {
+public:
+    static constexpr uint_fast32_t PARTS_PER_WORKER = 8;
+    static constexpr uint_fast32_t CHUNK_ROWS       = 1024;
+
+    // `pipelines` are copies of the same iter, the first one is used when the Exchange runs in the thread of
+    // the query and the rest by the workers. `vars` are the variables the pipeline assigns
+    Exchange(std::vector<std::unique_ptr<BindingIdIter>> pipelines,
+             std::vector<VarId>                          vars,
+             bool                                        preserve_order);
+    ~Exchange();
+
+    // sets how many workers the queries can be using at the same time, must be called before any query starts
+    static void set_max_workers(uint_fast32_t workers);
+
+    static uint_fast32_t get_max_workers();
+
+    // borrows up to `wanted` workers from the budget, returns how many it got. Other operators borrow workers
+    // from the same budget to run threads of their own (e.g. to build a hash table)
+    static uint_fast32_t acquire_workers(uint_fast32_t wanted);
+
+    static void release_workers(uint_fast32_t workers);
+
+    void analyze(std::ostream& os, int indent = 0) const override;
+    void begin(BindingId& parent_binding) override;
+    bool next() override;
+    uint_fast32_t next_batch(BindingIdBatch& batch) override;
+    void reset() override;
+    void assign_nulls() override;
+
+private:
+    struct Worker {
+        std::unique_ptr<BindingIdIter> pipeline;
+        std::unique_ptr<BindingId> binding;
+        std::thread thread;
+        bool begun = false; // the pipeline is reset for the next parts
+    };
+
+    // workers not borrowed by any query
+    static std::atomic<uint_fast32_t> available_workers;
+    static uint_fast32_t max_workers;
+
+    std::unique_ptr<BindingIdIter> pipeline; // runs in the thread of the query
+    std::vector<Worker> workers;
+    const std::vector<VarId> vars;
+    const bool preserve_order;
+
+    BindingId* parent_binding;
+    bool pipeline_begun = false;
+
+    // workers borrowed, 0 when the pipeline runs in the thread of the query
+    uint_fast32_t started_workers = 0;
+    uint_fast32_t parts = 0;
+    std::atomic<uint_fast32_t> next_part;
+
+    // protects the queues and the state of the workers
+    std::mutex queue_mutex;
+    std::condition_variable chunk_added;   // the query thread waits for chunks
+    std::condition_variable chunk_removed; // workers wait for space in the queues
+    std::vector<std::deque<std::vector<ObjectId>>> queues; // one per part with preserve_order, else just one
+    std::vector<bool> finished_parts;
+    uint_fast32_t queued_chunks = 0;
+    uint_fast32_t current_part = 0; // part being returned with preserve_order
+    uint_fast32_t running_workers = 0;
+    std::atomic<bool> stopping; // only changed with queue_mutex locked
+    std::exception_ptr worker_error;
+    BufferStats worker_buffer_stats; // of the workers that ended, not yet added to the thread of the query
+
+    // chunk being returned by the query thread
+    std::vector<ObjectId> current_chunk;
+    std::size_t current_pos = 0;
+
+    uint64_t results_found = 0;
+
+    void start();
+    void stop();
+    void run_worker(Worker& worker);
+
+    // waits for space in the queue of `part`, the chunk is discarded if the workers are stopping
+    void push_chunk(uint_fast32_t part, std::vector<ObjectId>&& chunk);
+
+    void finish_part(uint_fast32_t part);
+
+    // takes the next chunk, returns false when there are no more
+    bool pop_chunk();
+
+    // adds `worker_buffer_stats` to the buffer counters of the calling thread. `queue_mutex` must be locked
+    void add_worker_buffer_stats();
+};
+
+#endif // RELATIONAL_MODEL__EXCHANGE_H_
@@ -1,5 +1,7 @@
 #include "hash_join_grace.h"
 
+#include <algorithm>
+
 #include "base/ids/var_id.h"
 
 using namespace std;
@@ -15,7 +17,9 @@ HashJoinGrace::HashJoinGrace(unique_ptr<BindingIdIter> lhs,
     common_vars (common_vars),
     right_vars  (right_vars),
     lhs_hash    (KeyValueHash<ObjectId, ObjectId>(common_vars.size(), left_vars.size())),
-    rhs_hash    (KeyValueHash<ObjectId, ObjectId>(common_vars.size(), right_vars.size()))
+    rhs_hash    (KeyValueHash<ObjectId, ObjectId>(common_vars.size(), right_vars.size())),
+    left_small_hash  (common_vars.size(), left_vars.size()),
+    right_small_hash (common_vars.size(), right_vars.size())
     { }
 
 
@@ -25,31 +29,16 @@ void HashJoinGrace::begin(BindingId& _parent_binding) {
     lhs->begin(_parent_binding);
     rhs->begin(_parent_binding);
 
+    child_batch = make_unique<BindingIdBatch>(_parent_binding);
+
     saved_pair = make_pair(vector<ObjectId>(common_vars.size()), vector<ObjectId>(left_vars.size()));
     lhs_hash.begin();
-    while (lhs->next()){
-        // save left keys and value
-        for (size_t i = 0; i < common_vars.size(); i++) {
-            saved_pair.first[i] = (*parent_binding)[common_vars[i]];
-        }
-        for (size_t i = 0; i < left_vars.size(); i++) {
-            saved_pair.second[i] = (*parent_binding)[left_vars[i]];
-        }
-        lhs_hash.insert(saved_pair.first, saved_pair.second);
-    }
+    insert_all(*lhs, left_vars, lhs_hash);
     // recycle current_value for saving right hash
     saved_pair.second.resize(right_vars.size());
     auto left_depth = lhs_hash.get_depth();
     rhs_hash.begin(left_depth);
-    while (rhs->next()) {
-        for (size_t i = 0; i < common_vars.size(); i++) {
-            saved_pair.first[i] = (*parent_binding)[common_vars[i]];
-        }
-        for (size_t i = 0; i < right_vars.size(); i++) {
-            saved_pair.second[i] = (*parent_binding)[right_vars[i]];
-        }
-        rhs_hash.insert(saved_pair.first, saved_pair.second);
-    }
+    insert_all(*rhs, right_vars, rhs_hash);
     auto right_depth = rhs_hash.get_depth();
     // split if different size
     while (right_depth > left_depth) {
@@ -70,15 +59,16 @@ bool HashJoinGrace::next() {
         switch (current_state)
         {
             case State::ENUM_WITH_SECOND_HASH_ITER: {
-                assert(current_pair_iter != end_range_iter);
+                assert(current_match_pos < current_match.count);
+                const auto value = current_match.values + current_match_pos * small_hash->get_value_size();
                 if (left_min) {
-                    assign_left_binding((*current_pair_iter).second);
+                    assign_left_binding(value);
                 }
                 else {
-                    assign_right_binding((*current_pair_iter).second);
+                    assign_right_binding(value);
                 }
-                ++current_pair_iter;
-                if (current_pair_iter == end_range_iter) {
+                ++current_match_pos;
+                if (current_match_pos == current_match.count) {
                     current_state = State::ENUM_WITH_SECOND_HASH;
                 }
                 return true;
@@ -89,15 +79,14 @@ bool HashJoinGrace::next() {
                     while (current_pos_right < rhs_hash.get_bucket_size(current_bucket)) {
                         saved_pair = rhs_hash.get_pair(current_bucket, current_pos_right);
                         current_pos_right++;  // after get pair and before posible return
-                        auto range = small_hash.equal_range(saved_pair.first);
-                        current_pair_iter = range.first;
-                        end_range_iter    = range.second;
+                        current_match = small_hash->find(saved_pair.first.data());
+                        current_match_pos = 0;
 
-                        if (current_pair_iter != end_range_iter) {
+                        if (current_match.count > 0) {
                             current_state = State::ENUM_WITH_SECOND_HASH_ITER;
                             //assign right pair, saved key
-                            assign_right_binding(saved_pair.second);
-                            assign_key_binding(saved_pair.first);
+                            assign_right_binding(saved_pair.second.data());
+                            assign_key_binding(saved_pair.first.data());
                             break;
                         }
                     }
@@ -107,15 +96,14 @@ bool HashJoinGrace::next() {
                     while (current_pos_left < lhs_hash.get_bucket_size(current_bucket)) {
                         saved_pair = lhs_hash.get_pair(current_bucket, current_pos_left);
                         current_pos_left++;  // after get pair and before posible return
-                        auto range = small_hash.equal_range(saved_pair.first);
-                        current_pair_iter = range.first;
-                        end_range_iter    = range.second;
+                        current_match = small_hash->find(saved_pair.first.data());
+                        current_match_pos = 0;
 
-                        if (current_pair_iter != end_range_iter) {
+                        if (current_match.count > 0) {
                             current_state = State::ENUM_WITH_SECOND_HASH_ITER;
                             // assign left pair, saved key
-                            assign_left_binding(saved_pair.second);
-                            assign_key_binding(saved_pair.first);
+                            assign_left_binding(saved_pair.second.data());
+                            assign_key_binding(saved_pair.first.data());
                             break;
                         }
                     }
@@ -188,12 +176,8 @@ bool HashJoinGrace::next() {
                         //if (false) {
                         if (left_size < MAX_SIZE_SMALL_HASH) {
                             // Add lhs results to small hash
-                            small_hash.clear();
-                            while (current_pos_left < lhs_hash.get_bucket_size(current_bucket)) {
-                                auto pair = lhs_hash.get_pair(current_bucket, current_pos_left);
-                                small_hash.insert(pair);
-                                current_pos_left++;
-                            }
+                            build_small_hash(lhs_hash, left_small_hash);
+                            small_hash = &left_small_hash;
                             current_state = State::ENUM_WITH_SECOND_HASH;
                         }
                         else {
@@ -204,13 +188,9 @@ bool HashJoinGrace::next() {
                     else {
                         // if (false) {
                         if (right_size < MAX_SIZE_SMALL_HASH) {
-                            // Add lhs results to small hash
-                            small_hash.clear();
-                            while (current_pos_right < rhs_hash.get_bucket_size(current_bucket)) {
-                                auto pair = rhs_hash.get_pair(current_bucket, current_pos_right);
-                                small_hash.insert(pair);
-                                current_pos_right++;
-                            }
+                            // Add rhs results to small hash
+                            build_small_hash(rhs_hash, right_small_hash);
+                            small_hash = &right_small_hash;
                             current_state = State::ENUM_WITH_SECOND_HASH;
                         }
                         else {
@@ -230,19 +210,49 @@ bool HashJoinGrace::next() {
 }
 
 
-void HashJoinGrace::assign_left_binding(const vector<ObjectId>& left_value) {
+void HashJoinGrace::insert_all(BindingIdIter& child,
+                               const vector<VarId>& value_vars,
+                               KeyValueHash<ObjectId, ObjectId>& hash) {
+    while (child.next_batch(*child_batch) > 0) {
+        for (uint_fast32_t row = 0; row < child_batch->get_size(); row++) {
+            for (size_t i = 0; i < common_vars.size(); i++) {
+                saved_pair.first[i] = child_batch->column(common_vars[i])[row];
+            }
+            for (size_t i = 0; i < value_vars.size(); i++) {
+                saved_pair.second[i] = child_batch->column(value_vars[i])[row];
+            }
+            hash.insert(saved_pair.first, saved_pair.second);
+        }
+    }
+}
+
+
+void HashJoinGrace::build_small_hash(KeyValueHash<ObjectId, ObjectId>& hash, JoinHashTable& table) {
+    table.clear();
+    const auto bucket_size = hash.get_bucket_size(current_bucket);
+    for (uint_fast32_t pos = 0; pos < bucket_size; pos++) {
+        auto pair = hash.get_pair(current_bucket, pos);
+        auto tuple = table.new_row();
+        std::copy(pair.first.begin(), pair.first.end(), tuple);
+        std::copy(pair.second.begin(), pair.second.end(), tuple + pair.first.size());
+    }
+    table.build();
+}
+
+
+void HashJoinGrace::assign_left_binding(const ObjectId* left_value) {
     for (uint_fast32_t i = 0; i < left_vars.size(); i++) {
         parent_binding->add(left_vars[i], left_value[i]);
     }
 }
 
-void HashJoinGrace::assign_right_binding(const vector<ObjectId>& right_value) {
+void HashJoinGrace::assign_right_binding(const ObjectId* right_value) {
     for (uint_fast32_t i = 0; i < right_vars.size(); i++) {
         parent_binding->add(right_vars[i], right_value[i]);
     }
 }
 
-void HashJoinGrace::assign_key_binding(const vector<ObjectId>& my_key) {
+void HashJoinGrace::assign_key_binding(const ObjectId* my_key) {
     for (uint_fast32_t i = 0; i < common_vars.size(); i++) {
         parent_binding->add(common_vars[i], my_key[i]);
     }
@@ -256,27 +266,11 @@ void HashJoinGrace::reset() {
 
     saved_pair.second.resize(left_vars.size());
     lhs_hash.reset();
-    while (lhs->next()) {
-        for (size_t i = 0; i < common_vars.size(); i++) {
-            saved_pair.first[i] = (*parent_binding)[common_vars[i]];
-        }
-        for (size_t i = 0; i < left_vars.size(); i++) {
-            saved_pair.second[i] = (*parent_binding)[left_vars[i]];
-        }
-        lhs_hash.insert(saved_pair.first, saved_pair.second);
-    }
+    insert_all(*lhs, left_vars, lhs_hash);
     auto left_depth = lhs_hash.get_depth();
     rhs_hash.reset(left_depth);
     saved_pair.second.resize(right_vars.size());
-    while (rhs->next()) {
-        for (size_t i = 0; i < common_vars.size(); i++) {
-            saved_pair.first[i] = (*parent_binding)[common_vars[i]];
-        }
-        for (size_t i = 0; i < right_vars.size(); i++) {
-            saved_pair.second[i] = (*parent_binding)[right_vars[i]];
-        }
-        rhs_hash.insert(saved_pair.first, saved_pair.second);
-    }
+    insert_all(*rhs, right_vars, rhs_hash);
     auto right_depth = rhs_hash.get_depth();
     // split if different size
     while (right_depth > left_depth) {
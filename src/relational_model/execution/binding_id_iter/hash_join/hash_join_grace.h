@@ -3,11 +3,10 @@
 
 #include <memory>
 #include <vector>
-#include <unordered_map>
 
 #include "base/ids/var_id.h"
 #include "base/binding/binding_id_iter.h"
-#include "relational_model/execution/binding_id_iter/hash_join/key_value_pair_hasher.h"
+#include "relational_model/execution/binding_id_iter/hash_join/join_hash_table.h"
 #include "storage/index/hash/key_value_hash/key_value_hash.h"
 #include "storage/index/hash/hash_functions/hash_function_wrapper.h"
 #include "storage/page.h"
@@ -63,27 +62,38 @@ private:
 
     State current_state = State::NOT_ENUM;
     bool left_min = false;
-    std::unordered_multimap<std::vector<ObjectId>,
-                            std::vector<ObjectId>,
-                            KeyValuePairHasher2> small_hash;
+
+    // rows of the smaller side of the current bucket, when it is smaller than MAX_SIZE_SMALL_HASH
+    JoinHashTable left_small_hash;
+    JoinHashTable right_small_hash;
+    JoinHashTable* small_hash;
 
     uint_fast32_t current_pos_left;   // for nested loop
     uint_fast32_t current_pos_right;
     uint_fast32_t current_bucket;
-    std::unordered_multimap<std::vector<ObjectId>,
-                            std::vector<ObjectId>,
-                            KeyValuePairHasher2>::iterator current_pair_iter;  // for small hash
-    std::unordered_multimap<std::vector<ObjectId>,
-                            std::vector<ObjectId>,
-                            KeyValuePairHasher2>::iterator end_range_iter;
+
+    // rows of the small hash with the current key, and the next one to return
+    JoinHashTable::Match current_match;
+    uint_fast32_t current_match_pos;
 
     //std::vector<ObjectId> current_key;
     //std::vector<ObjectId> current_value;
     std::pair<std::vector<ObjectId>, std::vector<ObjectId>> saved_pair;
 
-    void assign_left_binding(const std::vector<ObjectId>& lhs_value);
-    void assign_key_binding(const std::vector<ObjectId>& my_key);
-    void assign_right_binding(const std::vector<ObjectId>& rhs_value);
+    // the children are read in batches when the hashes are built
+    std::unique_ptr<BindingIdBatch> child_batch;
+
+    // inserts the keys and the values of `value_vars` of all the results of `child` in `hash`
+    void insert_all(BindingIdIter& child,
+                    const std::vector<VarId>& value_vars,
+                    KeyValueHash<ObjectId, ObjectId>& hash);
+
+    void assign_left_binding(const ObjectId* lhs_value);
+    void assign_key_binding(const ObjectId* my_key);
+    void assign_right_binding(const ObjectId* rhs_value);
+
+    // copies the rows of the current bucket of `hash` to `table` and builds it
+    void build_small_hash(KeyValueHash<ObjectId, ObjectId>& hash, JoinHashTable& table);
 };
 
 #endif // RELATIONAL_MODEL__HASH_JOIN_GRACE_H_
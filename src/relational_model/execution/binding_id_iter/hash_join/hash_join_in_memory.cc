@@ -1,6 +1,7 @@
 #include "hash_join_in_memory.h"
 
 #include "base/ids/var_id.h"
+#include "relational_model/execution/binding_id_iter/exchange.h"
 
 using namespace std;
 
@@ -13,7 +14,8 @@ HashJoinInMemory::HashJoinInMemory(unique_ptr<BindingIdIter> lhs,
     rhs         (move(rhs)),
     left_vars   (left_vars),
     common_vars (common_vars),
-    right_vars  (right_vars)
+    right_vars  (right_vars),
+    lhs_hash    (common_vars.size(), left_vars.size())
     { }
 
 
@@ -23,24 +25,47 @@ void HashJoinInMemory::begin(BindingId& _parent_binding) {
     lhs->begin(_parent_binding);
     rhs->begin(_parent_binding);
 
+    child_batch = make_unique<BindingIdBatch>(_parent_binding);
     current_key = std::vector<ObjectId>(common_vars.size());
-    current_value = std::vector<ObjectId>(left_vars.size());
-    while (lhs->next()) {
-        // save left keys and value
-        for (size_t i = 0; i < common_vars.size(); i++) {
-            current_key[i] = (*parent_binding)[common_vars[i]];
-        }
-        for (size_t i = 0; i < left_vars.size(); i++) {
-            current_value[i] = (*parent_binding)[left_vars[i]];
+    current_value = std::vector<ObjectId>(right_vars.size());
+    build_lhs_hash();
+}
+
+
+void HashJoinInMemory::build_lhs_hash() {
+    lhs_hash.clear();
+
+    child_batch->set_capacity(BindingIdBatch::DEFAULT_CAPACITY);
+    while (lhs->next_batch(*child_batch) > 0) {
+        for (uint_fast32_t row = 0; row < child_batch->get_size(); row++) {
+            // save left keys and value
+            auto tuple = lhs_hash.new_row();
+            for (size_t i = 0; i < common_vars.size(); i++) {
+                tuple[i] = child_batch->column(common_vars[i])[row];
+            }
+            tuple += common_vars.size();
+            for (size_t i = 0; i < left_vars.size(); i++) {
+                tuple[i] = child_batch->column(left_vars[i])[row];
+            }
         }
-        lhs_hash.insert(std::make_pair(current_key, current_value));
     }
 
-    current_value.resize(right_vars.size());
-    // saved_pair = make_pair(current_key, current_value);  // init sizes
+    // big tables are built with the help of the query workers that are free
+    const auto workers = Exchange::acquire_workers(lhs_hash.max_build_threads() - 1);
+    try {
+        lhs_hash.build(workers + 1);
+    } catch (...) {
+        Exchange::release_workers(workers);
+        throw;
+    }
+    Exchange::release_workers(workers);
+
+    child_batch->set_size(0);
+    child_row    = 0;
+    rhs_finished = false;
 
-    current_pair_iter = lhs_hash.end();
-    end_range_iter = lhs_hash.end();
+    current_match     = JoinHashTable::Match { nullptr, 0 };
+    current_match_pos = 0;
     enumerating = false;
 }
 
@@ -48,13 +73,14 @@ void HashJoinInMemory::begin(BindingId& _parent_binding) {
 bool HashJoinInMemory::next() {
     while (true) {
         if (enumerating) {
-            assert(current_pair_iter != end_range_iter);
+            assert(current_match_pos < current_match.count);
             // set binding from lhs
+            const auto left_value = current_match.values + current_match_pos * left_vars.size();
             for (uint_fast32_t i = 0; i < left_vars.size(); i++) {
-                parent_binding->add(left_vars[i], current_pair_iter->second[i]);
+                parent_binding->add(left_vars[i], left_value[i]);
             }
-            ++current_pair_iter;
-            if (current_pair_iter == end_range_iter) {
+            ++current_match_pos;
+            if (current_match_pos == current_match.count) {
                 enumerating = false;
             }
             return true;
@@ -67,10 +93,9 @@ bool HashJoinInMemory::next() {
                 for (size_t i = 0; i < right_vars.size(); i++) {
                     current_value[i] = (*parent_binding)[right_vars[i]];
                 }
-                auto range = lhs_hash.equal_range(current_key);
-                current_pair_iter = range.first;
-                end_range_iter = range.second;
-                if (current_pair_iter != end_range_iter) {
+                current_match = lhs_hash.find(current_key.data());
+                current_match_pos = 0;
+                if (current_match.count > 0) {
                     // set binding from rhs
                     for (uint_fast32_t i = 0; i < common_vars.size(); i++) {
                         parent_binding->add(common_vars[i], current_key[i]);
@@ -89,28 +114,67 @@ bool HashJoinInMemory::next() {
 }
 
 
-void HashJoinInMemory::reset() {
-    lhs->reset();
-    rhs->reset();
+uint_fast32_t HashJoinInMemory::next_batch(BindingIdBatch& batch) {
+    switch (common_vars.size()) {
+        case 1:  return next_batch_with_key_size<1>(batch);
+        case 2:  return next_batch_with_key_size<2>(batch);
+        case 3:  return next_batch_with_key_size<3>(batch);
+        case 4:  return next_batch_with_key_size<4>(batch);
+        default: return next_batch_with_key_size<0>(batch);
+    }
+}
 
-    current_value = std::vector<ObjectId>(left_vars.size());
-    lhs_hash.clear();
-    while (lhs->next()){
-        // save left keys and value
-        for (size_t i = 0; i < common_vars.size(); i++) {
-            current_key[i] = (*parent_binding)[common_vars[i]];
+
+template <std::size_t K>
+uint_fast32_t HashJoinInMemory::next_batch_with_key_size(BindingIdBatch& batch) {
+    const auto capacity = batch.get_capacity();
+    uint_fast32_t count = 0;
+    while (count < capacity) {
+        if (enumerating) {
+            // the row of rhs with the values of a matching row of lhs
+            batch.copy_row(count, *child_batch, child_row);
+            const auto left_value = current_match.values + current_match_pos * left_vars.size();
+            for (uint_fast32_t i = 0; i < left_vars.size(); i++) {
+                batch.column(left_vars[i])[count] = left_value[i];
+            }
+            count++;
+            ++current_match_pos;
+            if (current_match_pos == current_match.count) {
+                enumerating = false;
+                child_row++;
+            }
+        }
+        else if (child_row < child_batch->get_size()) {
+            for (size_t i = 0; i < common_vars.size(); i++) {
+                current_key[i] = child_batch->column(common_vars[i])[child_row];
+            }
+            current_match = lhs_hash.find<K>(current_key.data());
+            current_match_pos = 0;
+            if (current_match.count > 0) {
+                enumerating = true;
+            } else {
+                child_row++;
+            }
         }
-        for (size_t i = 0; i < left_vars.size(); i++) {
-            current_value[i] = (*parent_binding)[left_vars[i]];
+        else if (!rhs_finished) {
+            // rows of rhs are read in batches of the same size
+            child_batch->set_capacity(capacity);
+            rhs_finished = rhs->next_batch(*child_batch) == 0;
+            child_row = 0;
+        }
+        else {
+            break;
         }
-        lhs_hash.insert(std::make_pair(current_key, current_value));
     }
+    batch.set_size(count);
+    return count;
+}
 
-    current_value = std::vector<ObjectId>(right_vars.size());
 
-    current_pair_iter = lhs_hash.end();
-    end_range_iter = lhs_hash.end();
-    enumerating = false;
+void HashJoinInMemory::reset() {
+    lhs->reset();
+    rhs->reset();
+    build_lhs_hash();
 }
 
 
@@ -122,7 +186,7 @@ void HashJoinInMemory::assign_nulls() {
 
 void HashJoinInMemory::analyze(std::ostream& os, int indent) const {
     os << std::string(indent, ' ');
-    os << "HashJoinInMemoryInMemory(\n";
+    os << "HashJoinInMemory(rows: " << lhs_hash.size() << ", bytes: " << lhs_hash.get_bytes() << ",\n";
     lhs->analyze(os, indent + 2);
     os << ",\n";
     rhs->analyze(os, indent + 2);
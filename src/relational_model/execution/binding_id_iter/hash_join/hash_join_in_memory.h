@@ -3,11 +3,10 @@
 
 #include <memory>
 #include <vector>
-#include <unordered_map>
 
 #include "base/ids/var_id.h"
 #include "base/binding/binding_id_iter.h"
-#include "relational_model/execution/binding_id_iter/hash_join/key_value_pair_hasher.h"
+#include "relational_model/execution/binding_id_iter/hash_join/join_hash_table.h"
 
 
 class HashJoinInMemory : public BindingIdIter {
@@ -22,6 +21,7 @@ public:
     void analyze(std::ostream& os, int indent = 0) const override;
     void begin(BindingId& parent_binding) override;
     bool next() override;
+    uint_fast32_t next_batch(BindingIdBatch& batch) override;
     void reset() override;
     void assign_nulls() override;
 
@@ -35,18 +35,25 @@ private:
     BindingId* parent_binding;
 
     bool enumerating;
-    std::unordered_multimap<std::vector<ObjectId>,
-                            std::vector<ObjectId>,
-                            KeyValuePairHasher> lhs_hash;  // asume left is the smallest one (from execution plan)
-    std::unordered_multimap<std::vector<ObjectId>,
-                            std::vector<ObjectId>,
-                            KeyValuePairHasher>::iterator current_pair_iter;
-    std::unordered_multimap<std::vector<ObjectId>,
-                            std::vector<ObjectId>,
-                            KeyValuePairHasher>::iterator end_range_iter;
+    JoinHashTable lhs_hash; // asume left is the smallest one (from execution plan)
+
+    // rows of lhs with the current key, and the next one to return
+    JoinHashTable::Match current_match;
+    uint_fast32_t current_match_pos;
 
     std::vector<ObjectId> current_key;
     std::vector<ObjectId> current_value;
+
+    // rows of lhs when the hash is built, then rows of rhs for next_batch
+    std::unique_ptr<BindingIdBatch> child_batch;
+    uint_fast32_t child_row;
+    bool rhs_finished;
+
+    void build_lhs_hash();
+
+    // next_batch with the probes specialized for keys of K ids (0 is any size)
+    template <std::size_t K>
+    uint_fast32_t next_batch_with_key_size(BindingIdBatch& batch);
 };
 
 #endif // RELATIONAL_MODEL__HASH_JOIN_IN_MEMORY_H_
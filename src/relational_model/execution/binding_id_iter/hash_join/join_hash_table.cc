@@ -0,0 +1,223 @@
+#include "join_hash_table.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+using namespace std;
+
+namespace {
+
+// calls `work(thread)` for each thread in [0, threads), the thread 0 is the calling thread.
+// The first exception thrown is thrown again after all the threads end
+template <class Work>
+void run_in_threads(uint_fast32_t threads, Work work) {
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    auto run = [&](uint_fast32_t thread) {
+        try {
+            work(thread);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (error == nullptr) {
+                error = std::current_exception();
+            }
+        }
+    };
+
+    vector<std::thread> workers;
+    for (uint_fast32_t thread = 1; thread < threads; thread++) {
+        workers.emplace_back(run, thread);
+    }
+    run(0);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    if (error != nullptr) {
+        std::rethrow_exception(error);
+    }
+}
+
+} // namespace
+
+
+JoinHashTable::JoinHashTable(std::size_t key_size, std::size_t value_size) :
+    key_size   (key_size),
+    value_size (value_size)
+{
+    clear();
+}
+
+
+void JoinHashTable::clear() {
+    row_count = 0;
+    rows.clear();
+    values.clear();
+
+    // an empty partition, so find works before build
+    partitions.assign(1, Partition());
+    partitions[0].slots.assign(MIN_SLOTS, EMPTY_SLOT);
+    partition_mask = 0;
+}
+
+
+void JoinHashTable::build(uint_fast32_t threads) {
+    switch (key_size) {
+        case 1:  build_with_key_size<1>(threads); break;
+        case 2:  build_with_key_size<2>(threads); break;
+        case 3:  build_with_key_size<3>(threads); break;
+        case 4:  build_with_key_size<4>(threads); break;
+        default: build_with_key_size<0>(threads); break;
+    }
+}
+
+
+template <std::size_t K>
+void JoinHashTable::build_with_key_size(uint_fast32_t threads) {
+    static_assert(K <= MAX_FIXED_KEY_SIZE);
+    // groups and slots have 32 bit indexes
+    if (row_count >= UINT32_MAX) {
+        throw std::runtime_error("Too many rows for the hash table of a join.");
+    }
+    threads = std::max<uint_fast32_t>(1, std::min(threads, max_build_threads()));
+    const auto row_size = key_size + value_size;
+
+    vector<uint64_t> hashes(row_count);
+    run_in_threads(threads, [&](uint_fast32_t thread) {
+        const auto end = row_count * (thread + 1) / threads;
+        for (auto row = row_count * thread / threads; row < end; row++) {
+            hashes[row] = hash_key<K>(rows.data() + row * row_size);
+        }
+    });
+
+    // more partitions than threads, so a thread that gets a partition with many rows doesn't make the others wait
+    uint64_t partition_count = 1;
+    while (threads > 1 && partition_count < 4 * threads) {
+        partition_count *= 2;
+    }
+    partition_mask = partition_count - 1;
+
+    // rows of the partition p are order[partition_begin[p], partition_begin[p + 1])
+    vector<uint64_t> partition_begin(partition_count + 1, 0);
+    vector<uint32_t> order;
+    if (partition_count > 1) {
+        for (auto hash : hashes) {
+            partition_begin[((hash >> PARTITION_SHIFT) & partition_mask) + 1]++;
+        }
+        for (uint64_t p = 0; p < partition_count; p++) {
+            partition_begin[p + 1] += partition_begin[p];
+        }
+        order.resize(row_count);
+        auto next_pos = partition_begin;
+        for (uint64_t row = 0; row < row_count; row++) {
+            order[next_pos[(hashes[row] >> PARTITION_SHIFT) & partition_mask]++] = row;
+        }
+    } else {
+        partition_begin[1] = row_count;
+    }
+
+    values.resize(row_count * value_size);
+    partitions.assign(partition_count, Partition());
+
+    std::atomic<uint64_t> next_partition(0);
+    run_in_threads(threads, [&](uint_fast32_t) {
+        uint64_t p;
+        while ((p = next_partition++) < partition_count) {
+            build_partition<K>(partitions[p], order, hashes, partition_begin[p], partition_begin[p + 1]);
+        }
+    });
+
+    // the values were copied
+    rows = vector<ObjectId>();
+}
+
+
+template <std::size_t K>
+void JoinHashTable::build_partition(Partition& partition,
+                                    const vector<uint32_t>& order,
+                                    const vector<uint64_t>& hashes,
+                                    uint64_t begin,
+                                    uint64_t end)
+{
+    const auto row_size = key_size + value_size;
+    partition.slots.assign(MIN_SLOTS, EMPTY_SLOT);
+
+    // index of the key of each row
+    vector<uint32_t> row_keys(end - begin);
+
+    for (auto i = begin; i < end; i++) {
+        const auto row  = order.empty() ? i : order[i];
+        const auto hash = hashes[row];
+        const auto key  = rows.data() + row * row_size;
+        const auto tag  = hash >> 32;
+
+        // at most half of the slots are used
+        if (2 * partition.groups.size() >= partition.slots.size()) {
+            grow<K>(partition);
+        }
+        const auto mask = partition.slots.size() - 1;
+
+        uint32_t key_index;
+        for (auto slot = hash & mask; ; slot = (slot + 1) & mask) {
+            const auto entry = partition.slots[slot];
+            if (entry == EMPTY_SLOT) {
+                key_index = partition.groups.size();
+                partition.keys.insert(partition.keys.end(), key, key + key_size);
+                partition.groups.push_back(Group { 0, 0 });
+                partition.slots[slot] = (tag << 32) | (key_index + 1);
+                break;
+            }
+            if ((entry >> 32) == tag
+                && equal_keys<K>(partition.keys.data() + (static_cast<uint32_t>(entry) - 1) * key_size, key))
+            {
+                key_index = static_cast<uint32_t>(entry) - 1;
+                break;
+            }
+        }
+        partition.groups[key_index].count++;
+        row_keys[i - begin] = key_index;
+    }
+
+    uint64_t first = begin;
+    for (auto& group : partition.groups) {
+        group.first = first;
+        first += group.count;
+        group.count = 0; // counts again while the values are copied
+    }
+    for (auto i = begin; i < end; i++) {
+        const auto row    = order.empty() ? i : order[i];
+        auto& group       = partition.groups[row_keys[i - begin]];
+        const auto target = static_cast<std::size_t>(group.first + group.count++) * value_size;
+        std::copy_n(rows.data() + row * row_size + key_size, value_size, values.data() + target);
+    }
+}
+
+
+template <std::size_t K>
+void JoinHashTable::grow(Partition& partition) {
+    partition.slots.assign(2 * partition.slots.size(), EMPTY_SLOT);
+    const auto mask = partition.slots.size() - 1;
+
+    for (uint32_t key_index = 0; key_index < partition.groups.size(); key_index++) {
+        const auto hash = hash_key<K>(partition.keys.data() + key_index * key_size);
+        auto slot = hash & mask;
+        while (partition.slots[slot] != EMPTY_SLOT) {
+            slot = (slot + 1) & mask;
+        }
+        partition.slots[slot] = ((hash >> 32) << 32) | (key_index + 1);
+    }
+}
+
+
+uint64_t JoinHashTable::get_bytes() const {
+    uint64_t bytes = (rows.capacity() + values.capacity()) * sizeof(ObjectId);
+    for (const auto& partition : partitions) {
+        bytes += partition.slots.capacity()  * sizeof(uint64_t)
+               + partition.keys.capacity()   * sizeof(ObjectId)
+               + partition.groups.capacity() * sizeof(Group);
+    }
+    return bytes;
+}
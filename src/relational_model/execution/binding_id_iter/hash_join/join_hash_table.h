@@ -0,0 +1,175 @@
+#ifndef RELATIONAL_MODEL__JOIN_HASH_TABLE_H_
+#define RELATIONAL_MODEL__JOIN_HASH_TABLE_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "base/ids/object_id.h"
+
+/* JoinHashTable keeps the rows of the build side of a hash join in memory: a key of `key_size` ObjectIds and
+ * a value of `value_size` ObjectIds per row, without allocating memory per row.
+ *
+ * Rows are appended with new_row and then `build` groups them by key: the values of the rows with the same key
+ * are copied next to each other (in the order they were appended), and each different key is saved once in an
+ * open-addressing table with linear probing. A slot of the table has 32 bits of the hash of the key and the
+ * index of the key, so most slots of other keys are skipped without reading the key.
+ *
+ * The keys are divided in partitions by their hash, each partition has its own table and they are built
+ * independently, by many threads when `build` is given more than one.
+ *
+ * `find` is specialized by the key size for keys of up to MAX_FIXED_KEY_SIZE ids, find<0> works with any size.
+ */
+class JoinHashTable {
+public:
+    static constexpr std::size_t MAX_FIXED_KEY_SIZE = 4;
+
+    // `build` doesn't use more threads than one per MIN_ROWS_PER_THREAD rows
+    static constexpr uint_fast32_t MIN_ROWS_PER_THREAD = 64 * 1024;
+
+    // values of the rows with a key, `count` rows of value_size ids
+    struct Match {
+        const ObjectId* values;
+        uint_fast32_t count;
+    };
+
+    JoinHashTable(std::size_t key_size, std::size_t value_size);
+    ~JoinHashTable() = default;
+
+    inline std::size_t get_key_size()   const noexcept { return key_size; }
+    inline std::size_t get_value_size() const noexcept { return value_size; }
+
+    // rows appended, or rows in the table after build
+    inline uint64_t size() const noexcept { return row_count; }
+
+    // removes all the rows, the table can be used again
+    void clear();
+
+    // returns where the key followed by the value of a new row must be written, valid until the next new_row
+    inline ObjectId* new_row() {
+        const auto row_size = key_size + value_size;
+        rows.resize(rows.size() + row_size);
+        row_count++;
+        return rows.data() + rows.size() - row_size;
+    }
+
+    // groups the rows by key, no rows can be appended until clear. `threads` includes the calling thread
+    void build(uint_fast32_t threads = 1);
+
+    // number of threads `build` can use with the rows appended
+    inline uint_fast32_t max_build_threads() const noexcept {
+        return row_count < 2 * MIN_ROWS_PER_THREAD ? 1 : row_count / MIN_ROWS_PER_THREAD;
+    }
+
+    // returns the values of the rows with `key`, count is 0 if there are none. K must be key_size or 0
+    template <std::size_t K>
+    inline Match find(const ObjectId* key) const noexcept {
+        const auto hash       = hash_key<K>(key);
+        const auto& partition = partitions[(hash >> PARTITION_SHIFT) & partition_mask];
+        const auto mask       = partition.slots.size() - 1;
+        const auto tag        = hash >> 32;
+
+        for (auto slot = hash & mask; ; slot = (slot + 1) & mask) {
+            const auto entry = partition.slots[slot];
+            if (entry == EMPTY_SLOT) {
+                return Match { nullptr, 0 };
+            }
+            if ((entry >> 32) == tag) {
+                const auto key_index = static_cast<uint32_t>(entry) - 1;
+                if (equal_keys<K>(partition.keys.data() + key_index * key_size, key)) {
+                    const auto& group = partition.groups[key_index];
+                    return Match { values.data() + static_cast<std::size_t>(group.first) * value_size, group.count };
+                }
+            }
+        }
+    }
+
+    // find specialized by the key size of the table
+    inline Match find(const ObjectId* key) const noexcept {
+        switch (key_size) {
+            case 1:  return find<1>(key);
+            case 2:  return find<2>(key);
+            case 3:  return find<3>(key);
+            case 4:  return find<4>(key);
+            default: return find<0>(key);
+        }
+    }
+
+    // bytes of memory used by the rows
+    uint64_t get_bytes() const;
+
+private:
+    static constexpr uint64_t      EMPTY_SLOT      = 0;
+    static constexpr uint_fast32_t PARTITION_SHIFT = 40; // the partition uses bits the slots don't use
+    static constexpr uint_fast32_t MIN_SLOTS       = 16;
+
+    // rows of a key in `values`
+    struct Group {
+        uint32_t first;
+        uint32_t count;
+    };
+
+    struct Partition {
+        std::vector<uint64_t> slots; // (32 bits of the hash, index of the key + 1), size is a power of 2
+        std::vector<ObjectId> keys;  // different keys of the partition
+        std::vector<Group>    groups;
+    };
+
+    const std::size_t key_size;
+    const std::size_t value_size;
+
+    uint64_t row_count;
+
+    // rows appended (key and value), until build
+    std::vector<ObjectId> rows;
+
+    // values grouped by key, after build
+    std::vector<ObjectId> values;
+
+    std::vector<Partition> partitions;
+    uint64_t partition_mask;
+
+    template <std::size_t K>
+    inline uint64_t hash_key(const ObjectId* key) const noexcept {
+        const auto size = K == 0 ? key_size : K;
+        uint64_t hash = 0x9E3779B97F4A7C15UL;
+        for (std::size_t i = 0; i < size; i++) {
+            // finalizer of MurmurHash3, so the low bits depend on all the bits of the ids
+            hash ^= key[i].id;
+            hash ^= hash >> 33;
+            hash *= 0xFF51AFD7ED558CCDUL;
+            hash ^= hash >> 33;
+            hash *= 0xC4CEB9FE1A85EC53UL;
+            hash ^= hash >> 33;
+        }
+        return hash;
+    }
+
+    template <std::size_t K>
+    inline bool equal_keys(const ObjectId* lhs, const ObjectId* rhs) const noexcept {
+        const auto size = K == 0 ? key_size : K;
+        for (std::size_t i = 0; i < size; i++) {
+            if (lhs[i] != rhs[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    template <std::size_t K>
+    void build_with_key_size(uint_fast32_t threads);
+
+    // builds `partition` with the rows `order[begin, end)` (or [begin, end) if order is empty), their values
+    // are written from the row `begin` of `values`
+    template <std::size_t K>
+    void build_partition(Partition& partition,
+                         const std::vector<uint32_t>& order,
+                         const std::vector<uint64_t>& hashes,
+                         uint64_t begin,
+                         uint64_t end);
+
+    // doubles the slots of `partition`
+    template <std::size_t K>
+    void grow(Partition& partition);
+};
+
+#endif // RELATIONAL_MODEL__JOIN_HASH_TABLE_H_
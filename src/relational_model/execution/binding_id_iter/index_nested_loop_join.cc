@@ -55,6 +55,16 @@ void IndexNestedLoopJoin::assign_nulls() {
 }
 
 
+uint_fast32_t IndexNestedLoopJoin::split(BindingId& parent_binding, uint_fast32_t max_parts) {
+    return lhs->split(parent_binding, max_parts);
+}
+
+
+void IndexNestedLoopJoin::set_part(uint_fast32_t part) {
+    lhs->set_part(part);
+}
+
+
 void IndexNestedLoopJoin::analyze(std::ostream& os, int indent) const {
     os << std::string(indent, ' ');
     os << "IndexNestedLoopJoin(\n";
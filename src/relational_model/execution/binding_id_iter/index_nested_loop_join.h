@@ -19,6 +19,10 @@ public:
     void reset() override;
     void assign_nulls() override;
 
+    // the results are divided by the parts of lhs
+    uint_fast32_t split(BindingId& parent_binding, uint_fast32_t max_parts) override;
+    void set_part(uint_fast32_t part) override;
+
 private:
     std::unique_ptr<BindingIdIter> lhs;
     std::unique_ptr<BindingIdIter> original_rhs;
@@ -23,7 +23,15 @@ template <std::size_t N>
 IndexScan<N>::IndexScan(BPlusTree<N>& bpt, ThreadInfo* thread_info, std::array<std::unique_ptr<ScanRange>, N> ranges) :
     bpt         (bpt),
     thread_info (thread_info),
-    ranges      (move(ranges)) { }
+    ranges      (move(ranges))
+{
+    for (uint_fast32_t i = 0; i < N; ++i) {
+        VarId var(0);
+        if (this->ranges[i]->assigns_var(&var)) {
+            assigned_vars.push_back({ i, var });
+        }
+    }
+}
 
 
 template <std::size_t N>
@@ -31,21 +39,7 @@ void IndexScan<N>::begin(BindingId& parent_binding) {
     assert(ranges.size() == N && "Inconsistent size of ranges and bpt");
 
     this->parent_binding = &parent_binding;
-    std::array<uint64_t, N> min_ids;
-    std::array<uint64_t, N> max_ids;
-
-    for (uint_fast32_t i = 0; i < N; ++i) {
-        assert(ranges[i] != nullptr);
-        min_ids[i] = ranges[i]->get_min(parent_binding);
-        max_ids[i] = ranges[i]->get_max(parent_binding);
-    }
-
-    it = bpt.get_range(
-        &thread_info->interruption_requested,
-        Record<N>(std::move(min_ids)),
-        Record<N>(std::move(max_ids))
-    );
-    ++bpt_searches;
+    search_range();
 }
 
 
@@ -65,16 +59,69 @@ bool IndexScan<N>::next() {
 }
 
 
+template <std::size_t N>
+uint_fast32_t IndexScan<N>::next_batch(BindingIdBatch& batch) {
+    assert(it != nullptr);
+    const auto capacity = batch.get_capacity();
+    batch_records.resize(capacity);
+
+    // each call returns records of one leaf
+    uint_fast32_t count = 0;
+    while (count < capacity) {
+        auto found = it->next_batch(batch_records.data() + count, capacity - count);
+        if (found == 0) {
+            break;
+        }
+        count += found;
+    }
+    if (count == 0) {
+        batch.set_size(0);
+        return 0;
+    }
+
+    batch.fill_from_binding(count);
+    for (const auto& [position, var] : assigned_vars) {
+        auto column = batch.column(var);
+        for (uint_fast32_t row = 0; row < count; row++) {
+            column[row] = ObjectId(batch_records[row].ids[position]);
+        }
+    }
+    results_found += count;
+    batch.set_size(count);
+    return count;
+}
+
+
 template <std::size_t N>
 void IndexScan<N>::reset() {
+    search_range();
+}
+
+
+template <std::size_t N>
+void IndexScan<N>::search_range() {
     std::array<uint64_t, N> min_ids;
     std::array<uint64_t, N> max_ids;
 
     for (uint_fast32_t i = 0; i < N; ++i) {
+        assert(ranges[i] != nullptr);
         min_ids[i] = ranges[i]->get_min(*parent_binding);
         max_ids[i] = ranges[i]->get_max(*parent_binding);
     }
 
+    if (part > 0) {
+        min_ids = separators[part - 1].ids;
+    }
+    if (part < separators.size()) {
+        // the greatest record less than the separator, separators are greater than the minimum so it exists
+        max_ids = separators[part].ids;
+        auto i = N - 1;
+        while (max_ids[i] == 0) {
+            max_ids[i--] = UINT64_MAX;
+        }
+        max_ids[i]--;
+    }
+
     it = bpt.get_range(
         &thread_info->interruption_requested,
         Record<N>(std::move(min_ids)),
@@ -84,6 +131,28 @@ void IndexScan<N>::reset() {
 }
 
 
+template <std::size_t N>
+uint_fast32_t IndexScan<N>::split(BindingId& parent_binding, uint_fast32_t max_parts) {
+    std::array<uint64_t, N> min_ids;
+    std::array<uint64_t, N> max_ids;
+
+    for (uint_fast32_t i = 0; i < N; ++i) {
+        min_ids[i] = ranges[i]->get_min(parent_binding);
+        max_ids[i] = ranges[i]->get_max(parent_binding);
+    }
+    separators = bpt.get_separators(Record<N>(min_ids), Record<N>(max_ids), max_parts);
+    part = 0;
+    return separators.size() + 1;
+}
+
+
+template <std::size_t N>
+void IndexScan<N>::set_part(uint_fast32_t _part) {
+    assert(_part <= separators.size());
+    part = _part;
+}
+
+
 template <std::size_t N>
 void IndexScan<N>::assign_nulls() {
     for (uint_fast32_t i = 0; i < N; ++i) {
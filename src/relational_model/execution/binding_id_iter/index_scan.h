@@ -3,6 +3,7 @@
 
 #include <array>
 #include <memory>
+#include <vector>
 
 #include "base/binding/binding_id_iter.h"
 #include "base/thread/thread_info.h"
@@ -19,6 +20,14 @@ private:
     BindingId* parent_binding;
     std::array<std::unique_ptr<ScanRange>, N> ranges;
 
+    // (position in the record, variable) of the ranges that assign a variable, used by next_batch
+    std::vector<std::pair<uint_fast32_t, VarId>> assigned_vars;
+    std::vector<Record<N>> batch_records;
+
+    // set by split, the part k goes from the separator k-1 to the record before the separator k
+    std::vector<Record<N>> separators;
+    uint_fast32_t part = 0;
+
     // statistics
     uint_fast32_t results_found = 0;
     uint_fast32_t bpt_searches = 0;
@@ -30,8 +39,15 @@ public:
     void analyze(std::ostream& os, int indent = 0) const override;
     void begin(BindingId& parent_binding) override;
     bool next() override;
+    uint_fast32_t next_batch(BindingIdBatch& batch) override;
     void reset() override;
     void assign_nulls() override;
+    uint_fast32_t split(BindingId& parent_binding, uint_fast32_t max_parts) override;
+    void set_part(uint_fast32_t part) override;
+
+private:
+    // starts the iteration of the records of the ranges (and of the current part)
+    void search_range();
 };
 
 #endif // RELATIONAL_MODEL__GRAPH_SCAN_H_
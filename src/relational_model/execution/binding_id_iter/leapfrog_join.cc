@@ -41,7 +41,9 @@ void LeapfrogJoin::begin(BindingId& _parent_binding) {
 
     // Initialize 1 buffer per iterator
     for (uint_fast32_t i = 0; i < leapfrog_iters.size(); i++) {
-        buffers.push_back(make_unique<TupleBuffer>(leapfrog_iters[i]->get_enumeration_vars()));
+        const auto& enumeration_vars = leapfrog_iters[i]->get_enumeration_vars();
+        buffers.push_back(private_buffer_pos ? make_unique<TupleBuffer>(enumeration_vars, *private_buffer_pos)
+                                             : make_unique<TupleBuffer>(enumeration_vars));
     }
     buffer_pos.resize(leapfrog_iters.size());
 
@@ -132,6 +134,7 @@ bool LeapfrogJoin::next() {
 
 
 void LeapfrogJoin::reset() {
+    first_key_found = false;
     bool open_terms = true;
     for (auto& lf_iter : leapfrog_iters) {
         if (!lf_iter->open_terms(*parent_binding)) {
@@ -197,10 +200,22 @@ bool LeapfrogJoin::find_intersection_for_current_level() {
     auto min = iters_for_var[level][p]->get_key();
     auto max = iters_for_var[level][iters_for_var[level].size() - 1]->get_key();
 
+    // with a range for the first variable, the iterator with the max key jumps to the start of the range
+    if (level == 0 && max < min_first_key) {
+        auto& last_iter = iters_for_var[level][iters_for_var[level].size() - 1];
+        if (!last_iter->seek(min_first_key)) {
+            return false;
+        }
+        max = last_iter->get_key();
+    }
+
     // cout << "min: " << min << "\n";
     // cout << "max: " << max << "\n";
 
     while (min != max) { // min = max means all are equal
+        if (level == 0 && max > max_first_key) {
+            return false;
+        }
         if (__builtin_expect(!!(*leapfrog_iters[0]->interruption_requested), 0)) {
             throw InterruptedException();
         }
@@ -219,15 +234,61 @@ bool LeapfrogJoin::find_intersection_for_current_level() {
             return false;
         }
     }
+    if (level == 0 && max > max_first_key) {
+        return false;
+    }
     parent_binding->add(var_order[level], ObjectId(min));
     // cout << "found intersection at level " << level << "\n";
     return true;
 }
 
 
+void LeapfrogJoin::set_first_key_range(uint64_t min_key, uint64_t max_key) {
+    min_first_key = min_key;
+    max_first_key = max_key;
+}
+
+
+bool LeapfrogJoin::next_first_key(uint64_t& key) {
+    if (level != 0) {
+        return false;
+    }
+    // move the last iterator forward to avoid finding the same key again
+    if (first_key_found && !iters_for_var[0][iters_for_var[0].size() - 1]->next()) {
+        level = -1;
+        return false;
+    }
+    if (!find_intersection_for_current_level()) {
+        level = -1;
+        return false;
+    }
+    first_key_found = true;
+    key = iters_for_var[0][0]->get_key();
+    return true;
+}
+
+
+LeapfrogSearchCounters LeapfrogJoin::get_search_counters() const {
+    LeapfrogSearchCounters search_counters;
+    for (const auto& leapfrog_iter : leapfrog_iters) {
+        search_counters += leapfrog_iter->search_counters;
+    }
+    return search_counters;
+}
+
+
+void LeapfrogJoin::set_private_buffer(uint_fast32_t _private_buffer_pos) {
+    private_buffer_pos = _private_buffer_pos;
+}
+
+
 void LeapfrogJoin::analyze(std::ostream& os, int indent) const {
     os << std::string(indent, ' ');
-    os << "LeapfrogJoin(found: " << results_found << ")";
+    const auto search_counters = get_search_counters();
+    os << "LeapfrogJoin(found: " << results_found
+       << ", searches in leaf: " << search_counters.in_leaf
+       << ", in next leaf: " << search_counters.next_leaf
+       << ", through directory: " << search_counters.directory << ")";
 }
 
 
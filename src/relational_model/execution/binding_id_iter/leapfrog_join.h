@@ -2,6 +2,7 @@
 #define RELATIONAL_MODEL__LEAPFROG_JOIN_H_
 
 #include <memory>
+#include <optional>
 #include <vector>
 
 #include "base/binding/binding_id_iter.h"
@@ -25,6 +26,20 @@ public:
     void reset() override;
     void assign_nulls() override;
 
+    // Only results where the first variable of var_order is in [min_key, max_key] are returned, used by
+    // ParallelLeapfrogJoin to give each worker a range of keys. It's used after the next `begin` or `reset`
+    void set_first_key_range(uint64_t min_key, uint64_t max_key);
+
+    // Used by ParallelLeapfrogJoin instead of `next` to find the morsels: after `begin`, it writes the next key
+    // of the intersection of the first variable of var_order. Returns false when there are no more keys
+    bool next_first_key(uint64_t& key);
+
+    LeapfrogSearchCounters get_search_counters() const;
+
+    // the enumeration buffers use the private buffer `private_buffer_pos` (see
+    // FileManager::reserve_private_buffer) instead of the one of the thread calling `begin`
+    void set_private_buffer(uint_fast32_t private_buffer_pos);
+
 private:
     std::vector<std::unique_ptr<LeapfrogIter>> leapfrog_iters;
 
@@ -46,8 +61,16 @@ private:
     std::vector<std::unique_ptr<TupleBuffer>> buffers;
     std::vector<int_fast32_t> buffer_pos;
 
+    std::optional<uint_fast32_t> private_buffer_pos;
+
     uint_fast32_t results_found = 0;
 
+    uint64_t min_first_key = 0;
+    uint64_t max_first_key = UINT64_MAX;
+
+    // true if next_first_key found a key since the last `begin` or `reset`
+    bool first_key_found = false;
+
     void up();
     void down();
     bool find_intersection_for_current_level();
@@ -0,0 +1,266 @@
+#include "parallel_leapfrog_join.h"
+
+#include <algorithm>
+
+#include "storage/buffer_manager.h"
+#include "storage/file_manager.h"
+
+using namespace std;
+
+ParallelLeapfrogJoin::ParallelLeapfrogJoin(unique_ptr<LeapfrogJoin>         _first_key_join,
+                                           vector<unique_ptr<LeapfrogJoin>> _worker_joins,
+                                           vector<VarId>                    _var_order) :
+    first_key_join (move(_first_key_join)),
+    workers        (_worker_joins.size()),
+    var_order      (move(_var_order)),
+    morsels        (0),
+    stopping       (false)
+{
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i].join = move(_worker_joins[i]);
+        try {
+            workers[i].private_buffer_pos = file_manager.reserve_private_buffer();
+        } catch (...) {
+            for (size_t j = 0; j < i; j++) {
+                file_manager.release_private_buffer(workers[j].private_buffer_pos);
+            }
+            throw;
+        }
+        workers[i].join->set_private_buffer(workers[i].private_buffer_pos);
+    }
+}
+
+
+ParallelLeapfrogJoin::~ParallelLeapfrogJoin() {
+    stop();
+    // the enumeration buffers of the join are removed before its private buffer is released
+    for (auto& worker : workers) {
+        worker.join.reset();
+        file_manager.release_private_buffer(worker.private_buffer_pos);
+    }
+}
+
+
+void ParallelLeapfrogJoin::begin(BindingId& _parent_binding) {
+    parent_binding = &_parent_binding;
+
+    // the joins read the values of the assigned variables from copies of the parent binding
+    first_key_binding = make_unique<BindingId>(parent_binding->var_count());
+    first_key_binding->add_all(*parent_binding);
+    first_key_join->begin(*first_key_binding);
+
+    for (auto& worker : workers) {
+        worker.binding = make_unique<BindingId>(parent_binding->var_count());
+    }
+    start();
+}
+
+
+void ParallelLeapfrogJoin::reset() {
+    stop();
+    first_key_binding->add_all(*parent_binding);
+    first_key_join->reset();
+    start();
+}
+
+
+void ParallelLeapfrogJoin::start() {
+    morsels = 0;
+    stopping = false;
+    worker_error = nullptr;
+    running_workers = workers.size();
+    search_counters = LeapfrogSearchCounters(); // the counters of each join are added when its worker ends
+    chunks.clear();
+    current_chunk.clear();
+    current_pos = 0;
+
+    for (auto& worker : workers) {
+        worker.binding->add_all(*parent_binding);
+        worker.thread = std::thread(&ParallelLeapfrogJoin::run_worker, this, std::ref(worker));
+    }
+}
+
+
+void ParallelLeapfrogJoin::stop() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        stopping = true;
+    }
+    chunk_removed.notify_all();
+    for (auto& worker : workers) {
+        if (worker.thread.joinable()) {
+            worker.thread.join();
+        }
+    }
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    add_worker_buffer_stats();
+}
+
+
+void ParallelLeapfrogJoin::add_worker_buffer_stats() {
+    buffer_manager.add_thread_stats(worker_buffer_stats);
+    worker_buffer_stats = BufferStats();
+}
+
+
+void ParallelLeapfrogJoin::run_worker(Worker& worker) {
+    const auto chunk_size = CHUNK_ROWS * var_order.size();
+    const auto buffer_stats_at_start = buffer_manager.get_thread_stats();
+    try {
+        vector<ObjectId> chunk;
+        chunk.reserve(chunk_size);
+
+        uint64_t min_key, max_key;
+        while (next_morsel(min_key, max_key)) {
+            worker.join->set_first_key_range(min_key, max_key);
+            if (worker.begun) {
+                worker.join->reset();
+            } else {
+                worker.join->begin(*worker.binding);
+                worker.begun = true;
+            }
+
+            while (!stopping && worker.join->next()) {
+                for (const auto& var : var_order) {
+                    chunk.push_back((*worker.binding)[var]);
+                }
+                if (chunk.size() == chunk_size) {
+                    push_chunk(move(chunk));
+                    chunk = vector<ObjectId>();
+                    chunk.reserve(chunk_size);
+                }
+            }
+        }
+        if (!chunk.empty()) {
+            push_chunk(move(chunk));
+        }
+    } catch (...) {
+        // the error is thrown by the thread of the query, the other workers stop
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        if (worker_error == nullptr) {
+            worker_error = std::current_exception();
+        }
+        stopping = true;
+        chunk_removed.notify_all();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        if (worker.begun) {
+            search_counters += worker.join->get_search_counters();
+        }
+        worker_buffer_stats += buffer_manager.get_thread_stats() - buffer_stats_at_start;
+        running_workers--;
+    }
+    chunk_added.notify_one();
+}
+
+
+bool ParallelLeapfrogJoin::next_morsel(uint64_t& min_key, uint64_t& max_key) {
+    std::lock_guard<std::mutex> lock(morsel_mutex);
+    uint64_t key;
+    if (stopping || !first_key_join->next_first_key(key)) {
+        return false;
+    }
+    min_key = key;
+    max_key = key;
+    for (uint_fast32_t i = 1; i < MORSEL_KEYS && first_key_join->next_first_key(key); i++) {
+        max_key = key;
+    }
+    morsels++;
+    return true;
+}
+
+
+void ParallelLeapfrogJoin::push_chunk(vector<ObjectId>&& chunk) {
+    std::unique_lock<std::mutex> lock(queue_mutex);
+    chunk_removed.wait(lock, [&] { return stopping || chunks.size() < 2 * workers.size(); });
+    if (stopping) {
+        return;
+    }
+    chunks.push_back(move(chunk));
+    lock.unlock();
+    chunk_added.notify_one();
+}
+
+
+bool ParallelLeapfrogJoin::pop_chunk() {
+    std::unique_lock<std::mutex> lock(queue_mutex);
+    chunk_added.wait(lock, [&] { return !chunks.empty() || running_workers == 0 || worker_error != nullptr; });
+    if (worker_error != nullptr) {
+        std::rethrow_exception(worker_error);
+    }
+    if (chunks.empty()) {
+        add_worker_buffer_stats();
+        return false;
+    }
+    current_chunk = move(chunks.front());
+    chunks.pop_front();
+    current_pos = 0;
+    lock.unlock();
+    chunk_removed.notify_one();
+    return true;
+}
+
+
+bool ParallelLeapfrogJoin::next() {
+    if (current_pos == current_chunk.size() && !pop_chunk()) {
+        return false;
+    }
+    for (const auto& var : var_order) {
+        parent_binding->add(var, current_chunk[current_pos++]);
+    }
+    results_found++;
+    return true;
+}
+
+
+uint_fast32_t ParallelLeapfrogJoin::next_batch(BindingIdBatch& batch) {
+    const auto capacity = batch.get_capacity();
+    const auto row_size = var_order.size();
+
+    // variables not in var_order keep the values of the parent binding
+    batch.fill_from_binding(capacity);
+
+    uint_fast32_t count = 0;
+    while (count < capacity) {
+        if (current_pos == current_chunk.size() && !pop_chunk()) {
+            break;
+        }
+        const auto rows = std::min<size_t>(capacity - count, (current_chunk.size() - current_pos) / row_size);
+        for (size_t i = 0; i < row_size; i++) {
+            auto column = batch.column(var_order[i]);
+            for (size_t r = 0; r < rows; r++) {
+                column[count + r] = current_chunk[current_pos + r*row_size + i];
+            }
+        }
+        current_pos += rows * row_size;
+        count += rows;
+    }
+    results_found += count;
+    batch.set_size(count);
+    return count;
+}
+
+
+void ParallelLeapfrogJoin::assign_nulls() {
+    for (const auto& var : var_order) {
+        parent_binding->add(var, ObjectId::get_null());
+    }
+}
+
+
+void ParallelLeapfrogJoin::analyze(std::ostream& os, int indent) const {
+    LeapfrogSearchCounters counters;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        counters = search_counters;
+    }
+    os << std::string(indent, ' ');
+    os << "ParallelLeapfrogJoin(threads: " << workers.size()
+       << ", morsels: " << morsels
+       << ", found: " << results_found
+       << ", searches in leaf: " << counters.in_leaf
+       << ", in next leaf: " << counters.next_leaf
+       << ", through directory: " << counters.directory << ")";
+}
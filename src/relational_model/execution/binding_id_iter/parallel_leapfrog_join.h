@@ -0,0 +1,105 @@
+#ifndef RELATIONAL_MODEL__PARALLEL_LEAPFROG_JOIN_H_
+#define RELATIONAL_MODEL__PARALLEL_LEAPFROG_JOIN_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "base/binding/binding_id_iter.h"
+#include "base/ids/var_id.h"
+#include "relational_model/execution/binding_id_iter/leapfrog_join.h"
+#include "storage/buffer_stats.h"
+
+/* ParallelLeapfrogJoin runs a LeapfrogJoin in many threads.
+ *
+ * The keys of the first variable of var_order are split in morsels of MORSEL_KEYS consecutive keys. The keys
+ * are found by a LeapfrogJoin that only intersects the first variable. Each worker has its own LeapfrogJoin
+ * (with its own LeapfrogIters and enumeration buffers in the private buffer of the worker) and takes the next
+ * morsel when it finishes one, so workers that get expensive keys take fewer morsels. The private buffer of
+ * each worker is reserved when the ParallelLeapfrogJoin is created and released when it's destroyed, because
+ * the threads of the workers are created again on each reset and their enumeration buffers are kept.
+ *
+ * Workers write the values of var_order of their results in chunks of CHUNK_ROWS rows, which are given to
+ * the thread of the query through a queue of at most 2 chunks per worker. Workers wait while the queue is
+ * full, so a query that stops early (e.g. with LIMIT) doesn't compute many results it won't use.
+ * Results are returned in any order. When a worker ends its search counters are added to the ones printed by
+ * analyze, and its buffer counters to the ones of the thread of the query.
+ */
+class ParallelLeapfrogJoin : public BindingIdIter {
+public:
+    static constexpr uint_fast32_t MORSEL_KEYS = 64;
+    static constexpr uint_fast32_t CHUNK_ROWS  = 1024;
+
+    // All the joins must have the same var_order, `first_key_join` is only used to find the morsels
+    ParallelLeapfrogJoin(std::unique_ptr<LeapfrogJoin>              first_key_join,
+                         std::vector<std::unique_ptr<LeapfrogJoin>> worker_joins,
+                         std::vector<VarId>                         var_order);
+    ~ParallelLeapfrogJoin();
+
+    void analyze(std::ostream& os, int indent = 0) const override;
+    void begin(BindingId& parent_binding) override;
+    bool next() override;
+    uint_fast32_t next_batch(BindingIdBatch& batch) override;
+    void reset() override;
+    void assign_nulls() override;
+
+private:
+    struct Worker {
+        std::unique_ptr<LeapfrogJoin> join;
+        uint_fast32_t private_buffer_pos;
+        std::unique_ptr<BindingId> binding;
+        std::thread thread;
+        bool begun = false; // the join is reset for the next morsels
+    };
+
+    std::unique_ptr<LeapfrogJoin> first_key_join;
+    std::unique_ptr<BindingId> first_key_binding;
+    std::vector<Worker> workers;
+    const std::vector<VarId> var_order;
+
+    BindingId* parent_binding;
+
+    // protects first_key_join
+    std::mutex morsel_mutex;
+    std::atomic<uint_fast32_t> morsels;
+
+    // protects the queue and the state of the workers
+    mutable std::mutex queue_mutex;
+    std::condition_variable chunk_added;   // the query thread waits for chunks
+    std::condition_variable chunk_removed; // workers wait for space in the queue
+    std::deque<std::vector<ObjectId>> chunks;
+    uint_fast32_t running_workers = 0;
+    std::atomic<bool> stopping; // only changed with queue_mutex locked
+    std::exception_ptr worker_error;
+    LeapfrogSearchCounters search_counters; // of the workers that ended
+    BufferStats worker_buffer_stats; // of the workers that ended, not yet added to the thread of the query
+
+    // chunk being returned by the query thread
+    std::vector<ObjectId> current_chunk;
+    std::size_t current_pos = 0;
+
+    uint64_t results_found = 0;
+
+    void start();
+    void stop();
+    void run_worker(Worker& worker);
+
+    // writes the range of keys of the next morsel, returns false when there are no more
+    bool next_morsel(uint64_t& min_key, uint64_t& max_key);
+
+    // waits for space in the queue, the chunk is discarded if the workers are stopping
+    void push_chunk(std::vector<ObjectId>&& chunk);
+
+    // takes the next chunk from the queue, returns false when all the workers ended and the queue is empty
+    bool pop_chunk();
+
+    // adds `worker_buffer_stats` to the buffer counters of the calling thread. `queue_mutex` must be locked
+    void add_worker_buffer_stats();
+};
+
+#endif // RELATIONAL_MODEL__PARALLEL_LEAPFROG_JOIN_H_
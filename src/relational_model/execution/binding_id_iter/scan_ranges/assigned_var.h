@@ -22,6 +22,10 @@ public:
     }
 
     void try_assign(BindingId&, ObjectId) override { }
+
+    bool assigns_var(VarId*) const override {
+        return false;
+    }
 };
 
 #endif // RELATIONAL_MODEL__ASSIGNED_VAR_H_
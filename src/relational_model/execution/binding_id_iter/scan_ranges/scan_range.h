@@ -17,6 +17,9 @@ public:
     virtual uint64_t get_max(BindingId& input) = 0;
     virtual void try_assign(BindingId& my_binding, ObjectId) = 0;
 
+    // true if try_assign writes a variable in the binding, the variable is written in `var`
+    virtual bool assigns_var(VarId* var) const = 0;
+
     static std::unique_ptr<ScanRange> get(Id id, bool assigned);
 };
 
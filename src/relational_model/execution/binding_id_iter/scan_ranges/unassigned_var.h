@@ -22,6 +22,11 @@ public:
     void try_assign(BindingId& binding, ObjectId obj_id) override {
         binding.add(var_id, obj_id);
     }
+
+    bool assigns_var(VarId* var) const override {
+        *var = var_id;
+        return true;
+    }
 };
 
 #endif // RELATIONAL_MODEL__UNASSIGNED_VAR_H_
@@ -2,20 +2,41 @@
 
 using namespace std;
 
-Match::Match(const GraphModel& model, unique_ptr<BindingIdIter> root, size_t binding_size) :
-    model      (model),
-    root       (move(root)),
-    input      (binding_size),
-    my_binding (BindingMaterializeId(model, binding_size, input)) { }
+Match::Match(const GraphModel& model,
+             unique_ptr<BindingIdIter> root,
+             size_t binding_size,
+             uint_fast32_t batch_size,
+             ObjectCache* object_cache) :
+    cache_reader (object_cache),
+    model        (model),
+    root         (move(root)),
+    input        (binding_size),
+    my_binding   (BindingMaterializeId(model, binding_size, input)),
+    batch        (input, batch_size) { }
 
 
 void Match::begin() {
     root->begin(input);
+    // batches grow from one binding_id, so queries that stop early (e.g. with LIMIT) don't compute many
+    // binding_ids they won't use
+    batch.set_capacity(1);
+    batch.set_size(0);
+    batch_row = 0;
+    finished  = false;
 }
 
 
 bool Match::next() {
-    return root->next();
+    if (batch_row == batch.get_size()) {
+        if (finished || root->next_batch(batch) == 0) {
+            finished = true;
+            return false;
+        }
+        batch.set_capacity(batch.get_capacity() * 2);
+        batch_row = 0;
+    }
+    batch.get_row(batch_row++, input);
+    return true;
 }
 
 
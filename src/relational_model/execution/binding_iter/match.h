@@ -3,14 +3,22 @@
 
 #include <memory>
 
+#include "base/binding/binding_id_batch.h"
 #include "base/binding/binding_id_iter.h"
 #include "base/binding/binding_iter.h"
 #include "base/graph/graph_model.h"
 #include "relational_model/execution/binding/binding_materialize_id.h"
+#include "storage/index/object_file/object_cache.h"
 
 class Match : public BindingIter {
 public:
-    Match(const GraphModel& model, std::unique_ptr<BindingIdIter> root, size_t binding_size);
+    // The root is read with batches of up to `batch_size` binding_ids (see BindingIdIter::next_batch).
+    // The objects materialized from `object_cache` are valid until the Match is destroyed
+    Match(const GraphModel& model,
+          std::unique_ptr<BindingIdIter> root,
+          size_t binding_size,
+          uint_fast32_t batch_size = BindingIdBatch::DEFAULT_CAPACITY,
+          ObjectCache* object_cache = nullptr);
     ~Match() = default;
 
     inline Binding& get_binding() noexcept override { return my_binding; }
@@ -20,12 +28,17 @@ public:
     void analyze(std::ostream&, int indent = 0) const override;
 
 private:
+    ObjectCache::Reader cache_reader;
     const GraphModel& model;
     std::unique_ptr<BindingIdIter> root;
     BindingId input;
     BindingId* binding_id_root;
 
     BindingMaterializeId my_binding;
+
+    BindingIdBatch batch;
+    uint_fast32_t batch_row;
+    bool finished;
 };
 
 #endif // RELATIONAL_MODEL__MATCH_H_
@@ -13,14 +13,18 @@
 using namespace std;
 
 OrderBy::OrderBy(ThreadInfo*             _thread_info,
+                 const GraphModel&       _model,
                  unique_ptr<BindingIter> _child,
                  set<VarId>              _saved_vars,
                  vector<VarId>           _order_vars,
-                 vector<bool>            _ascending) :
+                 vector<bool>            _ascending,
+                 bool                    _order_ids) :
     thread_info    (_thread_info),
+    model          (_model),
     child          (move(_child)),
     order_vars     (move(_order_vars)),
     ascending      (move(_ascending)),
+    order_ids      (_order_ids),
     my_binding     (BindingOrderBy(saved_vars)),
     first_file_id  (file_manager.get_tmp_file_id()),
     second_file_id (file_manager.get_tmp_file_id())
@@ -41,7 +45,7 @@ OrderBy::~OrderBy() {
 
 
 std::unique_ptr<TupleCollection> OrderBy::get_run(Page& run_page) {
-    return make_unique<TupleCollection>(run_page, saved_vars, order_vars, ascending);
+    return make_unique<TupleCollection>(run_page, saved_vars, order_vars, ascending, order_ids);
 }
 
 
@@ -51,7 +55,8 @@ void OrderBy::begin() {
     total_pages = 0;
     run = get_run(buffer_manager.get_tmp_page(first_file_id, total_pages));
     run->reset();
-    std::vector<GraphObject> graph_objects(saved_vars.size());
+    // with `order_ids` the ids of the order vars are saved after the objects (see TupleCollection)
+    std::vector<GraphObject> graph_objects(saved_vars.size() + (order_ids ? order_vars.size() : 0));
 
     auto& child_binding = child->get_binding();
     // Save all the tuples of child in disk and apply sort to each page
@@ -65,6 +70,14 @@ void OrderBy::begin() {
         for (auto&& [var, index] : saved_vars) {
             graph_objects[index] = child_binding[var];
         }
+        if (order_ids) {
+            for (uint_fast32_t i = 0; i < order_vars.size(); i++) {
+                const auto id = child_binding.get_id(order_vars[i]);
+                graph_objects[saved_vars.size() + i] = model.is_ordered_id(id)
+                                                       ? GraphObject::make_int(id.id)
+                                                       : GraphObject::make_null();
+            }
+        }
         run->add(graph_objects);
     }
     run->sort();
@@ -85,6 +98,7 @@ bool OrderBy::next() {
         page_position = 0;
     }
     auto graph_object = run->get(page_position);
+    graph_object.resize(saved_vars.size());
     my_binding.update_binding(graph_object);
     page_position++;
     return true;
@@ -112,7 +126,8 @@ void OrderBy::merge_sort(const std::vector<VarId>& order_var_ids) {
     MergeOrderedTupleCollection merger(saved_vars,
                                        order_var_ids,
                                        ascending,
-                                       &thread_info->interruption_requested);
+                                       &thread_info->interruption_requested,
+                                       order_ids);
 
     // output_file_id = &first_file_id;
     bool output_is_in_second = false;
@@ -16,11 +16,15 @@
 
 class OrderBy : public BindingIter {
 public:
+    // When `order_ids` is set the values of the order vars whose ids are ordered (see GraphModel::is_ordered_id)
+    // are compared by their ids
     OrderBy(ThreadInfo* thread_info,
+            const GraphModel& model,
             std::unique_ptr<BindingIter> child,
             std::set<VarId> saved_vars,
             std::vector<VarId> order_vars,
-            std::vector<bool> ascending);
+            std::vector<bool> ascending,
+            bool order_ids = false);
     ~OrderBy();
 
     inline Binding& get_binding() noexcept override { return my_binding; }
@@ -31,6 +35,7 @@ public:
 
 private:
     ThreadInfo* thread_info;
+    const GraphModel& model;
     std::unique_ptr<BindingIter> child;
 
     std::map<VarId, uint_fast32_t> saved_vars;
@@ -38,6 +43,8 @@ private:
     std::vector<VarId> order_vars;
     std::vector<bool> ascending;
 
+    const bool order_ids;
+
     BindingOrderBy my_binding;
 
     TmpFileId first_file_id;
@@ -1,6 +1,7 @@
 #include "select.h"
 
 #include "relational_model/execution/binding_id_iter/property_paths/path_manager.h"
+#include "storage/buffer_manager.h"
 
 using namespace std;
 
@@ -21,6 +22,7 @@ Select::~Select() {
 
 
 void Select::begin() {
+    buffer_stats_at_begin = buffer_manager.get_thread_stats();
     child_iter->begin();
 }
 
@@ -43,4 +45,6 @@ void Select::analyze(std::ostream& os, int indent) const {
     }
     os << " )\n";
     child_iter->analyze(os, indent);
+    os << "\n";
+    (buffer_manager.get_thread_stats() - buffer_stats_at_begin).print(os, indent);
 }
@@ -8,6 +8,7 @@
 #include "base/binding/binding_iter.h"
 #include "base/parser/logical_plan/var.h"
 #include "relational_model/execution/binding/binding_select.h"
+#include "storage/buffer_stats.h"
 
 class Select : public BindingIter {
 
@@ -17,6 +18,9 @@ private:
     uint64_t count = 0;
     BindingSelect my_binding;
 
+    // buffer counters of the thread when the query started, to show the pages used by the query in analyze
+    BufferStats buffer_stats_at_begin;
+
 public:
     Select(std::unique_ptr<BindingIter> child_iter,
            std::vector<std::pair<Var, VarId>> projection_vars,
@@ -48,6 +48,10 @@ ObjectId GraphObjectVisitor::operator()(const AnonymousNode& anonymous_node) con
 
 
 ObjectId GraphObjectVisitor::operator()(const StringInlined& string_inlined) const {
+    if (model.has_sorted_strings()) {
+        // all the strings are in the object file
+        return (*this)(StringExternal(string_inlined.id));
+    }
     std::string str(string_inlined.id);
 
     uint64_t res = 0;
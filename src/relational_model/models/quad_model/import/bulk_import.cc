@@ -1,8 +1,12 @@
 #include "bulk_import.h"
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <exception>
 #include <iostream>
 #include <map>
+#include <mutex>
 #include <thread>
 #include <boost/spirit/include/support_istream_iterator.hpp>
 
@@ -16,17 +20,20 @@
 
 using namespace std;
 
-BulkImport::BulkImport(const string& filename, QuadModel& model) :
+BulkImport::BulkImport(const string& filename, QuadModel& model, uint_fast32_t threads, bool sorted_strings) :
     model                           (model),
     catalog                         (model.catalog()),
     nodes_ordered_file              (OrderedFile<1>("nodes_ordered_file")),
     labels_ordered_file             (OrderedFile<2>("labels_ordered_file")),
     properties_ordered_file         (OrderedFile<3>("properties_ordered_file")),
     connections_ordered_file        (OrderedFile<4>("connections_ordered_file")),
+    type_connections_ordered_file   (OrderedFile<4>("type_connections_ordered_file")),
     equal_from_to_ordered_file      (OrderedFile<3>("equal_from_to_ordered_file")),
     equal_from_type_ordered_file    (OrderedFile<3>("equal_from_type_ordered_file")),
     equal_to_type_ordered_file      (OrderedFile<3>("equal_to_type_ordered_file")),
-    equal_from_to_type_ordered_file (OrderedFile<2>("equal_from_to_type_ordered_file"))
+    equal_from_to_type_ordered_file (OrderedFile<2>("equal_from_to_type_ordered_file")),
+    threads                         (threads > 0 ? threads : 1),
+    sorted_strings                  (sorted_strings)
 {
     import_file = ifstream(filename);
     import_file.unsetf(std::ios::skipws);
@@ -40,6 +47,9 @@ BulkImport::BulkImport(const string& filename, QuadModel& model) :
 
 void BulkImport::start_import() {
     auto start = chrono::system_clock::now();
+    if (sorted_strings) {
+        write_sorted_strings();
+    }
     auto line_number = 1;
     std::cout << "Reading files & writing ordered file...\n";
 
@@ -110,28 +120,54 @@ void BulkImport::start_import() {
 
     std::cout << "Creating indexes...\n";
 
-    std::vector<thread> threads;
-
-    // // We can paralelize the indexing if they use different OrderedFiles
-    // threads.push_back( thread(&BulkImport::index_labels, this) );
-    // threads.push_back( thread(&BulkImport::index_properties, this) );
-    // threads.push_back( thread(&BulkImport::index_connections, this) );
-    // threads.push_back( thread(&BulkImport::index_special_cases, this) );
-
-    // for (auto& thread : threads) {
-    //     thread.join();
-    // }
-
-    // Index nodes
-    nodes_ordered_file.order(std::array<uint_fast8_t, 1 >{ 0 });
-    model.nodes->bulk_import(nodes_ordered_file);
+    // indexes that take longer go first
+    std::vector<void (BulkImport::*)()> index_tasks = {
+        &BulkImport::index_connections_from_to,
+        &BulkImport::index_connections_type,
+        &BulkImport::index_properties,
+        &BulkImport::index_labels,
+        &BulkImport::index_nodes,
+        &BulkImport::index_equal_from_to,
+        &BulkImport::index_equal_from_type,
+        &BulkImport::index_equal_to_type,
+        &BulkImport::index_equal_from_to_type,
+    };
+
+    // Each worker creates one index at a time, the threads left are used to order the files. The merges of
+    // concurrent orders share half of the shared buffer.
+    const uint_fast32_t workers = std::min<uint_fast32_t>(threads, index_tasks.size());
+    order_threads      = std::max<uint_fast32_t>(1, threads / workers);
+    order_buffer_pages = buffer_manager.get_shared_buffer_pool_size() / (2*workers);
+
+    std::atomic<uint_fast32_t> next_task(0);
+    std::exception_ptr task_exception = nullptr;
+    std::mutex task_exception_mutex;
+
+    auto worker = [&] {
+        for (auto t = next_task++; t < index_tasks.size(); t = next_task++) {
+            try {
+                (this->*index_tasks[t])();
+            } catch (...) {
+                std::lock_guard<std::mutex> lck(task_exception_mutex);
+                task_exception = std::current_exception();
+                next_task = index_tasks.size();
+            }
+        }
+    };
 
-    catalog.distinct_labels = catalog.label2total_count.size();
+    std::vector<thread> worker_threads;
+    for (uint_fast32_t i = 1; i < workers; i++) {
+        worker_threads.push_back(thread(worker));
+    }
+    worker();
+    for (auto& worker_thread : worker_threads) {
+        worker_thread.join();
+    }
+    if (task_exception != nullptr) {
+        std::rethrow_exception(task_exception);
+    }
 
-    index_labels();
-    index_properties();
-    index_connections();
-    index_special_cases();
+    catalog.distinct_type = catalog.type2total_count.size();
 
     catalog.save_changes();
 
@@ -143,9 +179,14 @@ void BulkImport::start_import() {
 }
 
 
-void BulkImport::index_connections() {
-    // CONNECTIONS
-    connections_ordered_file.order(std::array<uint_fast8_t, 4> { 0, 1, 2, 3 });
+void BulkImport::index_nodes() {
+    nodes_ordered_file.order(std::array<uint_fast8_t, 1> { 0 }, order_threads, order_buffer_pages);
+    model.nodes->bulk_import(nodes_ordered_file);
+}
+
+
+void BulkImport::index_connections_from_to() {
+    connections_ordered_file.order(std::array<uint_fast8_t, 4> { 0, 1, 2, 3 }, order_threads, order_buffer_pages);
     model.from_to_type_edge->bulk_import(connections_ordered_file);
 
     // set catalog.distinct_from
@@ -165,7 +206,7 @@ void BulkImport::index_connections() {
         catalog.distinct_from = distinct_from;
     }
 
-    connections_ordered_file.order(std::array<uint_fast8_t, 4> { 2, 0, 1, 3 });
+    connections_ordered_file.order(std::array<uint_fast8_t, 4> { 2, 0, 1, 3 }, order_threads, order_buffer_pages);
     model.to_type_from_edge->bulk_import(connections_ordered_file);
 
     //set catalog.distinct_to
@@ -184,64 +225,73 @@ void BulkImport::index_connections() {
         }
         catalog.distinct_to = distinct_to;
     }
+}
 
-    connections_ordered_file.order(std::array<uint_fast8_t, 4> { 2, 0, 1, 3 });
-    model.type_from_to_edge->bulk_import(connections_ordered_file);
 
-    connections_ordered_file.order(std::array<uint_fast8_t, 4> { 0, 2, 1, 3 });
-    model.type_to_from_edge->bulk_import(connections_ordered_file);
+void BulkImport::index_connections_type() {
+    type_connections_ordered_file.order(std::array<uint_fast8_t, 4> { 0, 1, 2, 3 },
+                                        order_threads,
+                                        order_buffer_pages);
+    model.type_from_to_edge->bulk_import(type_connections_ordered_file);
 
-    catalog.distinct_type = catalog.type2total_count.size();
+    type_connections_ordered_file.order(std::array<uint_fast8_t, 4> { 0, 2, 1, 3 },
+                                        order_threads,
+                                        order_buffer_pages);
+    model.type_to_from_edge->bulk_import(type_connections_ordered_file);
 }
 
 
-void BulkImport::index_special_cases() {
-    // FROM=TO
-    equal_from_to_ordered_file.order(std::array<uint_fast8_t, 3> { 0, 1, 2 });
+void BulkImport::index_equal_from_to() {
+    equal_from_to_ordered_file.order(std::array<uint_fast8_t, 3> { 0, 1, 2 }, order_threads, order_buffer_pages);
     model.equal_from_to->bulk_import(equal_from_to_ordered_file);
 
-    equal_from_to_ordered_file.order(std::array<uint_fast8_t, 3> { 1, 0, 2 });
+    equal_from_to_ordered_file.order(std::array<uint_fast8_t, 3> { 1, 0, 2 }, order_threads, order_buffer_pages);
     model.equal_from_to_inverted->bulk_import(equal_from_to_ordered_file);
 
     // calling this after inverted, so type is at pos 0
     set_distinct_type_stats(equal_from_to_ordered_file, catalog.type2equal_from_to_count);
+}
+
 
-    // FROM=TYPE
-    equal_from_type_ordered_file.order(std::array<uint_fast8_t, 3> { 0, 1, 2 });
+void BulkImport::index_equal_from_type() {
+    equal_from_type_ordered_file.order(std::array<uint_fast8_t, 3> { 0, 1, 2 }, order_threads, order_buffer_pages);
     model.equal_from_type->bulk_import(equal_from_type_ordered_file);
 
     // calling this before inverted, so type is at pos 0
     set_distinct_type_stats(equal_from_type_ordered_file, catalog.type2equal_from_type_count);
 
-    equal_from_type_ordered_file.order(std::array<uint_fast8_t, 3> { 1, 0, 2 });
+    equal_from_type_ordered_file.order(std::array<uint_fast8_t, 3> { 1, 0, 2 }, order_threads, order_buffer_pages);
     model.equal_from_type_inverted->bulk_import(equal_from_type_ordered_file);
+}
+
 
-    // TO=TYPE
-    equal_to_type_ordered_file.order(std::array<uint_fast8_t, 3> { 0, 1, 2 });
+void BulkImport::index_equal_to_type() {
+    equal_to_type_ordered_file.order(std::array<uint_fast8_t, 3> { 0, 1, 2 }, order_threads, order_buffer_pages);
     model.equal_to_type->bulk_import(equal_to_type_ordered_file);
 
     // calling this before inverted, so type is at pos 0
     set_distinct_type_stats(equal_to_type_ordered_file, catalog.type2equal_to_type_count);
 
-    equal_to_type_ordered_file.order(std::array<uint_fast8_t, 3> { 1, 0, 2 });
+    equal_to_type_ordered_file.order(std::array<uint_fast8_t, 3> { 1, 0, 2 }, order_threads, order_buffer_pages);
     model.equal_to_type_inverted->bulk_import(equal_to_type_ordered_file);
+}
 
-    // FROM=TO=TYPE
-    equal_from_to_type_ordered_file.order(std::array<uint_fast8_t, 2> { 0, 1 });
+
+void BulkImport::index_equal_from_to_type() {
+    equal_from_to_type_ordered_file.order(std::array<uint_fast8_t, 2> { 0, 1 }, order_threads, order_buffer_pages);
     model.equal_from_to_type->bulk_import(equal_from_to_type_ordered_file);
 
     set_distinct_type_stats(equal_from_to_type_ordered_file, catalog.type2equal_from_to_type_count);
-
 }
 
 
 void BulkImport::index_labels() {
     // NODE - LABEL
-    labels_ordered_file.order(std::array<uint_fast8_t, 2> { 0, 1 });
+    labels_ordered_file.order(std::array<uint_fast8_t, 2> { 0, 1 }, order_threads, order_buffer_pages);
     model.node_label->bulk_import(labels_ordered_file);
 
     // LABEL - NODE
-    labels_ordered_file.order(std::array<uint_fast8_t, 2> { 1, 0 });
+    labels_ordered_file.order(std::array<uint_fast8_t, 2> { 1, 0 }, order_threads, order_buffer_pages);
     model.label_node->bulk_import(labels_ordered_file);
 
     catalog.distinct_labels = catalog.label2total_count.size();
@@ -250,11 +300,11 @@ void BulkImport::index_labels() {
 
 void BulkImport::index_properties() {
     // OBJECT - KEY - VALUE
-    properties_ordered_file.order(std::array<uint_fast8_t, 3> { 0, 1, 2 });
+    properties_ordered_file.order(std::array<uint_fast8_t, 3> { 0, 1, 2 }, order_threads, order_buffer_pages);
     model.object_key_value->bulk_import(properties_ordered_file);
 
     // KEY - VALUE - OBJECT
-    properties_ordered_file.order(std::array<uint_fast8_t, 3> { 2, 0, 1 });
+    properties_ordered_file.order(std::array<uint_fast8_t, 3> { 2, 0, 1 }, order_threads, order_buffer_pages);
     model.key_value_object->bulk_import(properties_ordered_file);
 
     // count total properties and distinct values
@@ -333,6 +383,103 @@ void BulkImport::set_distinct_type_stats(OrderedFile<N>& ordered_file, std::map<
 
 
 
+void BulkImport::write_sorted_strings() {
+    auto start = chrono::system_clock::now();
+    std::cout << "Reading strings & writing them sorted...\n";
+
+    std::unordered_set<std::string> strings_set;
+    {
+        boost::spirit::istream_iterator file_iter( import_file );
+        boost::spirit::istream_iterator file_iter_end;
+        do {
+            import::ast::ImportLine import_line;
+            bool r = phrase_parse(file_iter, file_iter_end, import::import(), import::parser::skipper, import_line);
+            if (!r) {
+                // the error is reported when the file is read again
+                break;
+            }
+            collect_strings(import_line, strings_set);
+        } while(file_iter != file_iter_end);
+    }
+    import_file.clear();
+    import_file.seekg(0);
+
+    std::vector<std::string> strings(strings_set.begin(), strings_set.end());
+    strings_set.clear();
+    // std::string compares its chars as unsigned char, as strcmp does
+    std::sort(strings.begin(), strings.end());
+
+    uint64_t begin = 0;
+    uint64_t end   = 0;
+    for (const auto& str : strings) {
+        bool created;
+        const auto id = model.strings_hash().get_or_create_id(str, &created);
+        if (!created || id < end) {
+            throw logic_error("the sorted strings must be written before any other object");
+        }
+        if (begin == 0) {
+            begin = id;
+        }
+        end = id + str.size() + 1;
+    }
+    catalog.sorted_strings_begin = begin;
+    catalog.sorted_strings_end   = end;
+
+    auto finish = chrono::system_clock::now();
+    chrono::duration<float, milli> duration = finish - start;
+    std::cout << "  " << strings.size() << " strings written in " << duration.count() << " ms\n\n";
+}
+
+
+void BulkImport::collect_strings(const import::ast::ImportLine& import_line,
+                                 std::unordered_set<std::string>& strings)
+{
+    // string literal nodes are written between quotes, other nodes are not strings
+    auto add_node = [&](const boost::variant<std::string, bool, int64_t, float>& node_id) {
+        if (node_id.type() == typeid(std::string)) {
+            const auto& str = boost::get<std::string>(node_id);
+            if (str[0] == '"') {
+                strings.insert(str.substr(1, str.size() - 2));
+            }
+        }
+    };
+    auto add_properties = [&](const std::vector<common::ast::Property>& properties) {
+        for (auto& property : properties) {
+            strings.insert(property.key);
+            if (property.value.type() == typeid(std::string)) {
+                strings.insert(boost::get<std::string>(property.value));
+            }
+        }
+    };
+
+    if (import_line.type() == typeid(import::ast::Node)) {
+        const auto& node = boost::get<import::ast::Node>(import_line);
+        add_node(node.name);
+        for (auto& label : node.labels) {
+            strings.insert(label);
+        }
+        add_properties(node.properties);
+    }
+    else if (import_line.type() == typeid(import::ast::Edge)) {
+        const auto& edge = boost::get<import::ast::Edge>(import_line);
+        add_node(edge.lhs_id);
+        add_node(edge.rhs_id);
+        for (auto& type : edge.labels) {
+            add_node(type);
+        }
+        add_properties(edge.properties);
+    }
+    else if (import_line.type() == typeid(import::ast::ImplicitEdge)) {
+        const auto& edge = boost::get<import::ast::ImplicitEdge>(import_line);
+        add_node(edge.rhs_id);
+        for (auto& type : edge.labels) {
+            add_node(type);
+        }
+        add_properties(edge.properties);
+    }
+}
+
+
 uint64_t BulkImport::get_node_id(const boost::variant<std::string, bool, int64_t, float>& node_id) {
     return boost::apply_visitor(*this, node_id);
 }
@@ -451,6 +598,7 @@ uint64_t BulkImport::create_connection(const uint64_t from_id, const uint64_t to
     }
 
     connections_ordered_file.append_record(std::array<uint64_t, 4> { from_id, to_id, type_id, edge_id });
+    type_connections_ordered_file.append_record(std::array<uint64_t, 4> { type_id, from_id, to_id, edge_id });
     model.edge_table->append_record(std::array<uint64_t, 3> { from_id, to_id, type_id });
 
     return edge_id;
@@ -16,7 +16,12 @@
 
 class BulkImport : public boost::static_visitor<uint64_t> {
 public:
-    BulkImport(const std::string& filename, QuadModel& model);
+    // `threads` is the number of threads used to create the indexes. If `sorted_strings` is true the import file
+    // is read twice: first to write all the strings in order into the object file (see write_sorted_strings)
+    BulkImport(const std::string& filename,
+               QuadModel& model,
+               uint_fast32_t threads = 1,
+               bool sorted_strings = false);
     ~BulkImport() = default;
 
     void start_import();
@@ -36,12 +41,24 @@ private:
     OrderedFile<3> properties_ordered_file;         // (object_id, key_id, value_id)
     OrderedFile<4> connections_ordered_file;        // (from_id, to_id, type_id, edge_id)
 
+    // The connections are written twice so the permutations starting with the type are created concurrently
+    // with the permutations starting with from and to
+    OrderedFile<4> type_connections_ordered_file;   // (type_id, from_id, to_id, edge_id)
+
     // To create indexes for special cases
     OrderedFile<3> equal_from_to_ordered_file;      // (from=to, type, edge)
     OrderedFile<3> equal_from_type_ordered_file;    // (from=type, to, edge)
     OrderedFile<3> equal_to_type_ordered_file;      // (to=type, from, edge)
     OrderedFile<2> equal_from_to_type_ordered_file; // (from=to=type,  edge)
 
+    const uint_fast32_t threads;
+
+    const bool sorted_strings;
+
+    // threads and buffer pages each index can use to order its file, set in start_import
+    uint_fast32_t order_threads;
+    uint_fast32_t order_buffer_pages;
+
     std::unordered_set<uint64_t> named_node_ids;
     // std::unordered_set<uint64_t> inlined_ids;
     // std::unordered_set<uint64_t> external_ids;
@@ -54,13 +71,29 @@ private:
 
     uint64_t get_node_id(const boost::variant<std::string, bool, int64_t, float>& node_id);
 
+    // Reads the import file collecting the strings (labels, keys, string values and string literal nodes) and
+    // writes them sorted and without repetitions into the object file, before any other object. Then the ids
+    // of the strings have the same order as the strings, and their range is saved in the catalog.
+    // All the strings are kept in memory until they are written
+    void write_sorted_strings();
+
+    // adds the strings of a line of the import file to `strings`
+    static void collect_strings(const import::ast::ImportLine& import_line,
+                                std::unordered_set<std::string>& strings);
+
     template <std::size_t N>
     void set_distinct_type_stats(OrderedFile<N>& ordered_file, std::map<uint64_t, uint64_t>& m);
 
+    // each index_* function uses a different OrderedFile, so they can run concurrently
+    void index_nodes();
     void index_labels();
     void index_properties();
-    void index_connections();
-    void index_special_cases();
+    void index_connections_from_to();
+    void index_connections_type();
+    void index_equal_from_to();
+    void index_equal_from_type();
+    void index_equal_to_type();
+    void index_equal_from_to_type();
 };
 
 #endif // RELATIONAL_MODEL__QUAD_BULK_IMPORT_H_
@@ -1,6 +1,9 @@
 #include "quad_catalog.h"
 
 #include <iostream>
+#include <stdexcept>
+
+#include "storage/page.h"
 
 using namespace std;
 
@@ -25,6 +28,11 @@ QuadCatalog::QuadCatalog(const std::string& filename) :
         equal_from_type_count    = 0;
         equal_to_type_count      = 0;
         equal_from_to_type_count = 0;
+
+        page_size                = Page::MDB_PAGE_SIZE;
+
+        sorted_strings_begin     = 0;
+        sorted_strings_end       = 0;
     }
     else {
         start_io();
@@ -97,6 +105,25 @@ QuadCatalog::QuadCatalog(const std::string& filename) :
             auto count = read_uint64();
             type2equal_to_type_count.insert({ type, count });
         }
+
+        // catalogs written before the page size was saved end here, they always used pages of 4KB
+        page_size = read_uint64();
+        if (!check_no_error_flags()) {
+            page_size = 4096;
+        }
+        if (page_size != Page::MDB_PAGE_SIZE) {
+            throw std::runtime_error("The database was created with pages of " + std::to_string(page_size)
+                                     + " bytes, but this build uses pages of "
+                                     + std::to_string(Page::MDB_PAGE_SIZE) + " bytes (see MDB_PAGE_SIZE).");
+        }
+
+        // catalogs written before the sorted strings end here
+        sorted_strings_begin = read_uint64();
+        sorted_strings_end   = read_uint64();
+        if (!check_no_error_flags()) {
+            sorted_strings_begin = 0;
+            sorted_strings_end   = 0;
+        }
     }
 
 }
@@ -166,6 +193,11 @@ void QuadCatalog::save_changes() {
         write_uint64(k);
         write_uint64(v);
     }
+
+    write_uint64(page_size);
+
+    write_uint64(sorted_strings_begin);
+    write_uint64(sorted_strings_end);
 }
 
 
@@ -189,6 +221,8 @@ void QuadCatalog::print() {
     cout << "  equal_from_type_count:    " << equal_from_type_count    << "\n";
     cout << "  equal_to_type_count:      " << equal_to_type_count      << "\n";
     cout << "  equal_from_to_type_count: " << equal_from_to_type_count << "\n";
+    cout << "  page size:                " << page_size                << "\n";
+    cout << "  sorted strings:           " << (sorted_strings_end > 0 ? "yes" : "no") << "\n";
     cout << "-------------------------------------\n";
 }
 
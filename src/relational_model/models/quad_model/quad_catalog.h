@@ -47,6 +47,14 @@ public:
     uint64_t equal_to_type_count;
     uint64_t equal_from_to_type_count;
 
+    // size of the pages the database was created with, must be equal to Page::MDB_PAGE_SIZE
+    uint64_t page_size;
+
+    // positions of the object file where the sorted strings begin and end, both are 0 if the database was
+    // created without sorted strings (see BulkImport)
+    uint64_t sorted_strings_begin;
+    uint64_t sorted_strings_end;
+
     std::map<uint64_t, uint64_t> label2total_count;
     std::map<uint64_t, uint64_t> key2total_count;
     std::map<uint64_t, uint64_t> key2distinct;
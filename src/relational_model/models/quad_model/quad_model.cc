@@ -16,15 +16,19 @@
 using namespace std;
 
 PathPrinter* Path::path_printer = nullptr;
+const char* StringExternal::sorted_begin = nullptr;
+const char* StringExternal::sorted_end   = nullptr;
 
 
 QuadModel::QuadModel(const std::string& db_folder,
                      uint_fast32_t shared_buffer_pool_size,
                      uint_fast32_t private_buffer_pool_size,
-                     uint_fast32_t max_threads)
+                     uint_fast32_t max_threads,
+                     bool read_only,
+                     const BufferMemoryOptions& memory_options)
 {
-    FileManager::init(db_folder);
-    BufferManager::init(shared_buffer_pool_size, private_buffer_pool_size, max_threads);
+    FileManager::init(db_folder, read_only);
+    BufferManager::init(shared_buffer_pool_size, private_buffer_pool_size, max_threads, memory_options);
     PathManager::init(*this, max_threads);
 
     new (&catalog())       QuadCatalog("catalog.dat");                    // placement new
@@ -33,6 +37,16 @@ QuadModel::QuadModel(const std::string& db_folder,
 
     Path::path_printer = &path_manager;
 
+    if (object_file().is_compressed()) {
+        // objects are decompressed into a buffer of the thread, the cache keeps the copies used by the queries.
+        // Sorted strings are compared with strcmp because their copies aren't in order in memory
+        object_cache = make_unique<ObjectCache>(ObjectCache::DEFAULT_MAX_BYTES);
+    } else if (has_sorted_strings()) {
+        StringExternal::sorted_begin = object_file().read(catalog().sorted_strings_begin);
+        StringExternal::sorted_end   = StringExternal::sorted_begin
+                                       + (catalog().sorted_strings_end - catalog().sorted_strings_begin);
+    }
+
     nodes = make_unique<BPlusTree<1>>("nodes");
     edge_table = make_unique<RandomAccessTable<3>>("edges.table");
 
@@ -60,6 +74,11 @@ QuadModel::QuadModel(const std::string& db_folder,
 
 
 QuadModel::~QuadModel() {
+    StringExternal::sorted_begin = nullptr;
+    StringExternal::sorted_end   = nullptr;
+
+    object_cache.reset();
+
     // Must destroy everything before buffer and file manager
     strings_hash().~ObjectFileHash();
     object_file().~ObjectFile();
@@ -94,7 +113,53 @@ QuadModel::~QuadModel() {
 }
 
 
+uint_fast32_t QuadModel::cache_directories(uint_fast32_t levels) {
+    uint_fast32_t cached_pages = 0;
+    cached_pages += nodes->load_dir_cache(levels);
+
+    cached_pages += label_node->load_dir_cache(levels);
+    cached_pages += node_label->load_dir_cache(levels);
+
+    cached_pages += object_key_value->load_dir_cache(levels);
+    cached_pages += key_value_object->load_dir_cache(levels);
+
+    cached_pages += from_to_type_edge->load_dir_cache(levels);
+    cached_pages += to_type_from_edge->load_dir_cache(levels);
+    cached_pages += type_from_to_edge->load_dir_cache(levels);
+    cached_pages += type_to_from_edge->load_dir_cache(levels);
+
+    cached_pages += equal_from_to->load_dir_cache(levels);
+    cached_pages += equal_from_type->load_dir_cache(levels);
+    cached_pages += equal_to_type->load_dir_cache(levels);
+    cached_pages += equal_from_to_type->load_dir_cache(levels);
+
+    cached_pages += equal_from_to_inverted->load_dir_cache(levels);
+    cached_pages += equal_from_type_inverted->load_dir_cache(levels);
+    cached_pages += equal_to_type_inverted->load_dir_cache(levels);
+    return cached_pages;
+}
+
+
+void QuadModel::cache_objects(uint64_t max_bytes) {
+    object_cache = make_unique<ObjectCache>(max_bytes);
+}
+
+
+const char* QuadModel::read_object(uint64_t id) const {
+    if (object_cache == nullptr) {
+        return object_file().read(id);
+    }
+    auto cached = object_cache->get(id);
+    if (cached != nullptr) {
+        return cached;
+    }
+    return object_cache->insert(id, object_file().read(id));
+}
+
+
 std::unique_ptr<BindingIter> QuadModel::exec(OpSelect& op_select, ThreadInfo* thread_info) const {
+    // the optimizer may print constants of the query, the Match created keeps its own reader
+    ObjectCache::Reader cache_reader(object_cache.get());
     auto vars = op_select.get_vars();
     auto query_optimizer = BindingIterVisitor(*this, std::move(vars), thread_info);
     return query_optimizer.exec(op_select);
@@ -112,7 +177,11 @@ GraphObject QuadModel::get_graph_object(ObjectId object_id) const {
     auto unmasked_id = object_id.id & VALUE_MASK;
     switch (mask) {
         case VALUE_EXTERNAL_STR_MASK : {
-            const char* str = object_file().read(unmasked_id);
+            const char* str = read_object(unmasked_id);
+            if (has_sorted_strings()) {
+                // short strings are external too, but they must be equal to the inlined strings of the queries
+                return GraphObject::make_string(str);
+            }
             return GraphObject::make_string_external(str);
         }
 
@@ -159,7 +228,7 @@ GraphObject QuadModel::get_graph_object(ObjectId object_id) const {
         }
 
         case IDENTIFIABLE_EXTERNAL_MASK : {
-            const char* str = object_file().read(unmasked_id);
+            const char* str = read_object(unmasked_id);
             return GraphObject::make_identifiable_external(str);
         }
 
@@ -212,6 +281,14 @@ GraphObject QuadModel::get_property_value(GraphObject& obj, const ObjectId key)
 }
 
 
+bool QuadModel::is_ordered_id(ObjectId object_id) const {
+    const auto unmasked_id = object_id.id & VALUE_MASK;
+    return (object_id.id & TYPE_MASK) == VALUE_EXTERNAL_STR_MASK
+           && unmasked_id >= catalog().sorted_strings_begin
+           && unmasked_id < catalog().sorted_strings_end;
+}
+
+
 ObjectId QuadModel::get_object_id(const GraphObject& graph_object) const {
     return std::visit(GraphObjectVisitor(*this, false), graph_object.value);
 }
@@ -6,8 +6,10 @@
 
 #include "base/graph/graph_model.h"
 #include "relational_model/models/quad_model/quad_catalog.h"
+#include "storage/buffer_memory.h"
 #include "storage/index/bplus_tree/bplus_tree.h"
 #include "storage/index/hash/object_file_hash/object_file_hash.h"
+#include "storage/index/object_file/object_cache.h"
 #include "storage/index/object_file/object_file.h"
 #include "storage/index/random_access_table/random_access_table.h"
 
@@ -38,12 +40,30 @@ public:
     std::unique_ptr<BPlusTree<3>> equal_from_type_inverted; // (to,   from=type, edge)
     std::unique_ptr<BPlusTree<3>> equal_to_type_inverted;   // (from, to=type,   edge)
 
+    // copies of the external strings and identifiers materialized by the queries, nullptr if it's disabled.
+    // It's always enabled when the object file is compressed. Queries must use it inside an
+    // ObjectCache::Reader (see Match)
+    std::unique_ptr<ObjectCache> object_cache;
+
+    // threads used by the LeapfrogJoin of the main pattern of a query (see ParallelLeapfrogJoin), 1 disables it
+    uint_fast32_t leapfrog_threads = 1;
+
     QuadModel(const std::string& db_folder,
               uint_fast32_t shared_buffer_pool_size,
               uint_fast32_t private_buffer_pool_size,
-              uint_fast32_t max_threads);
+              uint_fast32_t max_threads,
+              bool read_only = false,
+              const BufferMemoryOptions& memory_options = BufferMemoryOptions());
     ~QuadModel();
 
+    // keeps the first `levels` levels of the directory of every B+tree in memory (see BPlusTreeDirCache).
+    // Returns the number of directory pages cached
+    uint_fast32_t cache_directories(uint_fast32_t levels);
+
+    // keeps up to `max_bytes` of the external objects materialized by get_graph_object in memory,
+    // shared by all the queries (see ObjectCache). Replaces the default cache of a compressed object file
+    void cache_objects(uint64_t max_bytes);
+
     std::unique_ptr<BindingIter> exec(OpSelect&, ThreadInfo*) const override;
     // std::unique_ptr<BindingIter> exec(manual_plan::ast::ManualRoot&) const override;
 
@@ -53,6 +73,9 @@ public:
     GraphObject get_graph_object(ObjectId) const override;
     GraphObject get_property_value(GraphObject& obj, const ObjectId key) const override;
 
+    // strings of the sorted region of the object file (see has_sorted_strings)
+    bool is_ordered_id(ObjectId) const override;
+
 
     // Methods used by bulk_import
     uint64_t get_or_create_object_id(const GraphObject&);
@@ -60,6 +83,12 @@ public:
     // WARNING: do not use for NamedNodes, only for labels, property_key and string_literal
     // uint64_t get_or_create_object_id(const std::string&);
 
+    // true if the database was created with sorted strings: every string is in the object file, and strings
+    // are there in order, so their ids are ordered as the strings (see BulkImport)
+    inline bool has_sorted_strings() const noexcept {
+        return catalog().sorted_strings_end > 0;
+    }
+
     inline QuadCatalog& catalog() const noexcept {
         return const_cast<QuadCatalog&>(reinterpret_cast<const QuadCatalog&>(catalog_buf));
     }
@@ -76,6 +105,9 @@ private:
     typename std::aligned_storage<sizeof(QuadCatalog),    alignof(QuadCatalog)>::type    catalog_buf;
     typename std::aligned_storage<sizeof(ObjectFile),     alignof(ObjectFile)>::type     object_file_buf;
     typename std::aligned_storage<sizeof(ObjectFileHash), alignof(ObjectFileHash)>::type strings_cache_buf;
+
+    // reads an external object, from the object cache if it's enabled
+    const char* read_object(uint64_t id) const;
 };
 
 #endif // RELATIONAL_MODEL__QUAD_MODEL_H_
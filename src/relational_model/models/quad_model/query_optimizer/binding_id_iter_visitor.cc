@@ -12,6 +12,7 @@
 #include "base/parser/logical_plan/op/op_path_kleene_star.h"
 #include "base/parser/logical_plan/op/op_path_optional.h"
 
+#include "relational_model/execution/binding_id_iter/exchange.h"
 #include "relational_model/execution/binding_id_iter/optional_node.h"
 #include "relational_model/execution/binding_id_iter/empty_binding_id_iter.h"
 #include "relational_model/execution/binding_id_iter/single_result_binding_id_iter.h"
@@ -33,10 +34,12 @@ constexpr auto MAX_SELINGER_PLANS = 0;
 
 BindingIdIterVisitor::BindingIdIterVisitor(const QuadModel& model,
                                            const map<Var, VarId>& var2var_id,
-                                           ThreadInfo* thread_info) :
-    model       (model),
-    var2var_id  (var2var_id),
-    thread_info (thread_info) { }
+                                           ThreadInfo* thread_info,
+                                           bool preserve_order) :
+    model          (model),
+    var2var_id     (var2var_id),
+    thread_info    (thread_info),
+    preserve_order (preserve_order) { }
 
 
 VarId BindingIdIterVisitor::get_var_id(const Var& var) {
@@ -174,6 +177,7 @@ void BindingIdIterVisitor::visit(OpBasicGraphPattern& op_basic_graph_pattern) {
     }
 
     for (auto& property_path : op_basic_graph_pattern.property_paths) {
+        has_property_paths = true;
         auto from_id = property_path.from.is_var()
                     ? (Id) get_var_id(property_path.from.to_var())
                     : (Id) model.get_object_id(property_path.from.to_graph_object());
@@ -211,7 +215,10 @@ void BindingIdIterVisitor::visit(OpBasicGraphPattern& op_basic_graph_pattern) {
 
     // try to use leapfrog if there is a join
     if (base_plans.size() > 1) {
-        tmp = LeapfrogOptimizer::try_get_iter(thread_info, base_plans, var_names, binding_size);
+        // a join inside an OPTIONAL is reset for each binding of its parent (even if it doesn't share
+        // variables with it), so it runs in the thread of the query
+        const auto threads = assigned_vars.empty() && !in_optional ? model.leapfrog_threads : 1;
+        tmp = LeapfrogOptimizer::try_get_iter(thread_info, base_plans, var_names, binding_size, threads);
     }
 
     if (tmp == nullptr) {
@@ -227,7 +234,21 @@ void BindingIdIterVisitor::visit(OpBasicGraphPattern& op_basic_graph_pattern) {
         root_plan->print(std::cout, true, var_names);
         std::cout << "\nestimated cost: " << root_plan->estimate_cost() << "\n";
 
-        tmp = root_plan->get_binding_id_iter(thread_info);
+        // the outermost scan of a pattern that runs once (not inside an OPTIONAL) can be divided between workers.
+        // Paths are not materialized in the binding, so they can't be copied from a worker
+        const auto workers = Exchange::get_max_workers();
+        const auto plan_vars = root_plan->get_vars();
+        if (workers > 0 && assigned_vars.empty() && !in_optional && !has_property_paths && !plan_vars.empty()) {
+            vector<unique_ptr<BindingIdIter>> pipelines;
+            for (uint_fast32_t i = 0; i <= workers; i++) {
+                pipelines.push_back(root_plan->get_binding_id_iter(thread_info));
+            }
+            tmp = make_unique<Exchange>(move(pipelines),
+                                        vector<VarId>(plan_vars.begin(), plan_vars.end()),
+                                        preserve_order);
+        } else {
+            tmp = root_plan->get_binding_id_iter(thread_info);
+        }
     }
 
     // insert new assigned_vars
@@ -248,11 +269,14 @@ void BindingIdIterVisitor::visit(OpOptional& op_optional) {
     // support well designed patterns. If we want to support non well designed patterns this could change
     // auto current_scope_assigned_vars = assigned_vars;
 
+    const auto parent_in_optional = in_optional;
+    in_optional = true;
     for (auto& optional : op_optional.optionals) {
         optional->accept_visitor(*this);
         optional_children.push_back(move(tmp));
         // assigned_vars = current_scope_assigned_vars;
     }
+    in_optional = parent_in_optional;
 
     assert(tmp == nullptr);
     tmp = make_unique<OptionalNode>(move(binding_id_iter), move(optional_children));
@@ -22,7 +22,10 @@ class BindingIdIter;
 
 class BindingIdIterVisitor : public OpVisitor {
 public:
-    BindingIdIterVisitor(const QuadModel& model, const std::map<Var, VarId>& var2var_id, ThreadInfo* thread_info);
+    BindingIdIterVisitor(const QuadModel&             model,
+                         const std::map<Var, VarId>& var2var_id,
+                         ThreadInfo*                 thread_info,
+                         bool                        preserve_order = false);
     ~BindingIdIterVisitor() = default;
 
     const QuadModel& model;
@@ -32,6 +35,16 @@ public:
     std::set<VarId> assigned_vars;
     ThreadInfo* thread_info;
 
+    // true if a visited pattern has property paths
+    bool has_property_paths = false;
+
+    // results must be returned in the order of the plan when its outermost scan is divided between workers
+    // (e.g. a LIMIT without ORDER BY chooses the first results)
+    const bool preserve_order;
+
+    // true while visiting the optional children of an OPTIONAL, they are reset for each binding of the parent
+    bool in_optional = false;
+
     // After visiting an Op, the result must be written into tmp
     std::unique_ptr<BindingIdIter> tmp;
 
@@ -78,6 +78,7 @@ void BindingIterVisitor::visit(OpSelect& op_select) {
         }
     }
 
+    preserve_order = op_select.limit != UINT64_MAX;
     op_select.op->accept_visitor(*this);
     tmp = make_unique<Select>(move(tmp), move(projection_vars), op_select.limit);
 }
@@ -107,7 +108,7 @@ void BindingIterVisitor::visit(OpWhere& op_where) {
 
 
 void BindingIterVisitor::visit(OpMatch& op_match) {
-    BindingIdIterVisitor id_visitor(model, var2var_id, thread_info);
+    BindingIdIterVisitor id_visitor(model, var2var_id, thread_info, preserve_order);
     op_match.op->accept_visitor(id_visitor);
 
     unique_ptr<BindingIdIter> binding_id_iter_current_root = move(id_visitor.tmp);
@@ -146,7 +147,15 @@ void BindingIterVisitor::visit(OpMatch& op_match) {
         binding_id_iter_current_root = make_unique<DistinctIdHash>(move(binding_id_iter_current_root), move(projected_var_ids));
     }
 
-    tmp = make_unique<Match>(model, move(binding_id_iter_current_root), binding_size);
+    // paths that are not materialized are only valid until the next binding_id, so they are read one at a time
+    const auto batch_size = id_visitor.has_property_paths && !need_materialize_paths
+                            ? 1 : BindingIdBatch::DEFAULT_CAPACITY;
+
+    tmp = make_unique<Match>(model,
+                             move(binding_id_iter_current_root),
+                             binding_size,
+                             batch_size,
+                             model.object_cache.get());
 }
 
 
@@ -175,8 +184,16 @@ void BindingIterVisitor::visit(OpOrderBy& op_order_by) {
     // e.g. if we have SELECT DISTINCT ?x, ?y ... ORDER BY ?x, ?z, ?y we can't use DistinctOrdered
     // distinct_ordered_possible = true;
 
+    // the order of MATCH doesn't matter if all the results are sorted
+    preserve_order = false;
     op_order_by.op->accept_visitor(*this);
-    tmp = make_unique<OrderBy>(thread_info, move(tmp), saved_vars, order_vars, op_order_by.ascending_order);
+    tmp = make_unique<OrderBy>(thread_info,
+                               model,
+                               move(tmp),
+                               saved_vars,
+                               order_vars,
+                               op_order_by.ascending_order,
+                               model.has_sorted_strings());
 }
 
 
@@ -37,6 +37,9 @@ public:
 
     bool distinct_ordered_possible = false;
 
+    // set by a LIMIT without ORDER BY, the results of MATCH must keep the order of the plan
+    bool preserve_order = false;
+
     BindingIterVisitor(const QuadModel& model, std::set<Var> var_names, ThreadInfo* thread_info);
     ~BindingIterVisitor() = default;
 
@@ -4,13 +4,15 @@
 
 #include "storage/index/bplus_tree/leapfrog_iter.h"
 #include "relational_model/execution/binding_id_iter/leapfrog_join.h"
+#include "relational_model/execution/binding_id_iter/parallel_leapfrog_join.h"
 
 using namespace std;
 
 unique_ptr<BindingIdIter> LeapfrogOptimizer::try_get_iter(ThreadInfo* thread_info,
                                                           const vector<unique_ptr<Plan>>& base_plans,
                                                           const vector<string>& var_names,
-                                                          const size_t binding_size)
+                                                          const size_t binding_size,
+                                                          const uint_fast32_t threads)
 {
     map<VarId, vector<Plan*>> var2plans;
     map<VarId, pair<double, std::size_t>> var2cost;
@@ -103,15 +105,27 @@ unique_ptr<BindingIdIter> LeapfrogOptimizer::try_get_iter(ThreadInfo* thread_inf
     cout << " ]\n";
 
     // Segunda pasada ahora si creando los LFIters
-    vector<unique_ptr<LeapfrogIter>> leapfrog_iters;
-    for (const auto& plan : base_plans) {
-        auto lf_iter = plan->get_leapfrog_iter(thread_info, var_order, enumeration_level);
-        if (lf_iter == nullptr) {
-            return nullptr;
-        } else {
-            leapfrog_iters.push_back(move(lf_iter));
+    auto get_join = [&]() -> unique_ptr<LeapfrogJoin> {
+        vector<unique_ptr<LeapfrogIter>> leapfrog_iters;
+        for (const auto& plan : base_plans) {
+            auto lf_iter = plan->get_leapfrog_iter(thread_info, var_order, enumeration_level);
+            if (lf_iter == nullptr) {
+                return nullptr;
+            } else {
+                leapfrog_iters.push_back(move(lf_iter));
+            }
         }
-    }
+        return make_unique<LeapfrogJoin>(move(leapfrog_iters), var_order, enumeration_level);
+    };
 
-    return make_unique<LeapfrogJoin>(move(leapfrog_iters), move(var_order), enumeration_level);
+    auto join = get_join();
+    // the morsels are ranges of keys of the first variable, so it must be an intersection variable
+    if (join == nullptr || threads <= 1 || enumeration_level == 0) {
+        return join;
+    }
+    vector<unique_ptr<LeapfrogJoin>> worker_joins;
+    for (uint_fast32_t i = 0; i < threads; i++) {
+        worker_joins.push_back(get_join());
+    }
+    return make_unique<ParallelLeapfrogJoin>(move(join), move(worker_joins), move(var_order));
 }
\ No newline at end of file
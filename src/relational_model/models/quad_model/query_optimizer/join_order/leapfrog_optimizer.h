@@ -17,12 +17,14 @@
 */
 class LeapfrogOptimizer {
 public:
-    // may return nullptr if leapfrog is not possible
+    // may return nullptr if leapfrog is not possible.
+    // With more than 1 thread the join is a ParallelLeapfrogJoin, unless every variable is an enumeration variable
     static std::unique_ptr<BindingIdIter> try_get_iter(
         ThreadInfo* thread_info,
         const std::vector<std::unique_ptr<Plan>>& base_plans,
         const std::vector<std::string>& var_names,
-        const std::size_t binding_size);
+        const std::size_t binding_size,
+        const uint_fast32_t threads = 1);
 };
 
 #endif // QUAD_MODEL__LEAPFROG_OPTIMIZER_H_
@@ -153,7 +153,14 @@ double ConnectionPlan::estimate_output_size() const {
             }
         }
     } // end special cases
-    else if (type_assigned) {
+    if (!has_assigned_variables()) {
+        // only constants are assigned, the number of connections with them is known exactly
+        if (auto connections = count_connections()) {
+            return static_cast<double>(*connections);
+        }
+    }
+
+    if (type_assigned) {
         if (std::holds_alternative<ObjectId>(type)) {
             const auto connections_with_type = static_cast<double>(
                 model.catalog().connections_with_type(std::get<ObjectId>(type).id)
@@ -204,6 +211,38 @@ double ConnectionPlan::estimate_output_size() const {
 }
 
 
+bool ConnectionPlan::has_assigned_variables() const {
+    return (from_assigned && std::holds_alternative<VarId>(from))
+        || (to_assigned   && std::holds_alternative<VarId>(to))
+        || (type_assigned && std::holds_alternative<VarId>(type));
+}
+
+
+std::optional<uint64_t> ConnectionPlan::count_connections() const {
+    // no B+tree starts with the edge
+    if (edge_assigned) {
+        return std::nullopt;
+    }
+    if (from_assigned) {
+        if (to_assigned) {
+            return type_assigned ? count_prefix(*model.from_to_type_edge, { from, to, type })
+                                 : count_prefix(*model.from_to_type_edge, { from, to });
+        } else {
+            return type_assigned ? count_prefix(*model.type_from_to_edge, { type, from })
+                                 : count_prefix(*model.from_to_type_edge, { from });
+        }
+    } else {
+        if (to_assigned) {
+            return type_assigned ? count_prefix(*model.type_to_from_edge, { type, to })
+                                 : count_prefix(*model.to_type_from_edge, { to });
+        } else {
+            return type_assigned ? count_prefix(*model.type_from_to_edge, { type })
+                                 : count_prefix(*model.from_to_type_edge, { });
+        }
+    }
+}
+
+
 void ConnectionPlan::set_input_vars(const std::set<VarId>& input_vars) {
     set_input_var(input_vars, from, &from_assigned);
     set_input_var(input_vars, to,   &to_assigned);
@@ -49,6 +49,12 @@ private:
     bool to_assigned;
     bool type_assigned;
     bool edge_assigned;
+
+    // true if some of the assigned terms is a variable, whose value is only known when the plan is executed
+    bool has_assigned_variables() const;
+
+    // number of connections matching the assigned terms, which must be constants. nullopt if it's unknown
+    std::optional<uint64_t> count_connections() const;
 };
 
 #endif // QUAD_MODEL__CONNECTION_PLAN_H_
@@ -55,6 +55,21 @@ double LabelPlan::estimate_output_size() const {
         return 0;
     }
 
+    if (!has_assigned_variables()) {
+        // only constants are assigned, the number of labels with them is known exactly
+        std::optional<uint64_t> labels;
+        if (node_assigned) {
+            labels = label_assigned ? count_prefix(*model.node_label, { node, label })
+                                    : count_prefix(*model.node_label, { node });
+        } else {
+            labels = label_assigned ? count_prefix(*model.label_node, { label })
+                                    : count_prefix(*model.label_node, { });
+        }
+        if (labels) {
+            return static_cast<double>(*labels);
+        }
+    }
+
     if (label_assigned) {
         // nodes with label `label_id`
         double label_count;
@@ -80,6 +95,12 @@ double LabelPlan::estimate_output_size() const {
 }
 
 
+bool LabelPlan::has_assigned_variables() const {
+    return (node_assigned  && std::holds_alternative<VarId>(node))
+        || (label_assigned && std::holds_alternative<VarId>(label));
+}
+
+
 void LabelPlan::set_input_vars(const std::set<VarId>& input_vars) {
     set_input_var(input_vars, node, &node_assigned);
     set_input_var(input_vars, label, &label_assigned);
@@ -42,6 +42,9 @@ private:
 
     bool node_assigned;
     bool label_assigned;
+
+    // true if some of the assigned terms is a variable, whose value is only known when the plan is executed
+    bool has_assigned_variables() const;
 };
 
 #endif // RELATIONAL_MODEL__LABEL_PLAN_H_
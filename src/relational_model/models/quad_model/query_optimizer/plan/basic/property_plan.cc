@@ -63,6 +63,29 @@ double PropertyPlan::estimate_output_size() const {
 
     assert((key_assigned || !value_assigned) && "fixed values with open key is not supported");
 
+    if (!has_assigned_variables()) {
+        // only constants are assigned, the number of properties with them is known exactly
+        std::optional<uint64_t> properties;
+        if (object_assigned) {
+            if (key_assigned) {
+                properties = value_assigned ? count_prefix(*model.object_key_value, { object, key, value })
+                                            : count_prefix(*model.object_key_value, { object, key });
+            } else {
+                properties = count_prefix(*model.object_key_value, { object });
+            }
+        } else {
+            if (key_assigned) {
+                properties = value_assigned ? count_prefix(*model.key_value_object, { key, value })
+                                            : count_prefix(*model.key_value_object, { key });
+            } else {
+                properties = count_prefix(*model.key_value_object, { });
+            }
+        }
+        if (properties) {
+            return static_cast<double>(*properties);
+        }
+    }
+
     if (total_objects == 0) { // To avoid division by 0
         return 0;
     }
@@ -104,6 +127,13 @@ double PropertyPlan::estimate_output_size() const {
 }
 
 
+bool PropertyPlan::has_assigned_variables() const {
+    return (object_assigned && std::holds_alternative<VarId>(object))
+        || (key_assigned    && std::holds_alternative<VarId>(key))
+        || (value_assigned  && std::holds_alternative<VarId>(value));
+}
+
+
 void PropertyPlan::set_input_vars(const std::set<VarId>& input_vars) {
     set_input_var(input_vars, object, &object_assigned);
     set_input_var(input_vars, key,    &key_assigned);
@@ -45,6 +45,9 @@ private:
     bool object_assigned;
     bool key_assigned;
     bool value_assigned;
+
+    // true if some of the assigned terms is a variable, whose value is only known when the plan is executed
+    bool has_assigned_variables() const;
 };
 
 #endif // QUAD_MODEL__PROPERTY_PLAN_H_
@@ -1,7 +1,9 @@
 #ifndef QUAD_MODEL__PLAN_H_
 #define QUAD_MODEL__PLAN_H_
 
+#include <array>
 #include <memory>
+#include <optional>
 #include <ostream>
 #include <set>
 #include <vector>
@@ -65,6 +67,25 @@ protected:
             }
         }
     }
+
+    // number of records of `bpt` that start with the constants of `prefix`, plans use it to know their output
+    // size. It only descends the tree (see BPlusTree::count_range), so it's unknown (nullopt) when the subtree
+    // counts of `bpt` are not up to date, instead of scanning the range
+    template <std::size_t N>
+    static std::optional<uint64_t> count_prefix(const BPlusTree<N>& bpt, const std::vector<Id>& prefix) {
+        if (!bpt.has_counts()) {
+            return std::nullopt;
+        }
+        std::array<uint64_t, N> min;
+        std::array<uint64_t, N> max;
+        min.fill(0);
+        max.fill(UINT64_MAX);
+        for (std::size_t i = 0; i < prefix.size(); i++) {
+            min[i] = std::get<ObjectId>(prefix[i]).id;
+            max[i] = std::get<ObjectId>(prefix[i]).id;
+        }
+        return bpt.count_range(Record<N>(min), Record<N>(max));
+    }
 };
 
 #endif // QUAD_MODEL__PLAN_H_
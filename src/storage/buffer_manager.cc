@@ -1,7 +1,16 @@
 #include "buffer_manager.h"
 
 #include <cassert>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
 #include <new>         // placement new
+#include <sys/mman.h>
 #include <type_traits> // aligned_storage
 
 #include "storage/file_manager.h"
@@ -13,40 +22,383 @@ static typename std::aligned_storage<sizeof(BufferManager), alignof(BufferManage
 // global object
 BufferManager& buffer_manager = reinterpret_cast<BufferManager&>(buffer_manager_buf);
 
+namespace {
+
+// counters of the pages asked by each thread. Hits are only added to the counters of all threads by
+// publish_thread_hits, so finding a page in the buffer doesn't write memory shared by all the threads
+struct ThreadStats {
+    BufferStats stats;
+
+    // hits of `stats` already added to the counters of all threads, the position is the FileId
+    std::vector<uint64_t> published_hits;
+    uint64_t published_tmp_hits = 0;
+
+    // hits found by threads that end without publishing them (e.g. workers of a query) are not lost
+    ~ThreadStats() {
+        if (!stats.files.empty() || stats.tmp_files[HITS] > 0) {
+            buffer_manager.publish_thread_hits();
+        }
+    }
+};
+
+thread_local ThreadStats thread_stats;
+
+} // namespace
+
 
 BufferManager::BufferManager(uint_fast32_t shared_buffer_pool_size,
                              uint_fast32_t private_buffer_pool_size,
-                             uint_fast32_t max_threads) :
-    shared_buffer_pool_size   (shared_buffer_pool_size),
+                             uint_fast32_t max_threads,
+                             const BufferMemoryOptions& memory_options) :
+    read_only                 (file_manager.is_read_only()),
+    shared_buffer_pool_size   (read_only ? 0 : shared_buffer_pool_size),
     private_buffer_pool_size  (private_buffer_pool_size),
     max_private_buffers       (max_threads),
-    buffer_pool               (new Page[shared_buffer_pool_size]),
+    private_buffers_wanting   (0),
+    buffer_pool               (new Page[this->shared_buffer_pool_size]),
     private_buffer_pool       (new Page[private_buffer_pool_size * max_private_buffers]),
-    bytes                     (new char[shared_buffer_pool_size * Page::MDB_PAGE_SIZE]),
-    private_bytes             (new char[private_buffer_pool_size * max_private_buffers * Page::MDB_PAGE_SIZE]),
-    clock_pos                 (0)
+    bytes                     (static_cast<size_t>(this->shared_buffer_pool_size) * Page::MDB_PAGE_SIZE,
+                               memory_options),
+    private_bytes             (static_cast<size_t>(private_buffer_pool_size) * max_private_buffers
+                                   * Page::MDB_PAGE_SIZE,
+                               memory_options),
+    replacement_policy        (DEFAULT_REPLACEMENT_POLICY),
+    clock_pos                 (0),
+    read_ahead_pages          (0),
+    read_ahead_stop           (false),
+    private_pages_in_use      (0),
+    warm_up_stop              (false)
 {
+    for (auto& file_counters : counters) {
+        for (auto& counter : file_counters) {
+            counter = 0;
+        }
+    }
+    for (uint_fast32_t i = 0; i < this->shared_buffer_pool_size; i++) {
+        buffer_pool[i].bytes = &bytes.get_bytes()[i*Page::MDB_PAGE_SIZE];
+    }
     for (uint_fast32_t i=0; i < max_private_buffers; i++) {
         available_private_positions.push(i);
     }
-    private_tmp_pages.resize(max_private_buffers);
-    private_clock_pos.resize(max_private_buffers);
+    private_buffers.resize(max_private_buffers);
+
+    // free frames are taken from the back, so the first frames are used first
+    const auto private_frames = private_buffer_pool_size * max_private_buffers;
+    free_private_frames.reserve(private_frames);
+    for (uint_fast32_t i = 0; i < private_frames; i++) {
+        private_buffer_pool[i].bytes = &private_bytes.get_bytes()[i*Page::MDB_PAGE_SIZE];
+        free_private_frames.push_back(private_frames - 1 - i);
+    }
 }
 
 
 BufferManager::~BufferManager() {
+    {
+        std::lock_guard<std::mutex> lck(read_ahead_mutex);
+        read_ahead_stop = true;
+    }
+    read_ahead_cv.notify_all();
+    for (auto& thread : read_ahead_threads) {
+        thread.join();
+    }
+    warm_up_stop = true;
+    if (warm_up_thread.joinable()) {
+        warm_up_thread.join();
+    }
+    // so the calling thread doesn't publish them when it ends and the buffer manager doesn't exist
+    publish_thread_hits();
     flush();
-    delete[](bytes);
-    delete[](buffer_pool);
 }
 
 
 void BufferManager::init(uint_fast32_t shared_buffer_pool_size,
                          uint_fast32_t private_buffer_pool_size,
-                         uint_fast32_t max_threads)
+                         uint_fast32_t max_threads,
+                         const BufferMemoryOptions& memory_options)
 {
     // placement new
-    new (&buffer_manager) BufferManager(shared_buffer_pool_size, private_buffer_pool_size, max_threads);
+    new (&buffer_manager) BufferManager(shared_buffer_pool_size, private_buffer_pool_size, max_threads,
+                                        memory_options);
+}
+
+
+void BufferManager::start_read_ahead(uint_fast32_t read_ahead_pages) {
+    assert(read_ahead_threads.empty());
+    this->read_ahead_pages = read_ahead_pages;
+    // in read-only mode the kernel reads the pages, there is nothing to do for the threads
+    if (read_ahead_pages == 0 || read_only) {
+        return;
+    }
+    for (uint_fast32_t i = 0; i < READ_AHEAD_THREADS; i++) {
+        read_ahead_threads.emplace_back(&BufferManager::read_ahead_worker, this);
+    }
+}
+
+
+void BufferManager::save_page_list() {
+    if (read_only) {
+        return;
+    }
+    std::map<uint_fast32_t, std::vector<uint32_t>> file_pages;
+    for (auto& partition : page_table) {
+        std::lock_guard<std::mutex> lck(partition.mutex);
+        for (auto& page : partition.pages) {
+            file_pages[page.first.file_id.id].push_back(page.first.page_number);
+        }
+    }
+
+    std::vector<std::pair<std::string, std::vector<uint32_t>*>> files;
+    for (auto& [file_id, pages] : file_pages) {
+        auto filename = file_manager.get_filename(FileId(file_id));
+        if (!filename.empty()) {
+            std::sort(pages.begin(), pages.end());
+            files.push_back({ filename, &pages });
+        }
+    }
+
+    // the list is written in other file and then renamed, so a partially written list is never read
+    const auto path     = file_manager.get_file_path(PAGE_LIST_FILENAME);
+    const auto tmp_path = path + ".tmp";
+    std::ofstream file(tmp_path, ios::out|ios::binary|ios::trunc);
+
+    uint32_t file_count = files.size();
+    file.write(reinterpret_cast<const char*>(&file_count), sizeof(file_count));
+    for (auto& [filename, pages] : files) {
+        uint32_t filename_length = filename.size();
+        uint32_t page_count      = pages->size();
+        file.write(reinterpret_cast<const char*>(&filename_length), sizeof(filename_length));
+        file.write(filename.data(), filename_length);
+        file.write(reinterpret_cast<const char*>(&page_count), sizeof(page_count));
+        file.write(reinterpret_cast<const char*>(pages->data()), page_count*sizeof(uint32_t));
+    }
+    file.close();
+    if (!file) {
+        throw std::runtime_error("Could not write " + tmp_path);
+    }
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error("Could not rename " + tmp_path + " to " + path);
+    }
+}
+
+
+void BufferManager::start_warm_up() {
+    assert(!warm_up_thread.joinable());
+    if (read_only) {
+        return;
+    }
+    const auto path = file_manager.get_file_path(PAGE_LIST_FILENAME);
+    std::ifstream file(path, ios::in|ios::binary|ios::ate);
+    if (!file) {
+        return;
+    }
+    // the list may be truncated or corrupted, the counts are checked before allocating anything and
+    // the whole list is ignored if something is not valid
+    const uint64_t file_size = file.tellg();
+    file.seekg(0);
+    auto bytes_left = [&]() { return file_size - static_cast<uint64_t>(file.tellg()); };
+    auto invalid_list = [&]() {
+        std::cerr << "Ignoring " << path << ", it is not a valid list of pages" << std::endl;
+    };
+
+    std::vector<std::pair<FileId, std::vector<uint32_t>>> file_pages;
+    uint32_t file_count = 0;
+    file.read(reinterpret_cast<char*>(&file_count), sizeof(file_count));
+    for (uint_fast32_t i = 0; i < file_count && file; i++) {
+        uint32_t filename_length = 0;
+        file.read(reinterpret_cast<char*>(&filename_length), sizeof(filename_length));
+        if (!file || filename_length > bytes_left()) {
+            invalid_list();
+            return;
+        }
+        std::string filename(filename_length, '\0');
+        file.read(filename.data(), filename_length);
+
+        uint32_t page_count = 0;
+        file.read(reinterpret_cast<char*>(&page_count), sizeof(page_count));
+        if (!file || uint64_t(page_count)*sizeof(uint32_t) > bytes_left() || page_count > shared_buffer_pool_size) {
+            invalid_list();
+            return;
+        }
+        std::vector<uint32_t> pages(page_count);
+        file.read(reinterpret_cast<char*>(pages.data()), page_count*sizeof(uint32_t));
+
+        // warm_up needs each list sorted, without repeated pages
+        if (std::adjacent_find(pages.begin(), pages.end(), std::greater_equal<uint32_t>()) != pages.end()) {
+            invalid_list();
+            return;
+        }
+
+        // files that are not opened by the model (e.g. temporary files of other executions) are skipped
+        auto file_id = file_manager.find_file_id(filename);
+        if (file && file_id.id != FileId::UNASSIGNED) {
+            if (page_count > file_manager.count_pages(file_id)) {
+                invalid_list();
+                return;
+            }
+            file_pages.push_back({ file_id, move(pages) });
+        }
+    }
+    if (!file) {
+        invalid_list();
+        return;
+    }
+    warm_up_thread = std::thread(&BufferManager::warm_up, this, move(file_pages));
+}
+
+
+void BufferManager::warm_up(std::vector<std::pair<FileId, std::vector<uint32_t>>> file_pages) {
+    // the warm up is not needed by the queries, if a read fails it just stops
+    try {
+        warm_up_pages(file_pages);
+    } catch (const std::runtime_error& e) {
+        std::cerr << "Buffer warm up stopped: " << e.what() << std::endl;
+    }
+}
+
+
+void BufferManager::warm_up_pages(const std::vector<std::pair<FileId, std::vector<uint32_t>>>& file_pages) {
+    auto read_bytes = make_unique<char[]>(WARM_UP_READ_PAGES * Page::MDB_PAGE_SIZE);
+    uint_fast32_t installed_pages = 0;
+    uint_fast32_t next_unused = 0;
+
+    for (auto& [file_id, pages] : file_pages) {
+        uint_fast32_t i = 0;
+        while (i < pages.size()) {
+            if (warm_up_stop || installed_pages >= shared_buffer_pool_size) {
+                return;
+            }
+            // pages that are not in the list are read too if that avoids another read
+            const auto first_page = pages[i];
+            auto end = i + 1;
+            while (end < pages.size() && pages[end] - first_page < WARM_UP_READ_PAGES) {
+                end++;
+            }
+            const auto read_count = file_manager.read_pages(file_id,
+                                                            first_page,
+                                                            pages[end - 1] - first_page + 1,
+                                                            read_bytes.get());
+            for (; i < end; i++) {
+                const auto offset = pages[i] - first_page;
+                if (offset >= read_count) {
+                    continue; // the file is smaller than when the list was saved
+                }
+                if (!install_page(PageId(file_id, pages[i]),
+                                  &read_bytes[offset * Page::MDB_PAGE_SIZE],
+                                  next_unused))
+                {
+                    return;
+                }
+                installed_pages++;
+            }
+        }
+    }
+}
+
+
+bool BufferManager::install_page(PageId page_id, const char* page_bytes, uint_fast32_t& next_unused) {
+    auto& partition = get_partition(page_id);
+    if (is_in_buffer(page_id)) {
+        return true;
+    }
+
+    const auto buffer_available = get_unused_buffer(next_unused);
+    if (buffer_available == shared_buffer_pool_size) {
+        return false;
+    }
+    auto& page = buffer_pool[buffer_available];
+
+    std::lock_guard<std::mutex> lck(partition.mutex);
+    if (partition.pages.find(page_id) == partition.pages.end()) {
+        std::memcpy(page.get_bytes(), page_bytes, Page::MDB_PAGE_SIZE);
+        page.page_id = page_id;
+        page.dirty   = false;
+        page.ready   = true;
+        page.usage   = 0; // queries may be already using the buffer, their pages are kept over these
+        partition.pages.insert(pair<PageId, int>(page_id, buffer_available));
+    }
+    // if other thread put the page in the buffer meanwhile `page` is left unassigned for future use
+    page.pins--;
+    return true;
+}
+
+
+void BufferManager::prefetch(FileId file_id, uint_fast32_t page_number) {
+    // reading a page beyond the end of the file would append it
+    if (page_number >= file_manager.count_pages(file_id)) {
+        return;
+    }
+    if (read_only) {
+        auto page_bytes = file_manager.get_mapped_bytes(file_id) + page_number*Page::MDB_PAGE_SIZE;
+        madvise(page_bytes, Page::MDB_PAGE_SIZE, MADV_WILLNEED);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lck(read_ahead_mutex);
+        if (read_ahead_requests.size() >= MAX_READ_AHEAD_REQUESTS) {
+            return;
+        }
+        read_ahead_requests.push(PageId(file_id, page_number));
+    }
+    read_ahead_cv.notify_one();
+}
+
+
+void BufferManager::read_ahead_worker() {
+    while (true) {
+        std::unique_lock<std::mutex> lck(read_ahead_mutex);
+        read_ahead_cv.wait(lck, [this] { return read_ahead_stop || !read_ahead_requests.empty(); });
+        if (read_ahead_stop) {
+            return;
+        }
+        auto page_id = read_ahead_requests.front();
+        read_ahead_requests.pop();
+        lck.unlock();
+
+        // the request is only a hint, if the page can't be read it is discarded
+        try {
+            read_ahead_page(page_id);
+        } catch (const std::runtime_error&) { }
+    }
+}
+
+
+void BufferManager::read_ahead_page(PageId page_id) {
+    if (is_in_buffer(page_id)) {
+        return;
+    }
+    const auto buffer_available = try_get_buffer_available(false);
+    if (buffer_available == shared_buffer_pool_size) {
+        return;
+    }
+    auto& page = buffer_pool[buffer_available];
+
+    // the page is read before it is mapped, so if the read fails no query has seen it
+    try {
+        file_manager.read_page(page_id, page.get_bytes());
+    } catch (...) {
+        page.pins--;
+        throw;
+    }
+
+    auto& partition = get_partition(page_id);
+    std::lock_guard<std::mutex> lck(partition.mutex);
+    if (partition.pages.find(page_id) == partition.pages.end()) {
+        count(page_id.file_id, MISSES);
+        page.page_id = page_id;
+        page.dirty   = false;
+        page.ready   = true;
+        page.usage   = 0;
+        partition.pages.insert(pair<PageId, int>(page_id, buffer_available));
+    }
+    // if a query put the page in the buffer meanwhile `page` is left unassigned for future use
+    page.pins--;
+}
+
+
+bool BufferManager::is_in_buffer(PageId page_id) {
+    auto& partition = get_partition(page_id);
+    std::lock_guard<std::mutex> lck(partition.mutex);
+    return partition.pages.find(page_id) != partition.pages.end();
 }
 
 
@@ -75,59 +427,361 @@ Page& BufferManager::append_page(FileId file_id) {
 }
 
 
-uint_fast32_t BufferManager::get_buffer_available() {
-    auto first_lookup = clock_pos;
+void BufferManager::count(FileId file_id, BufferCounter counter, uint64_t value) {
+    if (file_id.id >= BufferStats::MAX_FILES) {
+        return;
+    }
+    if (counter != HITS) {
+        counters[file_id.id][counter].fetch_add(value, std::memory_order_relaxed);
+    }
+    thread_stats.stats.add(file_id.id, counter, value);
+}
+
+
+void BufferManager::count_tmp(BufferCounter counter, uint64_t value) {
+    if (counter != HITS) {
+        counters[BufferStats::TMP_FILES][counter].fetch_add(value, std::memory_order_relaxed);
+    }
+    thread_stats.stats.add(BufferStats::TMP_FILES, counter, value);
+}
+
 
-    while (buffer_pool[clock_pos].pins != 0) {
-        clock_pos = (clock_pos+1) % shared_buffer_pool_size;
-        if (clock_pos == first_lookup) {
-            throw std::runtime_error("No buffer available in buffer pool.");
+void BufferManager::publish_thread_hits() {
+    auto& stats = thread_stats.stats;
+    auto& published_hits = thread_stats.published_hits;
+    published_hits.resize(stats.files.size(), 0);
+    for (uint_fast32_t i = 0; i < stats.files.size(); i++) {
+        const auto hits = stats.files[i][HITS];
+        if (hits != published_hits[i]) {
+            counters[i][HITS].fetch_add(hits - published_hits[i], std::memory_order_relaxed);
+            published_hits[i] = hits;
         }
     }
-    auto res = clock_pos;
-    clock_pos = (clock_pos+1) % shared_buffer_pool_size;
+    const auto tmp_hits = stats.tmp_files[HITS];
+    if (tmp_hits != thread_stats.published_tmp_hits) {
+        counters[BufferStats::TMP_FILES][HITS].fetch_add(tmp_hits - thread_stats.published_tmp_hits,
+                                                         std::memory_order_relaxed);
+        thread_stats.published_tmp_hits = tmp_hits;
+    }
+}
+
+
+BufferStats BufferManager::get_stats() {
+    publish_thread_hits();
+
+    BufferStats res;
+    for (uint_fast32_t i = 0; i < BufferStats::MAX_FILES; i++) {
+        for (uint_fast32_t c = 0; c < BUFFER_COUNTERS; c++) {
+            auto value = counters[i][c].load(std::memory_order_relaxed);
+            if (value != 0) {
+                res.add(i, static_cast<BufferCounter>(c), value);
+            }
+        }
+    }
+    for (uint_fast32_t c = 0; c < BUFFER_COUNTERS; c++) {
+        res.tmp_files[c] = counters[BufferStats::TMP_FILES][c].load(std::memory_order_relaxed);
+    }
+    res.private_pages_in_use = private_pages_in_use;
+    res.private_pages_total  = private_buffer_pool_size * max_private_buffers;
+    return res;
+}
+
+
+BufferStats BufferManager::get_thread_stats() const {
+    return thread_stats.stats;
+}
+
+
+void BufferManager::add_thread_stats(const BufferStats& stats) {
+    thread_stats.stats += stats;
+
+    // so they are not published twice
+    auto& published_hits = thread_stats.published_hits;
+    published_hits.resize(std::max(published_hits.size(), stats.files.size()), 0);
+    for (uint_fast32_t i = 0; i < stats.files.size(); i++) {
+        published_hits[i] += stats.files[i][HITS];
+    }
+    thread_stats.published_tmp_hits += stats.tmp_files[HITS];
+}
+
+
+BufferManager::PageTablePartition& BufferManager::get_partition(PageId page_id) noexcept {
+    // PageIdHasher puts the file_id in the lowest bits, so the hash is mixed before choosing the partition
+    uint64_t hash = PageIdHasher()(page_id) * 0x9E37'79B9'7F4A'7C15ULL;
+    return page_table[(hash >> 32) % PAGE_TABLE_PARTITIONS];
+}
+
+
+uint_fast32_t BufferManager::get_buffer_available() {
+    const auto res = try_get_buffer_available(true);
+    if (res == shared_buffer_pool_size) {
+        throw std::runtime_error("No buffer available in buffer pool.");
+    }
     return res;
 }
 
 
+uint_fast32_t BufferManager::try_get_buffer_available(bool take_uses) {
+    // pages may be pinned and unpinned concurrently while the clock moves, two full turns (plus the turns
+    // needed to take the uses of every page) are given before considering that there is no page available.
+    // Without taking the uses only one turn is given
+    uint_fast32_t max_turns = 1;
+    if (take_uses) {
+        max_turns = replacement_policy == ReplacementPolicy::GCLOCK ? MAX_PAGE_USAGE + 2 : 2;
+    }
+    for (uint_fast32_t i = 0; i < max_turns*shared_buffer_pool_size; i++) {
+        const auto pos = clock_pos.fetch_add(1, std::memory_order_relaxed) % shared_buffer_pool_size;
+        auto& page = buffer_pool[pos];
+
+        if (replacement_policy == ReplacementPolicy::GCLOCK) {
+            auto usage = page.usage.load(std::memory_order_relaxed);
+            if (usage > 0) {
+                if (take_uses) {
+                    // a concurrent update may be lost, it only changes when the page will be replaced
+                    page.usage.store(usage - 1, std::memory_order_relaxed);
+                }
+                continue;
+            }
+        }
+
+        uint_fast32_t expected_pins = 0;
+        if (!page.pins.compare_exchange_strong(expected_pins, 1)) {
+            continue;
+        }
+        // now the page is pinned by this thread, so no other thread will try to replace it
+        if (page.page_id.file_id.id == FileId::UNASSIGNED) {
+            return pos;
+        }
+
+        // other threads may still find the page in the page table while it's being written
+        if (page.dirty) {
+            count(page.page_id.file_id, DIRTY_WRITES);
+        }
+        page.flush();
+
+        auto& old_partition = get_partition(page.page_id);
+        std::lock_guard<std::mutex> lck(old_partition.mutex);
+        if (page.pins == 1 && !page.dirty) {
+            count(page.page_id.file_id, EVICTIONS);
+            old_partition.pages.erase(page.page_id);
+            page.page_id = PageId(FileId(FileId::UNASSIGNED), 0);
+            return pos;
+        }
+        // someone else pinned the page meanwhile
+        page.pins--;
+    }
+    return shared_buffer_pool_size;
+}
+
+
+uint_fast32_t BufferManager::get_unused_buffer(uint_fast32_t& next_unused) {
+    for (; next_unused < shared_buffer_pool_size; next_unused++) {
+        auto& page = buffer_pool[next_unused];
+        if (page.page_id.file_id.id != FileId::UNASSIGNED) {
+            continue;
+        }
+        uint_fast32_t expected_pins = 0;
+        if (!page.pins.compare_exchange_strong(expected_pins, 1)) {
+            continue;
+        }
+        // a query may have taken the page before it was pinned
+        if (page.page_id.file_id.id == FileId::UNASSIGNED) {
+            return next_unused++;
+        }
+        page.pins--;
+    }
+    return shared_buffer_pool_size;
+}
+
+
 uint_fast32_t BufferManager::get_private_buffer_available(uint_fast32_t thread_pos) {
-    // analogous to shared buffer
-    auto first_lookup = private_clock_pos[thread_pos];
+    auto& buffer = private_buffers[thread_pos];
+    const bool borrowing = buffer.frames.size() >= private_buffer_pool_size;
+    {
+        std::lock_guard<std::mutex> lck(private_frames_mutex);
+        if (!free_private_frames.empty() && (!borrowing || private_buffers_wanting == 0)) {
+            set_wanting(buffer, false);
+            return take_free_private_frame(buffer);
+        }
+    }
+    if (!borrowing) {
+        set_wanting(buffer, true);
+    }
 
-    while (get_private_page(thread_pos, private_clock_pos[thread_pos]).pins != 0) {
-        private_clock_pos[thread_pos] = (private_clock_pos[thread_pos]+1)%private_buffer_pool_size;
-        if (private_clock_pos[thread_pos] == first_lookup) {
-            throw std::runtime_error("No buffer available in private buffer pool.");
+    const auto replaced = replace_private_page(buffer);
+    if (replaced < buffer.frames.size()) {
+        const auto frame = buffer.frames[replaced];
+        if (borrowing && private_buffers_wanting > 0) {
+            // give back another page to the threads that need it
+            const auto given_back = replace_private_page(buffer);
+            if (given_back < buffer.frames.size() && buffer.frames[given_back] != frame) {
+                std::lock_guard<std::mutex> lck(private_frames_mutex);
+                free_private_frames.push_back(buffer.frames[given_back]);
+                buffer.frames[given_back] = buffer.frames.back();
+                buffer.frames.pop_back();
+                private_pages_in_use--;
+            }
+            private_frame_returned.notify_one();
         }
+        return frame;
+    }
+
+    // all the pages of the buffer are pinned, other threads must give back some page
+    set_wanting(buffer, true);
+    std::unique_lock<std::mutex> lck(private_frames_mutex);
+    const bool available = private_frame_returned.wait_for(lck,
+                                                           std::chrono::seconds(PRIVATE_PAGE_WAIT_SECONDS),
+                                                           [this] { return !free_private_frames.empty(); });
+    if (!available) {
+        throw std::runtime_error("No buffer available in private buffer pool.");
     }
-    auto ret = private_clock_pos[thread_pos];
-    private_clock_pos[thread_pos] = (private_clock_pos[thread_pos]+1)%private_buffer_pool_size;
-    return ret;
+    set_wanting(buffer, false);
+    return take_free_private_frame(buffer);
 }
 
 
-Page& BufferManager::get_page(FileId file_id, uint_fast32_t page_number) noexcept {
-    const PageId page_id(file_id, page_number);
+uint_fast32_t BufferManager::replace_private_page(PrivateBuffer& buffer) {
+    const auto frame_count = buffer.frames.size();
+    for (uint_fast32_t i = 0; i < frame_count; i++) {
+        const auto pos = buffer.clock % frame_count;
+        buffer.clock = pos + 1;
+
+        auto& page = private_buffer_pool[buffer.frames[pos]];
+        if (page.pins == 0 && page.page_id.file_id.id != TmpFileId::UNASSIGNED) {
+            count_tmp(EVICTIONS);
+            if (page.dirty) {
+                count_tmp(DIRTY_WRITES);
+            }
+            page.flush();
+            buffer.pages.erase(page.page_id);
+            page.reset();
+            return pos;
+        }
+    }
+    return frame_count;
+}
+
 
-    std::lock_guard<std::mutex> lck(pin_mutex);
-    auto it = pages.find(page_id);
+uint_fast32_t BufferManager::take_free_private_frame(PrivateBuffer& buffer) {
+    const auto frame = free_private_frames.back();
+    free_private_frames.pop_back();
+    buffer.frames.push_back(frame);
+    private_pages_in_use++;
+    return frame;
+}
 
-    if (it == pages.end()) {
-        const auto buffer_available = get_buffer_available();
-        if (buffer_pool[buffer_available].page_id.file_id.id != FileId::UNASSIGNED) {
-            auto old_page_id = buffer_pool[buffer_available].page_id;
-            pages.erase(old_page_id);
+
+void BufferManager::set_wanting(PrivateBuffer& buffer, bool wanting) {
+    if (buffer.wanting != wanting) {
+        buffer.wanting = wanting;
+        if (wanting) {
+            private_buffers_wanting++;
+        } else {
+            private_buffers_wanting--;
+        }
+    }
+}
+
+
+Page& BufferManager::pin_and_wait(PageTablePartition& partition,
+                                  std::unique_lock<std::mutex>& lck,
+                                  Page& page,
+                                  bool low_priority)
+{
+    page.pins++;
+    if (!low_priority) {
+        auto usage = page.usage.load(std::memory_order_relaxed);
+        if (usage < MAX_PAGE_USAGE) {
+            page.usage.store(usage + 1, std::memory_order_relaxed);
+        }
+    }
+    if (!page.ready) {
+        auto wait_start = std::chrono::steady_clock::now();
+        partition.page_ready.wait(lck, [&page] { return page.ready; });
+        std::chrono::nanoseconds wait_duration = std::chrono::steady_clock::now() - wait_start;
+        count(page.page_id.file_id, PIN_WAIT_NS, wait_duration.count());
+    }
+    return page;
+}
+
+
+void BufferManager::add_mapped_file(FileId file_id) {
+    assert(read_only);
+    if (mapped_files.size() <= file_id.id) {
+        mapped_files.resize(file_id.id + 1);
+    }
+    mapped_files[file_id.id] = make_unique<MappedFile>();
+}
+
+
+Page& BufferManager::get_mapped_page(PageId page_id) {
+    auto& mapped_file = *mapped_files[page_id.file_id.id];
+
+    std::call_once(mapped_file.pages_created, [&]() {
+        auto mapped_bytes      = file_manager.get_mapped_bytes(page_id.file_id);
+        mapped_file.page_count = file_manager.count_pages(page_id.file_id);
+        mapped_file.pages      = new Page[mapped_file.page_count];
+        for (uint_fast32_t i = 0; i < mapped_file.page_count; i++) {
+            auto& page   = mapped_file.pages[i];
+            page.page_id = PageId(page_id.file_id, i);
+            page.bytes   = &mapped_bytes[i*Page::MDB_PAGE_SIZE];
+            page.pins    = 1; // pages are always pinned
+        }
+    });
+
+    if (page_id.page_number >= mapped_file.page_count) {
+        throw std::runtime_error("Page " + std::to_string(page_id.page_number)
+                                 + " does not exist in a read-only file.");
+    }
+    return mapped_file.pages[page_id.page_number];
+}
+
+
+Page& BufferManager::get_page(FileId file_id, uint_fast32_t page_number, bool low_priority) {
+    const PageId page_id(file_id, page_number);
+    if (read_only) {
+        count(file_id, HITS);
+        return get_mapped_page(page_id);
+    }
+    auto& partition = get_partition(page_id);
+
+    { // page is in the buffer
+        std::unique_lock<std::mutex> lck(partition.mutex);
+        auto it = partition.pages.find(page_id);
+        if (it != partition.pages.end()) {
+            count(file_id, HITS);
+            return pin_and_wait(partition, lck, buffer_pool[it->second], low_priority);
         }
-        buffer_pool[buffer_available] = Page(page_id, &bytes[buffer_available*Page::MDB_PAGE_SIZE]);
+    }
 
-        file_manager.read_page(page_id, buffer_pool[buffer_available].get_bytes());
-        pages.insert(pair<PageId, int>(page_id, buffer_available));
-        return buffer_pool[buffer_available];
-    } else { // page is the buffer
-        buffer_pool[it->second].pins++;
-        return buffer_pool[it->second];
+    // page is not in the buffer, the partition is not locked while searching a page to replace
+    const auto buffer_available = get_buffer_available();
+    auto& page = buffer_pool[buffer_available];
+
+    std::unique_lock<std::mutex> lck(partition.mutex);
+    auto it = partition.pages.find(page_id);
+    if (it != partition.pages.end()) {
+        // another thread put the page in the buffer meanwhile, `page` is left unassigned for future use
+        page.pins--;
+        count(file_id, HITS);
+        return pin_and_wait(partition, lck, buffer_pool[it->second], low_priority);
     }
-    // lock is released
+    page.page_id = page_id;
+    page.dirty   = false;
+    page.ready   = false;
+    page.usage   = low_priority ? 0 : 1;
+    partition.pages.insert(pair<PageId, int>(page_id, buffer_available));
+    lck.unlock();
+
+    count(file_id, MISSES);
+
+    file_manager.read_page(page_id, page.get_bytes());
+
+    lck.lock();
+    page.ready = true;
+    lck.unlock();
+    partition.page_ready.notify_all();
+    return page;
 }
 
 
@@ -135,33 +789,34 @@ Page& BufferManager::get_tmp_page(TmpFileId tmp_file_id, uint_fast32_t page_numb
     const PageId page_id(tmp_file_id.file_id, page_number);
     auto thread_pos = tmp_file_id.private_buffer_pos;
 
-    // We don't need a mutex here because tmp pages are assigned to one specific thread
-    // TODO: If we change this in the future we might need a mutex lock
-
-    auto pages_it = private_tmp_pages[thread_pos].find(page_id);
-    if (pages_it == private_tmp_pages[thread_pos].end()) {
+    // We don't need a mutex here because tmp pages are assigned to one specific thread, only taking or giving back
+    // pages to the free pages of all private buffers needs a lock
+    auto& buffer = private_buffers[thread_pos];
+    auto pages_it = buffer.pages.find(page_id);
+    if (pages_it == buffer.pages.end()) {
         const auto buffer_available = get_private_buffer_available(thread_pos);
-        auto& page = get_private_page(thread_pos, buffer_available);
-        if (page.page_id.file_id.id != TmpFileId::UNASSIGNED) {
-            private_tmp_pages[thread_pos].erase(page.page_id);
-        }
-        page = Page(page_id,
-                    &private_bytes[Page::MDB_PAGE_SIZE * ((thread_pos * private_buffer_pool_size) + buffer_available)]
-        );
+        auto& page = private_buffer_pool[buffer_available];
+        count_tmp(MISSES);
+        page.page_id = page_id;
+        page.pins    = 1;
+        page.dirty   = false;
         file_manager.read_page(page_id, page.get_bytes());
-        private_tmp_pages[thread_pos].insert(pair<PageId, int>(page_id, buffer_available));
+        buffer.pages.insert(pair<PageId, int>(page_id, buffer_available));
         return page;
     }
     else {
-        auto& page = get_private_page(thread_pos, pages_it->second);
+        auto& page = private_buffer_pool[pages_it->second];
         page.pins++;
+        count_tmp(HITS);
         return page;
     }
 }
 
 
 void BufferManager::unpin(Page& page) {
-    std::lock_guard<std::mutex> lck(pin_mutex);
+    if (read_only && !is_private_page(page)) {
+        return;
+    }
     assert(page.pins != 0 && "Must not unpin if pin count is equal to 0. There is a logic error.");
     page.pins--;
 }
@@ -171,7 +826,9 @@ void BufferManager::remove(FileId file_id) {
     assert(buffer_pool != nullptr);
     for (uint_fast32_t i = 0; i < shared_buffer_pool_size; i++) {
         if (buffer_pool[i].page_id.file_id == file_id) {
-            pages.erase(buffer_pool[i].page_id);
+            auto& partition = get_partition(buffer_pool[i].page_id);
+            std::lock_guard<std::mutex> lck(partition.mutex);
+            partition.pages.erase(buffer_pool[i].page_id);
             buffer_pool[i].reset();
         }
     }
@@ -180,14 +837,62 @@ void BufferManager::remove(FileId file_id) {
 
 void BufferManager::remove_tmp(TmpFileId tmp_file_id) {
     assert(private_buffer_pool != nullptr);
-    auto offset = private_buffer_pool_size * tmp_file_id.private_buffer_pos;
-    for (uint_fast32_t i = 0; i < private_buffer_pool_size; i++) {
-        auto page_id = private_buffer_pool[offset + i].page_id;
-        if (page_id.file_id == tmp_file_id.file_id) {
-            private_tmp_pages[tmp_file_id.private_buffer_pos].erase(page_id);
-            private_buffer_pool[offset + i].reset();
+    const auto thread_pos = tmp_file_id.private_buffer_pos;
+    auto& buffer = private_buffers[thread_pos];
+
+    // pages of the file are given back
+    std::vector<uint_fast32_t> given_back;
+    for (uint_fast32_t i = 0; i < buffer.frames.size(); ) {
+        auto& page = private_buffer_pool[buffer.frames[i]];
+        if (page.page_id.file_id == tmp_file_id.file_id) {
+            buffer.pages.erase(page.page_id);
+            page.reset();
+            given_back.push_back(buffer.frames[i]);
+            buffer.frames[i] = buffer.frames.back();
+            buffer.frames.pop_back();
+        } else {
+            i++;
+        }
+    }
+    if (!given_back.empty()) {
+        {
+            std::lock_guard<std::mutex> lck(private_frames_mutex);
+            free_private_frames.insert(free_private_frames.end(), given_back.begin(), given_back.end());
+            private_pages_in_use -= given_back.size();
         }
+        private_frame_returned.notify_all();
     }
+
+    release_private_buffer(thread_pos);
+}
+
+
+void BufferManager::release_private_buffer(uint_fast32_t private_buffer_pos) {
+    auto& buffer = private_buffers[private_buffer_pos];
+
+    // the private buffer is released when it has no more temporary files
+    if (--buffer.tmp_files == 0) {
+        assert(buffer.frames.empty());
+        set_wanting(buffer, false);
+        buffer.clock = 0;
+        for (auto it = thread2index.begin(); it != thread2index.end(); ++it) {
+            if (it->second == private_buffer_pos) {
+                thread2index.erase(it);
+                break;
+            }
+        }
+        available_private_positions.push(private_buffer_pos);
+    }
+}
+
+
+uint_fast32_t BufferManager::take_private_position() {
+    if (available_private_positions.empty()) {
+        throw std::runtime_error("To many threads, not enough private buffer space");
+    }
+    uint_fast32_t pos = available_private_positions.front();
+    available_private_positions.pop();
+    return pos;
 }
 
 
@@ -196,17 +901,26 @@ uint_fast32_t BufferManager::get_private_buffer_index() {
     auto thread_pos_it = thread2index.find(this_id);
     if (thread_pos_it == thread2index.end()) {
         // new thread
-        if (available_private_positions.empty()) {
-            throw std::runtime_error("To many threads, not enough private buffer space");
-        }
-        uint_fast32_t new_thread_pos = available_private_positions.front();
-        available_private_positions.pop();
+        uint_fast32_t new_thread_pos = take_private_position();
         thread2index.insert(pair<thread::id, uint_fast32_t>(this_id, new_thread_pos));
-        private_tmp_pages[new_thread_pos].clear();
-        private_clock_pos[new_thread_pos] = 0;
+        private_buffers[new_thread_pos].tmp_files = 1;
         return new_thread_pos;
     }
     else { // old thread
+        private_buffers[thread_pos_it->second].tmp_files++;
         return thread_pos_it->second;
     }
 }
+
+
+uint_fast32_t BufferManager::reserve_private_buffer() {
+    const auto pos = take_private_position();
+    private_buffers[pos].tmp_files = 1;
+    return pos;
+}
+
+
+void BufferManager::add_tmp_file(uint_fast32_t private_buffer_pos) {
+    assert(private_buffers[private_buffer_pos].tmp_files > 0 && "the private buffer must be reserved");
+    private_buffers[private_buffer_pos].tmp_files++;
+}
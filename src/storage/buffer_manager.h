@@ -6,18 +6,59 @@
  * must call the method BufferManager::init(), usually is the responsability of the model (e.g. QuadModel)
  * to call it.
  *
- * A mutex object is used to prevent conflict between different threads when asking for a page or
- * unpining a page (shared buffer).
+ * The page table of the shared buffer is split into `PAGE_TABLE_PARTITIONS` partitions, each one with its own
+ * mutex, so threads asking for pages in different partitions don't block each other. Pin counts are atomic,
+ * so unpinning a page doesn't need any lock. When a page is not in the buffer the disk read is performed
+ * outside the partition lock; other threads asking for the same page wait until the read finishes.
  *
  * When asked for a page it can be done with a FileId or a TmpFileId, in the first case, the page returned will be
  * a page from the shared buffer. In the second case, the page will be returned from the private buffer of current thread
- * (that asked for it). Private and shared buffer doesn't need to have the same sizes. All buffers (shared and each private)
- * have the same sistems for pages replacement.
+ * (that asked for it). Private and shared buffer doesn't need to have the same sizes.
+ *
+ * Private buffers are elastic: all of them take their pages from a common pool of
+ * `private_buffer_pool_size * max_threads` pages. A thread can always use up to `private_buffer_pool_size` pages,
+ * and it may borrow more pages while other threads are not asking for them. When a thread has no free page to
+ * take, it replaces (writing to disk if dirty) one of its unpinned pages, and if other threads are waiting for
+ * pages and it has borrowed pages, it also gives one back. Pages are given back to the pool when the
+ * temporary file using them is removed.
+ *
+ * The bytes of the pages of both buffers are allocated with BufferMemory, so they can be backed by huge pages and
+ * placed in chosen NUMA nodes (see BufferMemoryOptions).
+ *
+ * When the FileManager is in read-only mode the shared buffer is not allocated. Pages of files that are
+ * not temporary are handed out directly from the memory-mapped files, they are never replaced so
+ * pinning and unpinning them does nothing. Pages of temporary files still use the private buffers.
+ *
+ * Two replacement policies are available for the shared buffer. `ReplacementPolicy::CLOCK` replaces the first
+ * unpinned page the clock finds. `ReplacementPolicy::GCLOCK` keeps a usage count for each page: a page read from
+ * disk starts with one use, each time it is found in the buffer it gains another one (up to `MAX_PAGE_USAGE`), and
+ * the clock takes one from each page it passes, replacing only pages without uses left. Scans can ask for pages
+ * with low priority, those pages start without uses and are not promoted when a scan finds them again, so a large
+ * scan replaces its own pages instead of the pages used by every query (e.g. directories of the B+trees).
+ *
+ * Hits, misses, evictions, dirty writes and time waiting for pins are counted for each file (see BufferStats),
+ * both for the whole buffer and for each thread, so the pages used by a query can be known. Hits are only
+ * counted by the thread until it publishes them (see publish_thread_hits), so a page found in the buffer
+ * doesn't write a counter shared by all the threads.
+ *
+ * The list of pages in the shared buffer can be saved in the database folder with `save_page_list`. When the
+ * database is opened again `start_warm_up` reads those pages in background, sorted and with large reads, so
+ * the buffer doesn't need to be filled one miss at a time. The warm up only takes pages of the buffer that are
+ * not in use and stops when there are none left, it never replaces pages that queries read meanwhile.
+ *
+ * Sequential scans can ask for pages they will need soon with `prefetch`. Requests are queued and a few
+ * read-ahead threads put those pages in the shared buffer, so the scan doesn't wait for the disk when it
+ * gets there. In read-only mode the kernel is advised to read the mapped pages instead.
  */
 
 #ifndef STORAGE__BUFFER_MANAGER_H_
 #define STORAGE__BUFFER_MANAGER_H_
 
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
 #include <mutex>
 #include <queue>
 #include <string>
@@ -25,27 +66,48 @@
 #include <unordered_map>
 #include <vector>
 
+#include "storage/buffer_memory.h"
+#include "storage/buffer_stats.h"
 #include "storage/file_id.h"
 #include "storage/page.h"
 
 class Page;
 
+enum class ReplacementPolicy {
+    CLOCK,
+    GCLOCK
+};
+
 class BufferManager {
 public:
-    static constexpr uint_fast32_t DEFAULT_SHARED_BUFFER_POOL_SIZE  = 1024 * 256; // 1 GB
-    static constexpr uint_fast32_t DEFAULT_PRIVATE_BUFFER_POOL_SIZE = 1024 * 16;  // 64 MB
+    static constexpr uint_fast32_t DEFAULT_SHARED_BUFFER_POOL_SIZE  = 1024 * 1024 * 1024 / Page::MDB_PAGE_SIZE; // 1 GB
+    static constexpr uint_fast32_t DEFAULT_PRIVATE_BUFFER_POOL_SIZE = 64 * 1024 * 1024 / Page::MDB_PAGE_SIZE;   // 64 MB
+    static constexpr uint_fast32_t PAGE_TABLE_PARTITIONS            = 64;
+    static constexpr uint_fast32_t DEFAULT_READ_AHEAD_PAGES         = 16;
+    static constexpr uint_fast32_t READ_AHEAD_THREADS               = 2;
+    static constexpr uint_fast32_t MAX_READ_AHEAD_REQUESTS          = 1024;
+    static constexpr uint_fast8_t  MAX_PAGE_USAGE                   = 3;
+    static constexpr uint_fast32_t WARM_UP_READ_PAGES               = 64;
+    static constexpr uint_fast32_t PRIVATE_PAGE_WAIT_SECONDS        = 10;
+    static constexpr auto          PAGE_LIST_FILENAME               = "buffer_pages.dat";
+
+    static constexpr auto DEFAULT_REPLACEMENT_POLICY = ReplacementPolicy::GCLOCK;
 
     ~BufferManager();
 
     // necesary to be called before first usage
     static void init(uint_fast32_t shared_buffer_pool_size,
                      uint_fast32_t private_buffer_pool_size,
-                     uint_fast32_t max_threads);
+                     uint_fast32_t max_threads,
+                     const BufferMemoryOptions& memory_options = BufferMemoryOptions());
 
     // Get a page. It will search in the shared buffer and if it is not on it, it will read from disk and put in the buffer.
     // Also it will pin the page, so calling buffer_manager.unpin(page) is expected when the caller doesn't need
     // the returned page anymore.
-    Page& get_page(FileId file_id, uint_fast32_t page_number) noexcept;
+    // Scans that will not come back to the page soon should set `low_priority`, so the page is replaced before others.
+    // Throws a runtime_error if there is no page available in the buffer, or in read-only mode if the page
+    // does not exist in the file.
+    Page& get_page(FileId file_id, uint_fast32_t page_number, bool low_priority = false);
 
     // Get a page from a temp file. It will search in the private buffer and if it is not on it, it will read from disk
     // and put in the buffer.
@@ -61,6 +123,27 @@ public:
     // so 2 append_page in a row will work as expected.
     Page& append_page(FileId file_id);
 
+    // must be called before the buffer is used concurrently, by default DEFAULT_REPLACEMENT_POLICY is used
+    void set_replacement_policy(ReplacementPolicy policy) noexcept { replacement_policy = policy; }
+
+    // starts the read-ahead threads. Scans will ask for up to `read_ahead_pages` pages beyond the one
+    // they are reading, 0 disables the read-ahead. Until this is called `prefetch` is never used.
+    void start_read_ahead(uint_fast32_t read_ahead_pages);
+
+    constexpr auto get_read_ahead_pages() const noexcept { return read_ahead_pages; }
+
+    // writes the list of pages in the shared buffer into PAGE_LIST_FILENAME. Does nothing in read-only mode
+    void save_page_list();
+
+    // starts a thread that puts in the shared buffer the pages of the list written by `save_page_list`,
+    // until there are no unused pages in the buffer. Does nothing if the list doesn't exist or is not valid, or in
+    // read-only mode
+    void start_warm_up();
+
+    // Asks to put the page in the buffer in background, without pinning it. Pages that does not exist
+    // on disk are ignored and the request may be discarded if there are too many pending requests.
+    void prefetch(FileId file_id, uint_fast32_t page_number);
+
     // write all dirty pages to disk
     void flush();
 
@@ -73,66 +156,254 @@ public:
     // invalidates all pages using `tmp_file_id`in private buffer
     void remove_tmp(TmpFileId tmp_file_id);
 
+    // only used in read-only mode, called by the file_manager when `file_id` is opened and mapped
+    void add_mapped_file(FileId file_id);
+
     constexpr auto get_shared_buffer_pool_size() const noexcept { return shared_buffer_pool_size; }
 
+    // counters since the buffer was created, of all threads. Hits of other threads are included once they are
+    // published, the ones of the calling thread are published first
+    BufferStats get_stats();
+
+    // adds the hits of the calling thread to the counters of all threads. Called after each query and when a
+    // thread ends
+    void publish_thread_hits();
+
+    // counters of pages asked by the calling thread since it started
+    BufferStats get_thread_stats() const;
+
+    // adds the counters of pages asked by other threads for the calling thread (e.g. by the workers of its query)
+    // to the counters of the calling thread. Their hits are published by the threads that found them
+    void add_thread_stats(const BufferStats& stats);
+
+    // called when the calling thread creates a temporary file, returns the position of the private buffer of the
+    // thread. Threads without temporary files don't have a private buffer
     uint_fast32_t get_private_buffer_index();
 
+    // returns the position of a private buffer that is not tied to any thread, it's kept until it's released
+    // with `release_private_buffer` and its temporary files are removed
+    uint_fast32_t reserve_private_buffer();
+
+    // called when a temporary file is created in a private buffer given by `reserve_private_buffer`
+    void add_tmp_file(uint_fast32_t private_buffer_pos);
+
+    void release_private_buffer(uint_fast32_t private_buffer_pos);
+
 private:
     BufferManager(uint_fast32_t shared_buffer_pool_size,
                   uint_fast32_t private_buffer_pool_size,
-                  uint_fast32_t max_threads);
+                  uint_fast32_t max_threads,
+                  const BufferMemoryOptions& memory_options);
+
+    // true if pages are obtained from memory-mapped files instead of the shared buffer
+    const bool read_only;
 
     // maximum pages the buffer can have
     const uint_fast32_t shared_buffer_pool_size;
 
-    // maximum pages for each private buffer
+    // pages each private buffer can always use
     const uint_fast32_t private_buffer_pool_size;
 
-    // maximum number of private threads
+    // maximum number of private buffers (threads using temporary files at the same time)
     const uint_fast32_t max_private_buffers;
 
     // available private positions queue
     std::queue<uint_fast32_t> available_private_positions;
 
-    // used to search the index in the `buffer_pool` of a certain page
-    std::unordered_map<PageId, uint_fast32_t, PageIdHasher> pages;
+    struct PageTablePartition {
+        // protects `pages` and the `ready` flag of the pages mapped in this partition
+        std::mutex mutex;
+
+        // notified when a page of this partition finished being read from disk
+        std::condition_variable page_ready;
 
-    // map thread id -> private_thread_index
+        // used to search the index in the `buffer_pool` of a certain page
+        std::unordered_map<PageId, uint_fast32_t, PageIdHasher> pages;
+    };
+
+    // page table of the shared buffer, a page is always mapped in the partition given by `get_partition`
+    std::array<PageTablePartition, PAGE_TABLE_PARTITIONS> page_table;
+
+    struct MappedFile {
+        // pages are created the first time the file is used
+        std::once_flag pages_created;
+        Page* pages = nullptr;
+        uint_fast32_t page_count = 0;
+
+        ~MappedFile() { delete[](pages); }
+    };
+
+    // mapped files in read-only mode, the position in the vector is the FileId. This vector only changes
+    // when files are opened (at startup), so it can be read without locking
+    std::vector<std::unique_ptr<MappedFile>> mapped_files;
+
+    // map thread id -> private_thread_index, reserved private buffers are not in the map
     std::unordered_map<std::thread::id , uint_fast32_t> thread2index;
 
-    // used to search the index in the `private_buffer_pool` of a certain page
-    std::vector<std::unordered_map<PageId, uint_fast32_t, PageIdHasher>> private_tmp_pages;
+    struct PrivateBuffer {
+        // positions in `private_buffer_pool` of the pages used by this buffer, all of them are assigned
+        std::vector<uint_fast32_t> frames;
+
+        // used to search the position in `private_buffer_pool` of a certain page
+        std::unordered_map<PageId, uint_fast32_t, PageIdHasher> pages;
+
+        // clock used for page replacement, is a position in `frames`
+        uint_fast32_t clock = 0;
+
+        // temporary files of the thread that were not removed yet, plus one while the buffer is reserved
+        uint_fast32_t tmp_files = 0;
+
+        // true if the last time this buffer needed a page there were no free pages, and the buffer had less than
+        // `private_buffer_pool_size` pages or all of them were pinned
+        bool wanting = false;
+    };
+
+    // only accessed by the thread owning each buffer
+    std::vector<PrivateBuffer> private_buffers;
+
+    // protects `free_private_frames`
+    std::mutex private_frames_mutex;
+
+    // notified when pages are given back to `free_private_frames`
+    std::condition_variable private_frame_returned;
+
+    // positions in `private_buffer_pool` of the pages not used by any private buffer
+    std::vector<uint_fast32_t> free_private_frames;
+
+    // private buffers with `wanting` set, while it's not 0 other buffers don't borrow pages and give back the
+    // pages they borrowed
+    std::atomic<uint_fast32_t> private_buffers_wanting;
+
+    // the destructor of Page is only accessible by the BufferManager
+    struct PagesDeleter {
+        void operator()(Page* pages) const { delete[](pages); }
+    };
 
     // array of `buffer_pool_size` pages
-    Page* const buffer_pool;
+    const std::unique_ptr<Page[], PagesDeleter> buffer_pool;
 
     // private buffer pools
-    Page* const private_buffer_pool;
+    const std::unique_ptr<Page[], PagesDeleter> private_buffer_pool;
 
-    // begining of the allocated memory for the pages of the shared buffer
-    char* const bytes;
+    // allocated memory for the pages of the shared buffer
+    BufferMemory bytes;
 
-    // begining of the allocated memory for the pages of the private buffer
-    char* const private_bytes;
+    // allocated memory for the pages of the private buffers
+    BufferMemory private_bytes;
+
+    // policy used by get_buffer_available
+    ReplacementPolicy replacement_policy;
 
     // simple clock used to page replacement in the shared buffer
-    uint_fast32_t clock_pos;
+    std::atomic<uint_fast32_t> clock_pos;
+
+    // maximum pages a scan asks for in advance, 0 means read-ahead is disabled
+    uint_fast32_t read_ahead_pages;
+
+    // protects `read_ahead_requests` and `read_ahead_stop`
+    std::mutex read_ahead_mutex;
+
+    // notified when a request is added or the read-ahead threads must stop
+    std::condition_variable read_ahead_cv;
+
+    // pages waiting to be read by the read-ahead threads
+    std::queue<PageId> read_ahead_requests;
+
+    bool read_ahead_stop;
+
+    std::vector<std::thread> read_ahead_threads;
+
+    // counters of all threads, the position is the FileId or BufferStats::TMP_FILES. Hits are added by
+    // publish_thread_hits
+    std::array<std::array<std::atomic<uint64_t>, BUFFER_COUNTERS>, BufferStats::MAX_FILES + 1> counters;
+
+    // pages of the private buffers assigned to a temporary file
+    std::atomic<uint64_t> private_pages_in_use;
+
+    // adds `value` to a counter of the file, in the counters of all threads and in the ones of the calling thread
+    void count(FileId file_id, BufferCounter counter, uint64_t value = 1);
 
-    // simple clock used to page replacement in the private buffer
-    std::vector<uint_fast32_t> private_clock_pos;
+    // same as count, for temporary files
+    void count_tmp(BufferCounter counter, uint64_t value = 1);
 
-    // to avoid pin/unpin synchronization problems in the shared buffer
-    std::mutex pin_mutex;
+    // set when the buffer manager is being destroyed, so the warm up stops
+    std::atomic<bool> warm_up_stop;
 
-    // returns the index of an unpined page from shared buffer (`buffer_pool`)
+    std::thread warm_up_thread;
+
+    // runs in `warm_up_thread`, calls warm_up_pages and stops if a read fails
+    void warm_up(std::vector<std::pair<FileId, std::vector<uint32_t>>> file_pages);
+
+    // reads the pages of each file in order, WARM_UP_READ_PAGES at once. The pages of each file must be sorted,
+    // without repetitions. Throws a runtime_error if a read fails
+    void warm_up_pages(const std::vector<std::pair<FileId, std::vector<uint32_t>>>& file_pages);
+
+    // puts a copy of `page_bytes` in the shared buffer as the page `page_id`, unless the page is already in the
+    // buffer. The page is not pinned. Only pages of the buffer that are not in use are taken (see
+    // get_unused_buffer), returns false if there are none left
+    bool install_page(PageId page_id, const char* page_bytes, uint_fast32_t& next_unused);
+
+    // loop executed by each read-ahead thread
+    void read_ahead_worker();
+
+    // puts `page_id` in the shared buffer without pinning it, with the lowest priority. The page is skipped
+    // if the buffer has no page to replace that isn't being used by the queries (see try_get_buffer_available).
+    // Throws a runtime_error if the page can't be read
+    void read_ahead_page(PageId page_id);
+
+    // returns true if `page_id` is mapped in the page table of the shared buffer
+    bool is_in_buffer(PageId page_id);
+
+    // returns the index of a page from shared buffer (`buffer_pool`) that is pinned by the caller and is not
+    // mapped in the page table. Its previous content is written to disk if it was dirty.
+    // Throws a runtime_error if there are no pages to replace
     uint_fast32_t get_buffer_available();
 
-    // returns the index of an unpined page from the private buffer (`private_buffer_pool[thread_number]`)
-    uint_fast32_t get_private_buffer_available(uint_fast32_t thread_number);
+    // same as get_buffer_available, but returns `shared_buffer_pool_size` if there are no pages to replace.
+    // Unless `take_uses` is set the uses of the pages are not taken (with the gclock policy), so only pages
+    // that no query used since their uses were taken can be replaced
+    uint_fast32_t try_get_buffer_available(bool take_uses);
+
+    // returns the index of a page of the shared buffer that is pinned by the caller and is not mapped in the page
+    // table, searching from `next_unused`, which is moved past it. No page is replaced, so the pages used by the
+    // queries are kept. Returns `shared_buffer_pool_size` if there are no unused pages after `next_unused`
+    uint_fast32_t get_unused_buffer(uint_fast32_t& next_unused);
+
+    // partition of the page table where `page_id` is mapped
+    PageTablePartition& get_partition(PageId page_id) noexcept;
+
+    // get a page from a memory-mapped file, only used in read-only mode
+    Page& get_mapped_page(PageId page_id);
+
+    // pins a page found in `partition` and waits until it was read from disk. Unless `low_priority` is set
+    // the usage count of the page is increased. `lck` must be holding the mutex of the partition
+    Page& pin_and_wait(PageTablePartition& partition,
+                       std::unique_lock<std::mutex>& lck,
+                       Page& page,
+                       bool low_priority);
+
+    // returns the position in `private_buffer_pool` of an unassigned page for the private buffer `thread_pos`. The
+    // page is taken from the free pages or replacing an unpinned page of the buffer, and it's added to its frames
+    uint_fast32_t get_private_buffer_available(uint_fast32_t thread_pos);
+
+    // replaces an unpinned page of the buffer, leaving it unassigned. Returns its position in `frames`,
+    // or `frames.size()` if all pages are pinned
+    uint_fast32_t replace_private_page(PrivateBuffer& buffer);
+
+    // takes a page from `free_private_frames` and adds it to the frames of the buffer.
+    // `private_frames_mutex` must be locked
+    uint_fast32_t take_free_private_frame(PrivateBuffer& buffer);
+
+    void set_wanting(PrivateBuffer& buffer, bool wanting);
+
+    // takes a position of `available_private_positions`
+    uint_fast32_t take_private_position();
 
-    // auxiliar method for getting page
-    inline Page& get_private_page(uint_fast32_t thread_pos, uint_fast32_t page_pos) const noexcept {
-        return private_buffer_pool[thread_pos * private_buffer_pool_size + page_pos];
+    // returns true if `page` belongs to some private buffer
+    inline bool is_private_page(const Page& page) const noexcept {
+        return std::less_equal<const Page*>()(private_buffer_pool.get(), &page)
+            && std::less<const Page*>()(&page,
+                                        private_buffer_pool.get() + private_buffer_pool_size*max_private_buffers);
     }
 };
 
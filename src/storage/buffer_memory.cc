@@ -0,0 +1,157 @@
+#include "buffer_memory.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+    constexpr size_t HUGE_PAGE_2MB = 2UL * 1024 * 1024;
+    constexpr size_t HUGE_PAGE_1GB = 1024UL * 1024 * 1024;
+
+    // bits of the node masks given to the kernel, more than the nodes of any machine
+    constexpr unsigned long NUMA_MASK_BITS = 1024;
+    constexpr unsigned long BITS_PER_LONG  = 8 * sizeof(unsigned long);
+
+    size_t round_up(size_t size, size_t alignment) {
+        return (size + alignment - 1) / alignment * alignment;
+    }
+}
+
+
+HugePages BufferMemoryOptions::parse_huge_pages(const string& value) {
+    if (value == "none") {
+        return HugePages::NONE;
+    } else if (value == "transparent") {
+        return HugePages::TRANSPARENT;
+    } else if (value == "2mb") {
+        return HugePages::HUGE_2MB;
+    } else if (value == "1gb") {
+        return HugePages::HUGE_1GB;
+    }
+    throw invalid_argument("Huge pages must be none, transparent, 2mb or 1gb.");
+}
+
+
+NumaPolicy BufferMemoryOptions::parse_numa_policy(const string& value) {
+    if (value == "none") {
+        return NumaPolicy::NONE;
+    } else if (value == "interleave") {
+        return NumaPolicy::INTERLEAVE;
+    } else if (value == "bind") {
+        return NumaPolicy::BIND;
+    }
+    throw invalid_argument("NUMA policy must be none, interleave or bind.");
+}
+
+
+BufferMemory::BufferMemory(size_t size, const BufferMemoryOptions& options) :
+    size  (size),
+    bytes (nullptr)
+{
+    if (size == 0) {
+        return;
+    }
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    switch (options.huge_pages) {
+        case HugePages::HUGE_2MB:
+            flags |= MAP_HUGETLB | (21 << MAP_HUGE_SHIFT);
+            this->size = round_up(size, HUGE_PAGE_2MB);
+            break;
+        case HugePages::HUGE_1GB:
+            flags |= MAP_HUGETLB | (30 << MAP_HUGE_SHIFT);
+            this->size = round_up(size, HUGE_PAGE_1GB);
+            break;
+        case HugePages::TRANSPARENT:
+            // transparent huge pages are used only for aligned 2 MB ranges
+            this->size = round_up(size, HUGE_PAGE_2MB);
+            break;
+        case HugePages::NONE:
+            break;
+    }
+
+    if (options.huge_pages == HugePages::TRANSPARENT) {
+        // map one more huge page and unmap the parts before and after the aligned range
+        const auto mapped_size = this->size + HUGE_PAGE_2MB;
+        auto mapped = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, flags, -1, 0);
+        if (mapped == MAP_FAILED) {
+            throw runtime_error("Could not allocate " + to_string(size) + " bytes for the buffer: "
+                                + strerror(errno));
+        }
+        const auto begin   = reinterpret_cast<uintptr_t>(mapped);
+        const auto aligned = round_up(begin, HUGE_PAGE_2MB);
+        if (aligned > begin) {
+            munmap(mapped, aligned - begin);
+        }
+        if (aligned + this->size < begin + mapped_size) {
+            munmap(reinterpret_cast<void*>(aligned + this->size), begin + mapped_size - aligned - this->size);
+        }
+        bytes = reinterpret_cast<char*>(aligned);
+        madvise(bytes, this->size, MADV_HUGEPAGE);
+    } else {
+        auto mapped = mmap(nullptr, this->size, PROT_READ | PROT_WRITE, flags, -1, 0);
+        if (mapped == MAP_FAILED) {
+            if (flags & MAP_HUGETLB) {
+                throw runtime_error("Could not allocate " + to_string(this->size) + " bytes of huge pages for "
+                                    "the buffer, check the huge pages reserved in /proc/sys/vm/nr_hugepages "
+                                    "or use transparent huge pages: " + strerror(errno));
+            }
+            throw runtime_error("Could not allocate " + to_string(size) + " bytes for the buffer: "
+                                + strerror(errno));
+        }
+        bytes = reinterpret_cast<char*>(mapped);
+    }
+
+    // the policy must be set before the memory is touched, pages are placed when they are first written
+    try {
+        set_numa_policy(options);
+    } catch (...) {
+        munmap(bytes, this->size);
+        throw;
+    }
+}
+
+
+BufferMemory::~BufferMemory() {
+    if (bytes != nullptr) {
+        munmap(bytes, size);
+    }
+}
+
+
+void BufferMemory::set_numa_policy(const BufferMemoryOptions& options) {
+    if (options.numa_policy == NumaPolicy::NONE) {
+        return;
+    }
+    // nodes this process may use
+    unsigned long allowed[NUMA_MASK_BITS / BITS_PER_LONG] = {};
+    if (syscall(SYS_get_mempolicy, nullptr, allowed, NUMA_MASK_BITS, nullptr, MPOL_F_MEMS_ALLOWED) != 0) {
+        throw runtime_error(string("Could not get the NUMA nodes: ") + strerror(errno));
+    }
+
+    int mode;
+    unsigned long nodes[NUMA_MASK_BITS / BITS_PER_LONG] = {};
+    if (options.numa_policy == NumaPolicy::INTERLEAVE) {
+        mode = MPOL_INTERLEAVE;
+        memcpy(nodes, allowed, sizeof(nodes));
+    } else {
+        mode = MPOL_BIND;
+        const auto node = static_cast<unsigned long>(options.numa_node);
+        if (options.numa_node < 0 || node >= NUMA_MASK_BITS
+            || (allowed[node / BITS_PER_LONG] & (1UL << (node % BITS_PER_LONG))) == 0)
+        {
+            throw runtime_error("NUMA node " + to_string(options.numa_node) + " is not available.");
+        }
+        nodes[node / BITS_PER_LONG] = 1UL << (node % BITS_PER_LONG);
+    }
+    // the kernel reads `maxnode - 1` bits of the mask
+    if (syscall(SYS_mbind, bytes, size, mode, nodes, NUMA_MASK_BITS + 1, 0) != 0) {
+        throw runtime_error(string("Could not set the NUMA policy of the buffer: ") + strerror(errno));
+    }
+}
@@ -0,0 +1,67 @@
+/*
+ * BufferMemory is the memory where the BufferManager puts the bytes of the pages. It is mapped with mmap so
+ * it can be backed with huge pages and placed in specific NUMA nodes, before any page is touched.
+ *
+ * With large buffers most of the TLB misses come from the buffer pool, huge pages reduce them:
+ * - `HugePages::TRANSPARENT` asks the kernel to use transparent huge pages when it can (madvise).
+ * - `HugePages::HUGE_2MB` and `HugePages::HUGE_1GB` use pages reserved by the system administrator
+ *   (e.g. /proc/sys/vm/nr_hugepages), if there are not enough reserved pages the allocation fails.
+ *
+ * In machines with many NUMA nodes the memory can be spread over all the nodes (`NumaPolicy::INTERLEAVE`),
+ * so threads running in any node see the same bandwidth, or bound to one node (`NumaPolicy::BIND`) when the
+ * server runs in the cpus of that node.
+ */
+
+#ifndef STORAGE__BUFFER_MEMORY_H_
+#define STORAGE__BUFFER_MEMORY_H_
+
+#include <cstddef>
+#include <string>
+
+enum class HugePages {
+    NONE,
+    TRANSPARENT,
+    HUGE_2MB,
+    HUGE_1GB
+};
+
+enum class NumaPolicy {
+    NONE,
+    INTERLEAVE,
+    BIND
+};
+
+struct BufferMemoryOptions {
+    HugePages  huge_pages  = HugePages::NONE;
+    NumaPolicy numa_policy = NumaPolicy::NONE;
+
+    // node used by NumaPolicy::BIND
+    int numa_node = 0;
+
+    // parse the values of the server options, throws std::invalid_argument if the value is not valid
+    static HugePages  parse_huge_pages(const std::string& value);
+    static NumaPolicy parse_numa_policy(const std::string& value);
+};
+
+class BufferMemory {
+public:
+    // allocates at least `size` bytes, throws std::runtime_error if the memory can't be allocated
+    // with the options given
+    BufferMemory(std::size_t size, const BufferMemoryOptions& options);
+    ~BufferMemory();
+
+    BufferMemory(const BufferMemory&) = delete;
+    BufferMemory& operator=(const BufferMemory&) = delete;
+
+    inline char* get_bytes() const noexcept { return bytes; }
+
+private:
+    // mapped size, rounded up to a multiple of the huge page size when huge pages are used
+    std::size_t size;
+
+    char* bytes;
+
+    void set_numa_policy(const BufferMemoryOptions& options);
+};
+
+#endif // STORAGE__BUFFER_MEMORY_H_
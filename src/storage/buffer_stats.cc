@@ -0,0 +1,82 @@
+#include "buffer_stats.h"
+
+#include <string>
+
+#include "storage/file_manager.h"
+
+using namespace std;
+
+void BufferStats::add(uint_fast32_t file_index, BufferCounter counter, uint64_t value) {
+    if (file_index == TMP_FILES) {
+        tmp_files[counter] += value;
+        return;
+    }
+    if (files.size() <= file_index) {
+        files.resize(file_index + 1);
+    }
+    files[file_index][counter] += value;
+}
+
+
+BufferStats BufferStats::operator-(const BufferStats& other) const {
+    BufferStats res = *this;
+    for (uint_fast32_t i = 0; i < other.files.size() && i < res.files.size(); i++) {
+        for (uint_fast32_t c = 0; c < BUFFER_COUNTERS; c++) {
+            res.files[i][c] -= other.files[i][c];
+        }
+    }
+    for (uint_fast32_t c = 0; c < BUFFER_COUNTERS; c++) {
+        res.tmp_files[c] -= other.tmp_files[c];
+    }
+    // pages in use are not a counter, the newest value is kept
+    return res;
+}
+
+
+BufferStats& BufferStats::operator+=(const BufferStats& other) {
+    if (files.size() < other.files.size()) {
+        files.resize(other.files.size());
+    }
+    for (uint_fast32_t i = 0; i < other.files.size(); i++) {
+        for (uint_fast32_t c = 0; c < BUFFER_COUNTERS; c++) {
+            files[i][c] += other.files[i][c];
+        }
+    }
+    for (uint_fast32_t c = 0; c < BUFFER_COUNTERS; c++) {
+        tmp_files[c] += other.tmp_files[c];
+    }
+    return *this;
+}
+
+
+void BufferStats::print(std::ostream& os, int indent) const {
+    os << string(indent, ' ') << "Buffer(file: hits, misses, evictions, dirty writes, pin wait)\n";
+    for (uint_fast32_t i = 0; i < files.size(); i++) {
+        auto filename = file_manager.get_filename(FileId(i));
+        print_counters(os, indent, filename.empty() ? "file " + to_string(i) : filename, files[i]);
+    }
+    print_counters(os, indent, "temporary files", tmp_files);
+    if (private_pages_total > 0) {
+        os << string(indent, ' ') << "  private buffer pages in use: "
+           << private_pages_in_use << " / " << private_pages_total << "\n";
+    }
+}
+
+
+void BufferStats::print_counters(std::ostream& os, int indent, const string& name, const PageCounters& counters) {
+    bool empty = true;
+    for (auto counter : counters) {
+        if (counter != 0) {
+            empty = false;
+        }
+    }
+    if (empty) {
+        return;
+    }
+    os << string(indent, ' ') << "  " << name << ": "
+       << counters[HITS]         << ", "
+       << counters[MISSES]       << ", "
+       << counters[EVICTIONS]    << ", "
+       << counters[DIRTY_WRITES] << ", "
+       << static_cast<double>(counters[PIN_WAIT_NS]) / 1'000'000 << " ms\n";
+}
@@ -0,0 +1,64 @@
+/*
+ * BufferStats is a snapshot of the counters the BufferManager keeps for each file: how many times a page was
+ * found in the buffer (hits) or had to be read from disk (misses), how many pages of the file were replaced
+ * (evictions) and written to disk when replaced (dirty writes), and how long threads waited for pages that
+ * other thread was reading from disk (pin wait).
+ *
+ * Files in the shared buffer are counted by FileId, all temporary files (private buffers) are counted together.
+ * Two snapshots can be subtracted to get what happened between them, e.g. during a query.
+ */
+
+#ifndef STORAGE__BUFFER_STATS_H_
+#define STORAGE__BUFFER_STATS_H_
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+enum BufferCounter {
+    HITS,
+    MISSES,
+    EVICTIONS,
+    DIRTY_WRITES,
+    PIN_WAIT_NS,
+    BUFFER_COUNTERS // number of counters, not a counter
+};
+
+using PageCounters = std::array<uint64_t, BUFFER_COUNTERS>;
+
+class BufferStats {
+public:
+    // counters are kept only for files with a smaller FileId, other files are not counted
+    static constexpr uint_fast32_t MAX_FILES = 1024;
+
+    // index used for the counters of the temporary files
+    static constexpr uint_fast32_t TMP_FILES = MAX_FILES;
+
+    // counters of files in the shared buffer, the position is the FileId
+    std::vector<PageCounters> files;
+
+    // counters of all the temporary files
+    PageCounters tmp_files = {};
+
+    // pages of the private buffers that are assigned to a temporary file, and total pages of the private buffers.
+    // Only available in the stats of the whole buffer
+    uint64_t private_pages_in_use = 0;
+    uint64_t private_pages_total  = 0;
+
+    // `file_index` is a FileId or TMP_FILES
+    void add(uint_fast32_t file_index, BufferCounter counter, uint64_t value);
+
+    BufferStats operator-(const BufferStats& other) const;
+
+    BufferStats& operator+=(const BufferStats& other);
+
+    // prints only the files that have some counter different from 0
+    void print(std::ostream& os, int indent = 0) const;
+
+private:
+    static void print_counters(std::ostream& os, int indent, const std::string& name, const PageCounters& counters);
+};
+
+#endif // STORAGE__BUFFER_STATS_H_
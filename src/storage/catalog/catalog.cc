@@ -17,6 +17,7 @@ bool Catalog::is_empty() {
 
 
 void Catalog::start_io() {
+    file.clear();
     file.seekg(0, file.beg);
 }
 
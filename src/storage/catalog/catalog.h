@@ -15,7 +15,7 @@ protected:
     // returns true if no error was detected.
     bool check_no_error_flags();
 
-    // should be called before start reading/writing the catalog
+    // should be called before start reading/writing the catalog, error flags are cleared
     void start_io();
 
     uint64_t read_uint64();
@@ -1,11 +1,18 @@
 #include "file_manager.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cerrno>
 #include <cstring>
 #include <experimental/filesystem>
 #include <new>         // placement new
 #include <type_traits> // aligned_storage
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "storage/buffer_manager.h"
 #include "storage/file_id.h"
 #include "storage/page.h"
@@ -18,8 +25,9 @@ static typename std::aligned_storage<sizeof(FileManager), alignof(FileManager)>:
 FileManager& file_manager = reinterpret_cast<FileManager&>(file_manager_buf);
 
 
-FileManager::FileManager(const std::string& db_folder) :
-    db_folder(db_folder)
+FileManager::FileManager(const std::string& db_folder, bool read_only) :
+    db_folder (db_folder),
+    read_only (read_only)
 {
     if (experimental::filesystem::exists(db_folder)) {
         if (!experimental::filesystem::is_directory(db_folder)) {
@@ -32,101 +40,208 @@ FileManager::FileManager(const std::string& db_folder) :
 }
 
 
-void FileManager::init(const std::string& db_folder) {
-    new (&file_manager) FileManager(db_folder); // placement new
+FileManager::~FileManager() {
+    for (auto& file : opened_files) {
+        if (file != nullptr) {
+            if (file->mapped_bytes != nullptr) {
+                munmap(file->mapped_bytes, file->mapped_size);
+            }
+            close(file->fd);
+        }
+    }
 }
 
 
-uint_fast32_t FileManager::count_pages(const FileId file_id) const {
-    // We don't need mutex here as long as db is readonly
-    const auto file_path = get_file_path(filenames[file_id.id]);
-    return experimental::filesystem::file_size(file_path)/Page::MDB_PAGE_SIZE;
+void FileManager::init(const std::string& db_folder, bool read_only) {
+    new (&file_manager) FileManager(db_folder, read_only); // placement new
+}
+
+
+uint_fast32_t FileManager::count_pages(const FileId file_id) const noexcept {
+    return opened_files[file_id.id]->page_count;
+}
+
+
+bool FileManager::exists(const string& filename) const {
+    return experimental::filesystem::exists(get_file_path(filename));
+}
+
+
+void FileManager::update_page_count(OpenedFile& file, uint_fast32_t page_number) const noexcept {
+    auto current_count = file.page_count.load();
+    while (current_count <= page_number
+           && !file.page_count.compare_exchange_weak(current_count, page_number + 1))
+    { }
 }
 
 
 void FileManager::flush(const PageId page_id, char* bytes) const {
-    fstream& file = get_file(page_id.file_id);
-    file.seekg(page_id.page_number*Page::MDB_PAGE_SIZE);
-    file.write(bytes, Page::MDB_PAGE_SIZE);
+    auto& file = *opened_files[page_id.file_id.id];
+    auto written = pwrite(file.fd, bytes, Page::MDB_PAGE_SIZE, page_id.page_number*Page::MDB_PAGE_SIZE);
+    if (written != Page::MDB_PAGE_SIZE) {
+        throw std::runtime_error("Could not write page " + std::to_string(page_id.page_number)
+                                 + " of file " + filenames[page_id.file_id.id]);
+    }
+    update_page_count(file, page_id.page_number);
 }
 
 
 void FileManager::read_page(const PageId page_id, char* bytes) const {
-    fstream& file = get_file(page_id.file_id);
-    file.seekg(0, file.end);
-    uint_fast32_t file_pos = file.tellg();
-    if (file_pos/Page::MDB_PAGE_SIZE <= page_id.page_number) {
+    auto& file = *opened_files[page_id.file_id.id];
+    if (file.page_count <= page_id.page_number) {
         // new file page
         memset(bytes, 0, Page::MDB_PAGE_SIZE);
-        file.write(bytes, Page::MDB_PAGE_SIZE);
+        flush(page_id, bytes);
     } else {
         // reading existing file page
-        file.seekg(page_id.page_number*Page::MDB_PAGE_SIZE);
-        file.read(bytes, Page::MDB_PAGE_SIZE);
+        auto read = read_fully(file.fd, bytes, Page::MDB_PAGE_SIZE, page_id.page_number*Page::MDB_PAGE_SIZE);
+        if (read != Page::MDB_PAGE_SIZE) {
+            throw std::runtime_error("Could not read page " + std::to_string(page_id.page_number)
+                                     + " of file " + filenames[page_id.file_id.id]);
+        }
     }
 }
 
 
-fstream& FileManager::get_file(const FileId file_id) const {
-    assert(file_id.id < opened_files.size());
+uint_fast32_t FileManager::read_pages(FileId file_id,
+                                     uint_fast32_t first_page,
+                                     uint_fast32_t page_count,
+                                     char* bytes) const
+{
+    auto& file = *opened_files[file_id.id];
+    const uint_fast32_t file_page_count = file.page_count;
+    if (first_page >= file_page_count) {
+        return 0;
+    }
+    page_count = std::min(page_count, file_page_count - first_page);
+    const auto size = page_count*Page::MDB_PAGE_SIZE;
+    auto read = read_fully(file.fd, bytes, size, uint64_t(first_page)*Page::MDB_PAGE_SIZE);
+    if (read != static_cast<ssize_t>(size)) {
+        throw std::runtime_error("Could not read pages " + std::to_string(first_page) + " to "
+                                 + std::to_string(first_page + page_count - 1) + " of file " + filenames[file_id.id]);
+    }
+    return page_count;
+}
+
+
+ssize_t FileManager::read_fully(int fd, char* bytes, size_t size, uint64_t offset) {
+    size_t total = 0;
+    while (total < size) {
+        auto read = pread(fd, bytes + total, size - total, offset + total);
+        if (read == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (read == 0) {
+            break; // end of file
+        }
+        total += read;
+    }
+    return total;
+}
+
+
+fstream& FileManager::get_file(const FileId file_id) {
+    assert(file_id.id < file_count);
     assert(opened_files[file_id.id] != nullptr);
-    assert(opened_files[file_id.id]->is_open());
 
-    return *opened_files[file_id.id];
+    auto& file = *opened_files[file_id.id];
+    if (file.stream == nullptr) {
+        file.stream = make_unique<fstream>();
+        if (read_only) {
+            file.stream->open(get_file_path(filenames[file_id.id]), ios::in|ios::binary);
+        } else {
+            file.stream->open(get_file_path(filenames[file_id.id]), ios::in|ios::out|ios::binary);
+        }
+    }
+    assert(file.stream->is_open());
+    return *file.stream;
 }
 
 
-FileId FileManager::get_file_id(const string& filename) {
-    std::lock_guard<std::mutex> lck(files_mutex);
+char* FileManager::get_mapped_bytes(const FileId file_id) const noexcept {
+    assert(read_only);
+    return opened_files[file_id.id]->mapped_bytes;
+}
 
-    // case 1: file is in the map
+
+uint64_t FileManager::get_mapped_size(const FileId file_id) const noexcept {
+    assert(read_only);
+    return opened_files[file_id.id]->mapped_size;
+}
+
+
+int FileManager::get_file_descriptor(const FileId file_id) const noexcept {
+    return opened_files[file_id.id]->fd;
+}
+
+
+unique_ptr<FileManager::OpenedFile> FileManager::open_file(const string& file_path, bool mapped) const {
+    int fd = mapped ? open(file_path.c_str(), O_RDONLY)
+                    : open(file_path.c_str(), O_RDWR|O_CREAT, 0644);
+    if (fd == -1) {
+        throw std::runtime_error("Could not open file " + file_path);
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == -1) {
+        close(fd);
+        throw std::runtime_error("Could not get the size of file " + file_path);
+    }
+    auto res = make_unique<OpenedFile>(fd, file_stat.st_size / Page::MDB_PAGE_SIZE);
+
+    if (mapped && file_stat.st_size > 0) {
+        void* bytes = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (bytes == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error("Could not map file " + file_path);
+        }
+        res->mapped_bytes = reinterpret_cast<char*>(bytes);
+        res->mapped_size  = file_stat.st_size;
+    }
+    return res;
+}
+
+
+FileId FileManager::find_file_id(const string& filename) {
+    std::lock_guard<std::mutex> lck(files_mutex);
     auto search = filename2file_id.find(filename);
     if (search != filename2file_id.end()) {
         return search->second;
     }
+    return FileId(FileId::UNASSIGNED);
+}
 
-    // case 2: file is not in the map and available_file_ids is not empty
-    else if (!available_file_ids.empty()) {
-        const auto file_path = get_file_path(filename);
-        const auto res = available_file_ids.front();
-        available_file_ids.pop();
 
-        filenames[res.id] = filename;
-        filename2file_id.insert({ filename, res });
-        auto file = make_unique<fstream>();
-        if (!experimental::filesystem::exists(file_path)) {
-            // `ios::app` creates the file if it doesn't exists but we don't want it open in append mode,
-            // so we close it and open it again without append mode
-            file->open(file_path, ios::out|ios::app);
-            if (file->fail()) {
-                throw std::runtime_error("Could not open file " + file_path);
-            }
-            file->close();
-        }
-        file->open(file_path, ios::in|ios::out|ios::binary);
-        opened_files[res.id] = move(file);
-        return res;
+string FileManager::get_filename(const FileId file_id) {
+    std::lock_guard<std::mutex> lck(files_mutex);
+    if (file_id.id >= file_count || opened_files[file_id.id] == nullptr) {
+        return "";
+    }
+    return filenames[file_id.id];
+}
+
+
+FileId FileManager::get_file_id(const string& filename) {
+    std::lock_guard<std::mutex> lck(files_mutex);
+
+    // case 1: file is in the map
+    auto search = filename2file_id.find(filename);
+    if (search != filename2file_id.end()) {
+        return search->second;
     }
 
-    // case 3: file is not in the map and available_file_ids is empty
+    // case 2: file is not in the map
     else {
-        const auto file_path = get_file_path(filename);
-        const auto res = FileId(filenames.size());
+        const auto res = new_file_id();
+        opened_files[res.id] = open_file_or_release(get_file_path(filename), read_only, res);
 
-        filenames.push_back(filename);
+        filenames[res.id] = filename;
         filename2file_id.insert({ filename, res });
-        auto file = make_unique<fstream>();
-        if (!experimental::filesystem::exists(file_path)) {
-            // `ios::app` creates the file if it doesn't exists but we don't want it open in append mode,
-            // so we close it and open it again without append mode
-            file->open(file_path, ios::out|ios::app);
-            if (file->fail()) {
-                throw std::runtime_error("Could not open file " + file_path);
-            }
-            file->close();
+        if (read_only) {
+            buffer_manager.add_mapped_file(res);
         }
-        file->open(file_path, ios::in|ios::out|ios::binary);
-        opened_files.push_back(move(file));
         return res;
     }
 }
@@ -159,49 +274,66 @@ TmpFileId FileManager::get_tmp_file_id() {
     // }
     // old thread
     
+    const auto file_id = create_tmp_file();
+    return TmpFileId(buffer_manager.get_private_buffer_index(), file_id);
+}
+
+
+TmpFileId FileManager::get_tmp_file_id(uint_fast32_t private_buffer_pos) {
+    std::lock_guard<std::mutex> lck(files_mutex);
+    const auto file_id = create_tmp_file();
+    buffer_manager.add_tmp_file(private_buffer_pos);
+    return TmpFileId(private_buffer_pos, file_id);
+}
+
+
+FileId FileManager::create_tmp_file() {
     string filename = "tmp" + std::to_string(tmp_filename_counter++);
 
+    const auto file_id = new_file_id();
+    opened_files[file_id.id] = open_file_or_release(get_file_path(filename), false, file_id);
+
+    filenames[file_id.id] = filename;
+    filename2file_id.insert({ filename, file_id });
+    return file_id;
+}
+
+
+FileId FileManager::new_file_id() {
     if (!available_file_ids.empty()) {
-        const auto file_path = get_file_path(filename);
         const auto file_id = available_file_ids.front();
         available_file_ids.pop();
-
-        filenames[file_id.id] = filename;
-        filename2file_id.insert({ filename, file_id });
-        auto file = make_unique<fstream>();
-        if (!experimental::filesystem::exists(file_path)) {
-            // `ios::app` creates the file if it doesn't exists but we don't want it open in append mode,
-            // so we close it and open it again without append mode
-            file->open(file_path, ios::out|ios::app);
-            if (file->fail()) {
-                throw std::runtime_error("Could not open file " + file_path);
-            }
-            file->close();
-        }
-        file->open(file_path, ios::in|ios::out|ios::binary);
-        opened_files[file_id.id] = move(file);
-        return TmpFileId(buffer_manager.get_private_buffer_index(), file_id);
+        return file_id;
     }
-    else {
-        const auto file_path = get_file_path(filename);
-        const auto file_id = FileId(filenames.size());
-
-        filenames.push_back(filename);
-        filename2file_id.insert({ filename, file_id });
-        auto file = make_unique<fstream>();
-        if (!experimental::filesystem::exists(file_path)) {
-            // `ios::app` creates the file if it doesn't exists but we don't want it open in append mode,
-            // so we close it and open it again without append mode
-            file->open(file_path, ios::out|ios::app);
-            if (file->fail()) {
-                throw std::runtime_error("Could not open file " + file_path);
-            }
-            file->close();
-        }
-        file->open(file_path, ios::in|ios::out|ios::binary);
-        opened_files.push_back(move(file));
-        return TmpFileId(buffer_manager.get_private_buffer_index(), file_id);
+    if (file_count == MAX_OPENED_FILES) {
+        throw std::runtime_error("Too many opened files, the limit is " + std::to_string(MAX_OPENED_FILES));
     }
+    return FileId(file_count++);
+}
+
+
+unique_ptr<FileManager::OpenedFile> FileManager::open_file_or_release(const string& file_path,
+                                                                      bool mapped,
+                                                                      FileId file_id)
+{
+    try {
+        return open_file(file_path, mapped);
+    } catch (...) {
+        available_file_ids.push(file_id);
+        throw;
+    }
+}
+
+
+uint_fast32_t FileManager::reserve_private_buffer() {
+    std::lock_guard<std::mutex> lck(files_mutex);
+    return buffer_manager.reserve_private_buffer();
+}
+
+
+void FileManager::release_private_buffer(uint_fast32_t private_buffer_pos) {
+    std::lock_guard<std::mutex> lck(files_mutex);
+    buffer_manager.release_private_buffer(private_buffer_pos);
 }
 
 
@@ -210,11 +342,11 @@ void FileManager::remove(const FileId file_id) {
     const auto file_path = get_file_path(filenames[file_id.id]);
 
     buffer_manager.remove(file_id);                 // clear pages from buffer_manager
-    opened_files[file_id.id]->close();              // close the file stream
+    close(opened_files[file_id.id]->fd);            // close the file descriptor
     std::remove(file_path.c_str());                 // delete file from disk
 
     filename2file_id.erase(filenames[file_id.id]);  // update map
-    opened_files[file_id.id].reset();               // destroy the fstream
+    opened_files[file_id.id].reset();               // destroy the fstream (if any)
     available_file_ids.push(file_id);               // add removed file_id as available for reuse
 }
 
@@ -224,10 +356,10 @@ void FileManager::remove_tmp(const TmpFileId tmp_file_id) {
     const auto file_path = get_file_path(filenames[tmp_file_id.file_id.id]);
 
     buffer_manager.remove_tmp(tmp_file_id);                     // clear pages from buffer_manager
-    opened_files[tmp_file_id.file_id.id]->close();              // close the file stream
+    close(opened_files[tmp_file_id.file_id.id]->fd);            // close the file descriptor
     std::remove(file_path.c_str());                             // delete file from disk
 
     filename2file_id.erase(filenames[tmp_file_id.file_id.id]);  // update map
-    opened_files[tmp_file_id.file_id.id].reset();               // destroy the fstream
+    opened_files[tmp_file_id.file_id.id].reset();               // destroy the fstream (if any)
     available_file_ids.push(tmp_file_id.file_id);               // add removed file_id as available for reuse
 }
\ No newline at end of file
@@ -1,11 +1,18 @@
 /*
- * FileManager mantains a list (`opened_files`) with all files that are opened,
- * and another list (`filenames`) with the string of their names.
- * The FileId its just the index, so both lists must have the same size
+ * FileManager mantains an array (`opened_files`) with all files that are opened,
+ * and another array (`filenames`) with the string of their names.
+ * The FileId its just the index, so both arrays must have the same size
  * and objects at the same index are related to each other.
  *
- * All the other clases that need to work with files should use the FileManager to obtain a reference to a
- * fstream.
+ * Pages are read and written with positional I/O (pread/pwrite) over a file descriptor, so many threads
+ * can read pages of the same file at the same time and each page read needs only one system call.
+ * The size of each file (in pages) is cached when the file is opened and updated when pages are written.
+ *
+ * Classes that don't access a file through the BufferManager (e.g. catalog and object file) can ask the
+ * FileManager for a fstream with `get_file`. Those files must not be accessed through the BufferManager.
+ *
+ * In read-only mode the files obtained with `get_file_id` must already exist, they are opened read-only and
+ * entirely memory-mapped (see BufferManager). Temporary files are created and written as usual.
  *
  * This can be done with temporary or permanent files, using 'get_tmp_file_id' or 'get_file_id', in the first case, the
  * file_manager will ask for a pages in the private buffer of the specific thread, in the second case the file_maneger
@@ -22,13 +29,14 @@
 #ifndef STORAGE__FILE_MANAGER_H_
 #define STORAGE__FILE_MANAGER_H_
 
+#include <array>
+#include <atomic>
 #include <fstream>
 #include <queue>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <string>
-#include <vector>
 
 #include "storage/file_id.h"
 #include "storage/page_id.h"
@@ -37,10 +45,23 @@ class FileManager {
 friend class Page; // to allow calling file_manager.flush
 friend class BufferManager; // to calling file_manager.read_page
 public:
-    ~FileManager() = default;
+    ~FileManager();
 
     // necesary to be called before first usage
-    static void init(const std::string& db_folder);
+    static void init(const std::string& db_folder, bool read_only = false);
+
+    inline bool is_read_only() const noexcept { return read_only; }
+
+    // get the start of the memory-mapped file, only available in read-only mode.
+    // Returns nullptr if the file is empty
+    char* get_mapped_bytes(const FileId file_id) const noexcept;
+
+    // get the size in bytes of the file when it was opened, only available in read-only mode
+    uint64_t get_mapped_size(const FileId file_id) const noexcept;
+
+    // get the file descriptor of the file, for files that are mapped by their owner instead of being read
+    // through the BufferManager (e.g. ObjectFile)
+    int get_file_descriptor(const FileId file_id) const noexcept;
 
     // Get an id for the corresponding file, creating it if it's necessary
     FileId get_file_id(const std::string& filename);
@@ -48,11 +69,35 @@ public:
     // Create a new temporary file id
     TmpFileId get_tmp_file_id();
 
+    // Create a new temporary file id that uses the private buffer `private_buffer_pos`, given by
+    // `reserve_private_buffer`, instead of the private buffer of the calling thread
+    TmpFileId get_tmp_file_id(uint_fast32_t private_buffer_pos);
+
+    // reserves a private buffer that is not tied to the calling thread, for temporary files used by threads that
+    // are replaced by other threads (e.g. the workers of a ParallelLeapfrogJoin). Thread ids are reused when a
+    // thread ends, so a private buffer found by thread id could be shared with an unrelated thread.
+    // Only one thread at a time may use the temporary files of the reserved buffer
+    uint_fast32_t reserve_private_buffer();
+
+    // gives back a private buffer given by `reserve_private_buffer`, it's available to other threads once its
+    // temporary files are removed
+    void release_private_buffer(uint_fast32_t private_buffer_pos);
+
     // get the file stream assignated to `file_id` as a reference. Only use this when not accessing via BufferManager
-    std::fstream& get_file(const FileId file_id) const;
+    std::fstream& get_file(const FileId file_id);
+
+    // get the id of a file that is already opened, or a FileId with UNASSIGNED id if it's not opened
+    FileId find_file_id(const std::string& filename);
+
+    // get the name of the file, or an empty string if `file_id` is not assigned
+    std::string get_filename(const FileId file_id);
 
     // count how many pages a file have
-    uint_fast32_t count_pages(const FileId file_id) const;
+    uint_fast32_t count_pages(const FileId file_id) const noexcept;
+
+    // true if the file exists in the database folder. Used before `get_file_id` for optional files, because in
+    // read-only mode files can't be created
+    bool exists(const std::string& filename) const;
 
     // delete the file represented by `file_id`, pages in buffer using that file_id are cleared
     void remove(const FileId file_id);
@@ -61,11 +106,40 @@ public:
     void remove_tmp(const TmpFileId tmp_file_id);
 
 private:
+    struct OpenedFile {
+        // file descriptor used for page reads and writes
+        int fd;
+
+        // cached count of pages in the file
+        std::atomic<uint_fast32_t> page_count;
+
+        // only created when `get_file` is called
+        std::unique_ptr<std::fstream> stream;
+
+        // whole file mapped into memory, only used in read-only mode
+        char* mapped_bytes = nullptr;
+        uint64_t mapped_size = 0;
+
+        OpenedFile(int fd, uint_fast32_t page_count) :
+            fd         (fd),
+            page_count (page_count) { }
+    };
+
     // folder where all the used files will be
     const std::string db_folder;
 
-    // contains all file streams that have been opened, except for these that were removed
-    std::vector< std::unique_ptr<std::fstream> > opened_files;
+    // if true, files that are not temporary are opened read-only and memory-mapped
+    const bool read_only;
+
+    // max number of files opened at the same time, counting temporary files
+    static constexpr uint_fast32_t MAX_OPENED_FILES = 4096;
+
+    // contains all files that have been opened, except for these that were removed.
+    // Threads read pages while other threads open files, so the entries must never move
+    std::array<std::unique_ptr<OpenedFile>, MAX_OPENED_FILES> opened_files;
+
+    // count of positions of `opened_files` and `filenames` that were used at least once
+    uint_fast32_t file_count = 0;
 
     std::queue<FileId> available_file_ids;
 
@@ -77,11 +151,25 @@ private:
     std::mutex files_mutex;
 
     // Contains all filenames that are being used (removed files are not in this list).
-    // The position in this vector is equivalent to the FileId representing that file
-    std::vector<std::string> filenames;
+    // The position in this array is equivalent to the FileId representing that file
+    std::array<std::string, MAX_OPENED_FILES> filenames;
+
+    // opens a new temporary file, `files_mutex` must be locked
+    FileId create_tmp_file();
+
+    // gets a removed file id or the next unused one, `files_mutex` must be locked
+    FileId new_file_id();
+
+    // same as `open_file`, but `file_id` (given by `new_file_id`) is made available again if the file
+    // can't be opened. `files_mutex` must be locked
+    std::unique_ptr<OpenedFile> open_file_or_release(const std::string& file_path, bool mapped, FileId file_id);
+
+    // reads `size` bytes at `offset`, retrying after short reads. Returns the bytes read,
+    // less than `size` only if the end of the file was reached
+    static ssize_t read_fully(int fd, char* bytes, size_t size, uint64_t offset);
 
     // private constructor, other classes must use the global object `file_manager`
-    FileManager(const std::string& db_folder);
+    FileManager(const std::string& db_folder, bool read_only);
 
     // write the data pointed by `bytes` page represented by `page_id` to disk.
     // `bytes` must point to the start memory position of `Page::MDB_PAGE_SIZE` allocated bytes
@@ -91,6 +179,17 @@ private:
     // `bytes` must point to the start memory position of `Page::MDB_PAGE_SIZE` allocated bytes
     void read_page(PageId page_id, char* bytes) const;
 
+    // read `page_count` consecutive pages starting at `first_page` with a single read. Pages beyond the end of
+    // the file are not read. Returns how many pages were read into `bytes`
+    uint_fast32_t read_pages(FileId file_id, uint_fast32_t first_page, uint_fast32_t page_count, char* bytes) const;
+
+    // opens the file creating it if it does not exist. If `mapped` is true the file must exist
+    // and it's opened read-only and memory-mapped instead
+    std::unique_ptr<OpenedFile> open_file(const std::string& file_path, bool mapped) const;
+
+    // updates the cached page count after writing the page `page_number`
+    void update_page_count(OpenedFile& file, uint_fast32_t page_number) const noexcept;
+
     inline const std::string get_file_path(const std::string& filename) const noexcept {
         return db_folder + "/" + filename;
     }
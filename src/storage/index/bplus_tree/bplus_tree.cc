@@ -1,6 +1,12 @@
 #include "bplus_tree.h"
 
+#include <algorithm>
 #include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
 
 #include "base/exceptions.h"
 #include "storage/buffer_manager.h"
@@ -24,7 +30,20 @@ template <std::size_t N>
 BPlusTree<N>::BPlusTree(const std::string& name) :
     dir_file_id  (file_manager.get_file_id(name + ".dir")),
     leaf_file_id (file_manager.get_file_id(name + ".leaf")),
-    root         (BPlusTreeDir<N>(leaf_file_id, buffer_manager.get_page(dir_file_id, 0))) { }
+    // in read-only mode a missing file can't be created, databases created before the counts don't have it
+    count_file_id(!file_manager.is_read_only() || file_manager.exists(name + ".count")
+                      ? file_manager.get_file_id(name + ".count")
+                      : FileId(FileId::UNASSIGNED)),
+    root         (BPlusTreeDir<N>(leaf_file_id, buffer_manager.get_page(dir_file_id, 0))),
+    counts_valid (false)
+{
+    if (count_file_id.id != FileId::UNASSIGNED && file_manager.count_pages(count_file_id) > 0) {
+        auto& page = buffer_manager.get_page(count_file_id, 0);
+        auto counts = reinterpret_cast<uint64_t*>(page.get_bytes());
+        counts_valid = counts[Page::MDB_PAGE_SIZE / sizeof(uint64_t) - 1] == COUNTS_VALID;
+        buffer_manager.unpin(page);
+    }
+}
 
 
 template <std::size_t N>
@@ -33,34 +52,168 @@ std::unique_ptr<BPlusTreeDir<N>> BPlusTree<N>::get_root() const noexcept {
 }
 
 
+// Leaves are filled with as many records as fit compressed. When records are too different to be compressed
+// better than `leaf_max_records` per leaf, the leaf is written uncompressed.
+// The import is pipelined: this thread reads the ordered file and decides the records of each leaf while
+// another thread compresses and writes the leaves and inserts them into the directory.
 template <std::size_t N>
 void BPlusTree<N>::bulk_import(OrderedFile<N>& leaf_provider) {
+    dir_cache.reset();
+
+    // leaves decided but not written yet, and vectors already written to be reused
+    std::deque<std::vector<std::array<uint64_t, N>>> pending_leaves;
+    std::vector<std::vector<std::array<uint64_t, N>>> free_leaves;
+    bool reading_finished = false;
+    std::exception_ptr writer_exception = nullptr;
+    std::mutex leaves_mutex;
+    std::condition_variable leaves_condition;
+
+    // records of each leaf written, only used by the writer until it finishes
+    std::vector<uint32_t> leaf_counts;
+
+    std::thread writer([&] {
+        try {
+            uint_fast32_t current_page = 0;
+            std::vector<std::array<uint64_t, N>> leaf_records;
+            while (true) {
+                bool has_next;
+                {
+                    std::unique_lock<std::mutex> lck(leaves_mutex);
+                    leaves_condition.wait(lck, [&] { return !pending_leaves.empty() || reading_finished; });
+                    if (pending_leaves.empty()) {
+                        return;
+                    }
+                    if (!leaf_records.empty()) {
+                        leaf_records.clear();
+                        free_leaves.push_back(std::move(leaf_records));
+                    }
+                    leaf_records = std::move(pending_leaves.front());
+                    pending_leaves.pop_front();
+                    // the last leaf is the only one that can be empty, when the file has no records
+                    has_next = !pending_leaves.empty() || !reading_finished;
+                }
+                leaves_condition.notify_all();
+                write_bulk_leaf(current_page, leaf_records, has_next);
+                leaf_counts.push_back(leaf_records.size());
+                current_page++;
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lck(leaves_mutex);
+            writer_exception = std::current_exception();
+            pending_leaves.clear();
+            leaves_condition.notify_all();
+        }
+    });
+
+    // returns false if the writer failed
+    auto push_leaf = [&](std::vector<std::array<uint64_t, N>>& leaf_records, bool last) {
+        {
+            std::unique_lock<std::mutex> lck(leaves_mutex);
+            leaves_condition.wait(lck, [&] {
+                return pending_leaves.size() < BULK_IMPORT_PENDING_LEAVES || writer_exception != nullptr;
+            });
+            if (writer_exception != nullptr) {
+                return false;
+            }
+            pending_leaves.push_back(std::move(leaf_records));
+            reading_finished = last;
+            if (free_leaves.empty()) {
+                leaf_records = std::vector<std::array<uint64_t, N>>();
+            } else {
+                leaf_records = std::move(free_leaves.back());
+                free_leaves.pop_back();
+            }
+        }
+        leaves_condition.notify_all();
+        return true;
+    };
+
     leaf_provider.begin_read();
-    const auto last_page_number = leaf_provider.get_last_page();
 
-    BPlusTreeLeaf<N> first_leaf(buffer_manager.get_page(leaf_file_id, 0));
-    leaf_provider.copy_to_bpt_leaf(first_leaf, 0);
-    if (last_page_number > 0) {
-        *first_leaf.next_leaf = 1;
+    std::vector<std::array<uint64_t, N>> leaf_records;
+    std::array<uint64_t, N> min = {};
+    std::array<uint64_t, N> max = {};
+    bool writer_ok = true;
+
+    for (auto record = leaf_provider.next_record();
+         record != nullptr && writer_ok;
+         record = leaf_provider.next_record())
+    {
+        if (leaf_records.empty()) {
+            min = record->ids;
+            max = record->ids;
+        } else {
+            auto new_min = min;
+            auto new_max = max;
+            for (uint_fast32_t i = 0; i < N; i++) {
+                new_min[i] = std::min(new_min[i], record->ids[i]);
+                new_max[i] = std::max(new_max[i], record->ids[i]);
+            }
+            if (leaf_records.size() >= leaf_max_records
+                && !BPlusTreeLeaf<N>::fits_compressed(leaf_records.size() + 1, new_min, new_max))
+            {
+                writer_ok = push_leaf(leaf_records, false);
+                new_min = record->ids;
+                new_max = record->ids;
+            }
+            min = new_min;
+            max = new_max;
+        }
+        leaf_records.push_back(record->ids);
+    }
+    if (writer_ok) {
+        push_leaf(leaf_records, true);
+    }
+    writer.join();
+    if (writer_exception != nullptr) {
+        std::rethrow_exception(writer_exception);
     }
-    first_leaf.page.make_dirty();
 
-    uint_fast32_t current_page = 1;
-    while (current_page <= last_page_number) {
-        BPlusTreeLeaf<N> new_leaf(buffer_manager.get_page(leaf_file_id, current_page));
-        leaf_provider.copy_to_bpt_leaf(new_leaf, current_page);
+    if (count_file_id.id != FileId::UNASSIGNED) {
+        write_counts(0, leaf_counts);
+        auto& page = buffer_manager.get_page(count_file_id, 0);
+        auto counts = reinterpret_cast<uint64_t*>(page.get_bytes());
+        counts[Page::MDB_PAGE_SIZE / sizeof(uint64_t) - 1] = COUNTS_VALID;
+        page.make_dirty();
+        buffer_manager.unpin(page);
+        counts_valid = true;
+    }
+}
 
-        assert(*new_leaf.value_count > 0);
 
-        auto next_page = current_page + 1;
-        if (next_page <= last_page_number) {
-            *new_leaf.next_leaf = next_page;
-        }
+template <std::size_t N>
+uint64_t BPlusTree<N>::write_counts(uint_fast32_t dir_page, const std::vector<uint32_t>& leaf_counts) {
+    BPlusTreeDir<N> dir(leaf_file_id, buffer_manager.get_page(dir_file_id, dir_page));
+    auto& page = buffer_manager.get_page(count_file_id, dir_page);
+    auto counts = reinterpret_cast<uint64_t*>(page.get_bytes());
 
-        root.bulk_insert(new_leaf);
-        new_leaf.page.make_dirty();
-        current_page = next_page;
+    uint64_t total = 0;
+    for (uint_fast32_t i = 0; i <= *dir.key_count; i++) {
+        const auto child = dir.children[i];
+        counts[i] = child < 0 ? write_counts(-child, leaf_counts) : leaf_counts[child];
+        total += counts[i];
     }
+    page.make_dirty();
+    buffer_manager.unpin(page);
+    return total;
+}
+
+
+template <std::size_t N>
+void BPlusTree<N>::write_bulk_leaf(uint_fast32_t page_number,
+                                   const std::vector<std::array<uint64_t, N>>& records,
+                                   bool has_next)
+{
+    BPlusTreeLeaf<N> leaf(buffer_manager.get_page(leaf_file_id, page_number));
+    leaf.write_records(records);
+    *leaf.next_leaf = has_next ? page_number + 1 : 0;
+
+    // the first leaf is already a child of the root
+    if (page_number > 0) {
+        assert(leaf.get_value_count() > 0);
+        root.bulk_insert(leaf);
+    }
+    leaf.page.make_dirty();
 }
 
 
@@ -68,14 +221,146 @@ template <std::size_t N>
 unique_ptr<BptIter<N>> BPlusTree<N>::get_range(bool* interruption_requested,
                                                const Record<N>& min,
                                                const Record<N>& max) const noexcept {
-    auto leaf_and_pos = root.search_leaf(min);
-    return make_unique<BptIter<N>>(interruption_requested, std::move(leaf_and_pos), max);
+    return make_unique<BptIter<N>>(interruption_requested, search_leaf(min), max);
+}
+
+
+template <std::size_t N>
+SearchLeafResult<N> BPlusTree<N>::search_leaf(const Record<N>& min) const noexcept {
+    if (dir_cache != nullptr) {
+        return dir_cache->search_leaf(min);
+    }
+    return root.search_leaf(min);
+}
+
+
+template <std::size_t N>
+uint_fast32_t BPlusTree<N>::load_dir_cache(uint_fast32_t levels) {
+    if (levels == 0) {
+        dir_cache.reset();
+        return 0;
+    }
+    dir_cache = make_unique<BPlusTreeDirCache<N>>(dir_file_id, leaf_file_id, levels);
+    return dir_cache->get_node_count();
+}
+
+
+template <std::size_t N>
+uint64_t BPlusTree<N>::count_range(const Record<N>& min, const Record<N>& max) const {
+    if (max < min) {
+        return 0;
+    }
+    if (counts_valid) {
+        return rank(max, true) - rank(min, false);
+    }
+    bool interruption_requested = false;
+    auto iter = get_range(&interruption_requested, min, max);
+    std::array<Record<N>, BptIter<N>::BATCH_SIZE> records;
+    uint64_t res = 0;
+    while (auto count = iter->next_batch(records.data(), records.size())) {
+        res += count;
+    }
+    return res;
+}
+
+
+template <std::size_t N>
+uint64_t BPlusTree<N>::rank(const Record<N>& record, bool inclusive) const {
+    uint64_t res = 0;
+    uint_fast32_t dir_page = 0;
+    while (true) {
+        BPlusTreeDir<N> dir(leaf_file_id, buffer_manager.get_page(dir_file_id, dir_page));
+        auto& page = buffer_manager.get_page(count_file_id, dir_page);
+        auto counts = reinterpret_cast<const uint64_t*>(page.get_bytes());
+
+        const auto index = dir.search_child_index(0, *dir.key_count, record);
+        for (int i = 0; i < index; i++) {
+            res += counts[i];
+        }
+        buffer_manager.unpin(page);
+
+        const auto child = dir.children[index];
+        if (child < 0) {
+            dir_page = -child;
+        } else {
+            BPlusTreeLeaf<N> leaf(buffer_manager.get_page(leaf_file_id, child));
+            auto pos = leaf.search_index(record);
+            if (inclusive && pos < leaf.get_value_count() && leaf.get_record(pos).ids == record.ids) {
+                pos++;
+            }
+            return res + pos;
+        }
+    }
+}
+
+
+template <std::size_t N>
+std::vector<Record<N>> BPlusTree<N>::get_separators(const Record<N>& min,
+                                                    const Record<N>& max,
+                                                    uint_fast32_t max_parts) const
+{
+    std::vector<Record<N>> keys;
+    if (max_parts <= 1 || max < min) {
+        return keys;
+    }
+
+    // directory pages of the current level that have records in the range
+    std::vector<uint_fast32_t> level_pages = { 0 };
+    while (!level_pages.empty()) {
+        keys.clear();
+        std::vector<uint_fast32_t> next_level_pages;
+        for (auto dir_page : level_pages) {
+            BPlusTreeDir<N> dir(leaf_file_id, buffer_manager.get_page(dir_file_id, dir_page));
+
+            // the keys in (min, max] are between the child of min and the child of max
+            const auto first_child = dir.search_child_index(0, *dir.key_count, min);
+            const auto last_child  = dir.search_child_index(0, *dir.key_count, max);
+            for (int i = first_child; i < last_child; i++) {
+                std::array<uint64_t, N> key;
+                std::copy_n(&dir.keys[i*N], N, key.begin());
+                keys.emplace_back(key);
+            }
+            for (int i = first_child; i <= last_child; i++) {
+                if (dir.children[i] < 0) {
+                    next_level_pages.push_back(-dir.children[i]);
+                }
+            }
+        }
+        if (keys.size() + 1 >= max_parts) {
+            break;
+        }
+        level_pages = move(next_level_pages);
+    }
+
+    if (keys.size() + 1 > max_parts) {
+        // evenly spaced keys, the indexes are different because there are more keys than separators
+        std::vector<Record<N>> separators;
+        separators.reserve(max_parts - 1);
+        for (uint_fast32_t i = 1; i < max_parts; i++) {
+            separators.push_back(keys[i * keys.size() / max_parts]);
+        }
+        return separators;
+    }
+    return keys;
 }
 
 
 template <std::size_t N>
 void BPlusTree<N>::insert(const Record<N>& record) {
-    root.insert(record);
+    dir_cache.reset();
+    if (counts_valid) {
+        auto& page = buffer_manager.get_page(count_file_id, 0);
+        auto counts = reinterpret_cast<uint64_t*>(page.get_bytes());
+        counts[Page::MDB_PAGE_SIZE / sizeof(uint64_t) - 1] = 0;
+        page.make_dirty();
+        buffer_manager.unpin(page);
+        counts_valid = false;
+    }
+    bool inserted;
+    do {
+        inserted = true;
+        root.insert(record, inserted);
+    } while (!inserted);
 }
 
 
@@ -107,39 +392,65 @@ BptIter<N>::BptIter(bool* interruption_requested,
     interruption_requested (interruption_requested),
     max                    (max),
     current_pos            (leaf_and_pos.result_index),
-    current_leaf           (move(leaf_and_pos.leaf))
-{ }
+    current_leaf           (move(leaf_and_pos.leaf)),
+    prefetched_until       (0),
+    batch_pos              (0),
+    batch_size             (0)
+{
+    set_current_leaf_end();
+}
+
+
+template <std::size_t N>
+void BptIter<N>::set_current_leaf_end() {
+    const auto value_count = current_leaf->get_value_count();
+    current_leaf_end = current_leaf->search_index(max);
+    if (current_leaf_end < value_count) {
+        // the record at current_leaf_end is the first record greater or equal than max
+        if (current_leaf->get_record(current_leaf_end).ids == max.ids) {
+            ++current_leaf_end;
+        }
+        last_leaf = true;
+    } else {
+        last_leaf = !current_leaf->has_next();
+    }
+}
 
 
 template <std::size_t N>
-unique_ptr<Record<N>> BptIter<N>::next() {
+uint_fast32_t BptIter<N>::next_batch(Record<N>* out, uint_fast32_t max_records) {
     while (true) {
         if (__builtin_expect(!!(*interruption_requested), 0)) {
             throw InterruptedException();
         }
-        if (current_pos < current_leaf->get_value_count()) {
-            unique_ptr<Record<N>> res = current_leaf->get_record(current_pos);
-            // check if res is less than max
-            for (unsigned int i = 0; i < N; ++i) {
-                if (res->ids[i] < max.ids[i]) {
-                    ++current_pos;
-                    return res;
-                }
-                else if (res->ids[i] > max.ids[i]) {
-                    return nullptr;
-                }
-                // continue iterating if res->ids[i] == max.ids[i]
-            }
-            ++current_pos;
-            return res; // res == max
+        if (current_pos < current_leaf_end) {
+            const uint_fast32_t count = std::min<uint_fast32_t>(max_records, current_leaf_end - current_pos);
+            current_leaf->get_records(current_pos, count, out);
+            current_pos += count;
+            return count;
         }
-        else if (current_leaf->has_next()) {
-            current_leaf = current_leaf->get_next_leaf();
+        else if (!last_leaf) {
+            current_leaf = current_leaf->get_next_leaf(true);
             current_pos = 0;
+            current_leaf->read_ahead(prefetched_until);
+            set_current_leaf_end();
             // continue while
         }
         else {
+            return 0;
+        }
+    }
+}
+
+
+template <std::size_t N>
+const Record<N>* BptIter<N>::next() {
+    if (batch_pos == batch_size) {
+        batch_size = next_batch(batch.data(), BATCH_SIZE);
+        batch_pos = 0;
+        if (batch_size == 0) {
             return nullptr;
         }
     }
+    return &batch[batch_pos++];
 }
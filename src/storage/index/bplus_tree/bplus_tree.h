@@ -1,32 +1,63 @@
 #ifndef STORAGE__B_PLUS_TREE_H_
 #define STORAGE__B_PLUS_TREE_H_
 
+#include <array>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "storage/file_id.h"
 #include "storage/index/bplus_tree/bplus_tree_dir.h"
+#include "storage/index/bplus_tree/bplus_tree_dir_cache.h"
 #include "storage/index/bplus_tree/bplus_tree_leaf.h"
 #include "storage/index/record.h"
 
 template <std::size_t N> class OrderedFile;
 
+// Iterates the records of a B+tree between a minimum (given by the position where the iterator starts) and
+// `max`. Records are decoded leaf by leaf into a buffer of records, so iterating doesn't allocate memory.
 template <std::size_t N> class BptIter {
 public:
+    static constexpr uint_fast32_t BATCH_SIZE = 64;
+
     BptIter(bool* interruption_requested, SearchLeafResult<N>&& leaf_and_pos, const Record<N>& max) noexcept;
     ~BptIter() = default;
-    std::unique_ptr<Record<N>> next();
+
+    // returns the next record or nullptr if there are no more records. The record is valid until the next call
+    const Record<N>* next();
+
+    // writes up to `max_records` of the next records to `out`, all of them from the same leaf. Returns the
+    // number of records written, 0 means there are no more records
+    uint_fast32_t next_batch(Record<N>* out, uint_fast32_t max_records);
 
 private:
     bool* const interruption_requested;
     const Record<N> max;
     uint32_t current_pos;
     std::unique_ptr<BPlusTreeLeaf<N>> current_leaf;
+
+    // position after the last record of current_leaf that is in the range
+    uint32_t current_leaf_end;
+
+    // true if the range ends in current_leaf
+    bool last_leaf;
+
+    // last leaf page asked to the buffer manager for read-ahead
+    uint_fast32_t prefetched_until;
+
+    // records returned by next(), from batch[batch_pos] to batch[batch_size]
+    std::array<Record<N>, BATCH_SIZE> batch;
+    uint_fast32_t batch_pos;
+    uint_fast32_t batch_size;
+
+    // sets current_leaf_end and last_leaf
+    void set_current_leaf_end();
 };
 
 
 template <std::size_t N> class BPlusTree {
 public:
+    // records of uncompressed leaves, compressed leaves usually have more (see BPlusTreeLeaf)
     // (MDB_PAGE_SIZE - SIZE_OF(value_count) - SIZE_OF(next_leaf)) / (SIZE_OF(UINT64) * N)
     static constexpr auto leaf_max_records = (Page::MDB_PAGE_SIZE - 2*sizeof(int32_t) ) / (sizeof(uint64_t)*N);
     static constexpr auto dir_max_records  = (Page::MDB_PAGE_SIZE - 2*sizeof(int32_t) ) / (sizeof(uint64_t)*N + sizeof(int32_t));
@@ -37,6 +68,9 @@ public:
     const FileId dir_file_id;
     const FileId leaf_file_id;
 
+    // file with the record counts of the subtrees, UNASSIGNED when the database doesn't have it
+    const FileId count_file_id;
+
     void bulk_import(OrderedFile<N>&);
     void insert(const Record<N>& record);
     // std::unique_ptr<Record<N>> get(const Record<N>& record);
@@ -50,9 +84,57 @@ public:
 
     std::unique_ptr<BPlusTreeDir<N>> get_root() const noexcept;
 
+    // returns the leaf and the position of the first record r >= min, using the directory cache if it is loaded
+    SearchLeafResult<N> search_leaf(const Record<N>& min) const noexcept;
+
+    // Copies the first `levels` levels of the directory to memory (see BPlusTreeDirCache), 0 drops the
+    // cache. Returns the number of directory pages cached. The cache is dropped when records are inserted
+    uint_fast32_t load_dir_cache(uint_fast32_t levels);
+
+    inline bool has_dir_cache() const noexcept { return dir_cache != nullptr; }
+
+    // returns the number of records r such that min <= r <= max. When the subtree counts are valid it only
+    // descends the tree twice, otherwise the range is scanned
+    uint64_t count_range(const Record<N>& min, const Record<N>& max) const;
+
+    // true if the subtree counts are up to date, so count_range doesn't need to scan
+    inline bool has_counts() const noexcept { return counts_valid; }
+
+    // returns up to `max_parts - 1` keys of the directory, in order, that split the records between min and max
+    // in parts of similar size: every separator s is min < s <= max. It descends the directory only until a
+    // level has enough keys in the range, so the parts are subtrees of that level and not exact in size
+    std::vector<Record<N>> get_separators(const Record<N>& min, const Record<N>& max, uint_fast32_t max_parts) const;
+
 private:
+    // Page `p` of the count file has the number of records under each child of the directory page `p`
+    // (uint64_t counts[dir_max_records + 1]). They are written by bulk_import, and the last uint64_t of the
+    // page 0 is COUNTS_VALID while they are up to date. Inserting a record invalidates them.
+    static constexpr uint64_t COUNTS_VALID = 0x4D44424350540001;
+    static_assert((dir_max_records + 2) * sizeof(uint64_t) <= Page::MDB_PAGE_SIZE,
+                  "counts of a directory page must fit in a page");
+
+    // leaves bulk_import may have decided before they are written
+    static constexpr std::size_t BULK_IMPORT_PENDING_LEAVES = 64;
+
     // bool is_empty;
     BPlusTreeDir<N> root;
+
+    std::unique_ptr<BPlusTreeDirCache<N>> dir_cache;
+
+    bool counts_valid;
+
+    // writes a leaf created by bulk_import
+    void write_bulk_leaf(uint_fast32_t page_number,
+                         const std::vector<std::array<uint64_t, N>>& records,
+                         bool has_next);
+
+    // writes the counts of the directory page `dir_page` and its descendants, `leaf_counts[i]` being the
+    // number of records in the leaf page `i`. Returns the number of records under `dir_page`
+    uint64_t write_counts(uint_fast32_t dir_page, const std::vector<uint32_t>& leaf_counts);
+
+    // number of records less than `record`, or less or equal if `inclusive`. Requires valid counts
+    uint64_t rank(const Record<N>& record, bool inclusive) const;
+
     // void create_new(const Record<N>& record); TODO: dispensable?
 };
 
@@ -9,6 +9,7 @@
 #include "storage/index/bplus_tree/bplus_tree_leaf.h"
 #include "storage/index/bplus_tree/bplus_tree.h"
 #include "storage/index/record.h"
+#include "storage/index/record_search.h"
 
 template class BPlusTreeDir<1>;
 template class BPlusTreeDir<2>;
@@ -49,7 +50,7 @@ std::unique_ptr<BPlusTreeSplit<N>> BPlusTreeDir<N>::bulk_insert(BPlusTreeLeaf<N>
         split = child.bulk_insert(leaf);
     }
     else { // positive number: pointer to leaf
-        split = make_unique<BPlusTreeSplit<N>>(*leaf.get_record(0), leaf.page.get_page_number());
+        split = make_unique<BPlusTreeSplit<N>>(leaf.get_record(0), leaf.page.get_page_number());
     }
 
     if (split != nullptr) {
@@ -120,7 +121,7 @@ std::unique_ptr<BPlusTreeSplit<N>> BPlusTreeDir<N>::bulk_insert(BPlusTreeLeaf<N>
 
 
 template <std::size_t N>
-std::unique_ptr<BPlusTreeSplit<N>> BPlusTreeDir<N>::insert(const Record<N>& record) {
+std::unique_ptr<BPlusTreeSplit<N>> BPlusTreeDir<N>::insert(const Record<N>& record, bool& inserted) {
     int index = (*key_count > 0)
         ? search_child_index(0, *key_count, record)
         : 0;
@@ -131,12 +132,12 @@ std::unique_ptr<BPlusTreeSplit<N>> BPlusTreeDir<N>::insert(const Record<N>& reco
     if (page_pointer < 0) { // negative number: pointer to dir
         auto& child_page = buffer_manager.get_page(dir_file_id, page_pointer*-1);
         auto child =  BPlusTreeDir<N>(leaf_file_id, child_page);
-        split = child.insert(record);
+        split = child.insert(record, inserted);
     }
     else { // positive number: pointer to leaf
         auto& child_page = buffer_manager.get_page(leaf_file_id, page_pointer);
         auto child =  BPlusTreeLeaf<N>(child_page);
-        split = child.insert(record);
+        split = child.insert(record, inserted);
     }
 
     if (split != nullptr) {
@@ -379,26 +380,8 @@ SearchLeafResult<N> BPlusTreeDir<N>::search_leaf(stack< unique_ptr<BPlusTreeDir<
 
 template <std::size_t N>
 int BPlusTreeDir<N>::search_child_index(int dir_from, int dir_to, const Record<N>& record) const {
-search_child_index_begin:
-    if (dir_from == dir_to) {
-        return dir_from;
-    }
-    int middle_dir = (dir_from + dir_to + 1) / 2;
-    int middle_record = middle_dir-1;
-
-    for (uint_fast32_t i = 0; i < N; i++) {
-        auto id = keys[middle_record*N + i];
-        if (record.ids[i] < id) {
-            dir_to = middle_record;
-            goto search_child_index_begin;
-        } else if (record.ids[i] > id) {
-            dir_from = middle_record+1;
-            goto search_child_index_begin;
-        }
-        // continue if they were equal
-    }
-    dir_from = middle_record+1;
-    goto search_child_index_begin;
+    // the child is at the right of the keys less or equal than the record
+    return dir_from + record_search::upper_bound<N>(&keys[dir_from*N], dir_to - dir_from, record.ids);
 }
 
 
@@ -477,9 +460,7 @@ bool BPlusTreeDir<N>::check() const {
         else { // positive number: pointer to leaf
             auto& left_page = buffer_manager.get_page(leaf_file_id, left_pointer);
             auto left_child =  BPlusTreeLeaf<N>(left_page);
-            for (uint_fast32_t j = 0; j < N; j++) {
-                greatest_left_key.ids[j] = left_child.records[((*left_child.value_count-1) * N) + j];
-            }
+            greatest_left_key.ids = left_child.get_ids(left_child.get_value_count()-1);
         }
 
         // Set smallest_right_key
@@ -498,11 +479,10 @@ bool BPlusTreeDir<N>::check() const {
         else { // positive number: pointer to leaf
             Page& right_page = buffer_manager.get_page(leaf_file_id, right_pointer);
             auto right_child =  BPlusTreeLeaf<N>(right_page);
-            for (uint_fast32_t j = 0; j < N; j++) {
-                smallest_right_key.ids[j] = right_child.records[j];
-            }
-            if (*right_child.value_count == 0) {
+            if (right_child.get_value_count() == 0) {
                 right_empty = true;
+            } else {
+                smallest_right_key.ids = right_child.get_ids(0);
             }
         }
 
@@ -10,10 +10,12 @@
 #include "storage/page.h"
 
 template <std::size_t N> class BPlusTree;
+template <std::size_t N> class BPlusTreeDirCache;
 
 template <std::size_t N>
 class BPlusTreeDir {
 friend class BPlusTree<N>;
+friend class BPlusTreeDirCache<N>;
 
 public:
     BPlusTreeDir(FileId const leaf_file_id, Page& page);
@@ -21,8 +23,9 @@ public:
 
     std::unique_ptr<BPlusTreeSplit<N>> bulk_insert(BPlusTreeLeaf<N>& leaf);
 
-    // returns not null when it needs to split
-    std::unique_ptr<BPlusTreeSplit<N>> insert(const Record<N>& record);
+    // returns not null when it needs to split. `inserted` is set to false when a compressed leaf had to be split
+    // without the record, then the insertion must be tried again
+    std::unique_ptr<BPlusTreeSplit<N>> insert(const Record<N>& record, bool& inserted);
 
     // returns a leaf and the position of the first record r >= min.
     // If there is no such record the position returned is at the end of the leaf
@@ -0,0 +1,69 @@
+#include "bplus_tree_dir_cache.h"
+
+#include "storage/buffer_manager.h"
+#include "storage/index/bplus_tree/bplus_tree_dir.h"
+#include "storage/index/record_search.h"
+
+template class BPlusTreeDirCache<1>;
+template class BPlusTreeDirCache<2>;
+template class BPlusTreeDirCache<3>;
+template class BPlusTreeDirCache<4>;
+
+using namespace std;
+
+template <std::size_t N>
+BPlusTreeDirCache<N>::BPlusTreeDirCache(FileId dir_file_id, FileId leaf_file_id, uint_fast32_t levels) :
+    dir_file_id  (dir_file_id),
+    leaf_file_id (leaf_file_id)
+{
+    // page number and level of each node, nodes are added when their parent is copied
+    vector<pair<uint32_t, uint32_t>> node_pages;
+    nodes.push_back(Node());
+    node_pages.push_back({ 0, 1 });
+
+    for (uint_fast32_t n = 0; n < nodes.size(); n++) {
+        const auto page_number = node_pages[n].first;
+        const auto level       = node_pages[n].second;
+        BPlusTreeDir<N> dir(leaf_file_id, buffer_manager.get_page(dir_file_id, page_number));
+
+        auto& node = nodes[n];
+        node.first_key       = keys.size() / N;
+        node.first_child     = children.size();
+        node.key_count       = *dir.key_count;
+        node.children_cached = level < levels;
+
+        keys.insert(keys.end(), dir.keys, dir.keys + (*dir.key_count)*N);
+        for (uint_fast32_t i = 0; i <= *dir.key_count; i++) {
+            const auto child = dir.children[i];
+            if (child < 0 && level < levels) {
+                children.push_back(-static_cast<int32_t>(nodes.size()));
+                node_pages.push_back({ static_cast<uint32_t>(-child), level + 1 });
+                nodes.push_back(Node());
+            } else {
+                children.push_back(child);
+            }
+        }
+    }
+}
+
+
+template <std::size_t N>
+SearchLeafResult<N> BPlusTreeDirCache<N>::search_leaf(const Record<N>& min) const noexcept {
+    uint_fast32_t n = 0;
+    while (true) {
+        const auto& node = nodes[n];
+        const auto child_index = record_search::upper_bound<N>(&keys[node.first_key*N], node.key_count, min.ids);
+        const auto child = children[node.first_child + child_index];
+
+        if (child >= 0) { // leaf
+            auto leaf = make_unique<BPlusTreeLeaf<N>>(buffer_manager.get_page(leaf_file_id, child));
+            auto index = leaf->search_index(min);
+            return SearchLeafResult(move(leaf), index);
+        } else if (node.children_cached) {
+            n = -child;
+        } else { // directory that is not cached
+            BPlusTreeDir<N> dir(leaf_file_id, buffer_manager.get_page(dir_file_id, -child));
+            return dir.search_leaf(min);
+        }
+    }
+}
@@ -0,0 +1,57 @@
+/*
+ * BPlusTreeDirCache is a copy in memory of the upper levels of the directory of a B+tree. Searches going
+ * through the cached levels don't ask the buffer manager for directory pages, so they don't look up the page
+ * table nor pin and unpin pages, and only the leaf (and the directory levels that are not cached) is read
+ * from the buffer.
+ *
+ * The nodes are stored in breadth-first order, with the keys of all the nodes in one array and the children
+ * in another. The children that are cached directories point to the position of the node in memory instead
+ * of the page number of the directory.
+ *
+ * The cache is not updated when records are inserted, BPlusTree drops it when the B+tree changes.
+ */
+
+#ifndef STORAGE__B_PLUS_TREE_DIR_CACHE_H_
+#define STORAGE__B_PLUS_TREE_DIR_CACHE_H_
+
+#include <vector>
+
+#include "storage/file_id.h"
+#include "storage/index/bplus_tree/bplus_tree_leaf.h"
+#include "storage/index/record.h"
+
+template <std::size_t N>
+class BPlusTreeDirCache {
+public:
+    // caches the first `levels` levels of the directory, the root is the first level
+    BPlusTreeDirCache(FileId dir_file_id, FileId leaf_file_id, uint_fast32_t levels);
+    ~BPlusTreeDirCache() = default;
+
+    // same as BPlusTreeDir::search_leaf
+    SearchLeafResult<N> search_leaf(const Record<N>& min) const noexcept;
+
+    inline uint_fast32_t get_node_count() const noexcept { return nodes.size(); }
+
+private:
+    struct Node {
+        // position of the first key in `keys` (in records) and of the first child in `children`
+        uint32_t first_key;
+        uint32_t first_child;
+        uint32_t key_count;
+
+        // if true, children that are directories point to the node in `nodes`, otherwise they are page numbers
+        // of the directory file
+        bool children_cached;
+    };
+
+    const FileId dir_file_id;
+    const FileId leaf_file_id;
+
+    std::vector<Node> nodes;
+    std::vector<uint64_t> keys;
+
+    // positive number: page number of a leaf, negative number: a directory (as in BPlusTreeDir)
+    std::vector<int32_t> children;
+};
+
+#endif // STORAGE__B_PLUS_TREE_DIR_CACHE_H_
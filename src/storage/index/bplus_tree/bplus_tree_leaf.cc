@@ -1,10 +1,12 @@
 #include "bplus_tree_leaf.h"
 
+#include <algorithm>
 #include <iostream>
 #include <cstring>
 
 #include "storage/buffer_manager.h"
 #include "storage/index/bplus_tree/bplus_tree.h"
+#include "storage/index/record_search.h"
 
 template class BPlusTreeLeaf<1>;
 template class BPlusTreeLeaf<2>;
@@ -13,14 +15,66 @@ template class BPlusTreeLeaf<4>;
 
 using namespace std;
 
+namespace {
+    // bits needed to store values from 0 to `range`
+    inline uint_fast8_t bits_for(uint64_t range) {
+        return range == 0 ? 0 : 64 - __builtin_clzll(range);
+    }
+
+    inline uint64_t read_bits(const char* bytes, uint64_t bit, uint_fast8_t bits) {
+        if (bits == 0) {
+            return 0;
+        }
+        const auto shift = bit % 8;
+        uint64_t word;
+        std::memcpy(&word, bytes + bit/8, sizeof(word));
+        auto res = word >> shift;
+        if (shift + bits > 64) {
+            res |= static_cast<uint64_t>(static_cast<uint8_t>(bytes[bit/8 + 8])) << (64 - shift);
+        }
+        return bits == 64 ? res : res & ((1ULL << bits) - 1);
+    }
+
+    // the bits written must be 0
+    inline void write_bits(char* bytes, uint64_t bit, uint_fast8_t bits, uint64_t value) {
+        if (bits == 0) {
+            return;
+        }
+        const auto shift = bit % 8;
+        uint64_t word;
+        std::memcpy(&word, bytes + bit/8, sizeof(word));
+        word |= value << shift;
+        std::memcpy(bytes + bit/8, &word, sizeof(word));
+        if (shift + bits > 64) {
+            bytes[bit/8 + 8] |= static_cast<char>(value >> (64 - shift));
+        }
+    }
+}
+
+
 template <std::size_t N>
 BPlusTreeLeaf<N>::BPlusTreeLeaf(Page& page) :
-    page         (page),
-    leaf_file_id (page.page_id.file_id),
-    value_count  ( reinterpret_cast<uint32_t*>(page.get_bytes()) ),
-    next_leaf    ( reinterpret_cast<uint32_t*>(page.get_bytes() + sizeof(uint32_t)) ),
-    records      ( reinterpret_cast<uint64_t*>(page.get_bytes() + (2*sizeof(uint32_t)) ) )
-{ }
+    page           (page),
+    leaf_file_id   (page.page_id.file_id),
+    value_count    ( reinterpret_cast<uint32_t*>(page.get_bytes()) ),
+    next_leaf      ( reinterpret_cast<uint32_t*>(page.get_bytes() + sizeof(uint32_t)) ),
+    records        ( reinterpret_cast<uint64_t*>(page.get_bytes() + (2*sizeof(uint32_t)) ) ),
+    column_bits    ( reinterpret_cast<uint8_t*>(page.get_bytes() + (2*sizeof(uint32_t)) + N*sizeof(uint64_t)) ),
+    packed_records ( page.get_bytes() + COMPRESSED_HEADER_SIZE )
+{
+    set_record_bits();
+}
+
+
+template <std::size_t N>
+void BPlusTreeLeaf<N>::set_record_bits() {
+    record_bits = 0;
+    if (is_compressed()) {
+        for (uint_fast32_t i = 0; i < N; i++) {
+            record_bits += column_bits[i];
+        }
+    }
+}
 
 
 template <std::size_t N>
@@ -30,12 +84,121 @@ BPlusTreeLeaf<N>::~BPlusTreeLeaf() {
 
 
 template <std::size_t N>
-unique_ptr<Record<N>> BPlusTreeLeaf<N>::get_record(uint_fast32_t pos) const {
+std::array<uint64_t, N> BPlusTreeLeaf<N>::get_ids(uint_fast32_t pos) const {
     std::array<uint64_t, N> ids;
+    if (is_compressed()) {
+        uint64_t bit = static_cast<uint64_t>(pos) * record_bits;
+        for (uint_fast32_t i = 0; i < N; i++) {
+            ids[i] = records[i] + read_bits(packed_records, bit, column_bits[i]);
+            bit += column_bits[i];
+        }
+    } else {
+        for (uint_fast32_t i = 0; i < N; i++) {
+            ids[i] = records[pos*N + i];
+        }
+    }
+    return ids;
+}
+
+
+template <std::size_t N>
+Record<N> BPlusTreeLeaf<N>::get_record(uint_fast32_t pos) const {
+    return Record<N>(get_ids(pos));
+}
+
+
+template <std::size_t N>
+void BPlusTreeLeaf<N>::get_records(uint_fast32_t pos, uint_fast32_t count, Record<N>* out) const {
+    if (is_compressed()) {
+        uint64_t bit = static_cast<uint64_t>(pos) * record_bits;
+        for (uint_fast32_t r = 0; r < count; r++) {
+            for (uint_fast32_t i = 0; i < N; i++) {
+                out[r].ids[i] = records[i] + read_bits(packed_records, bit, column_bits[i]);
+                bit += column_bits[i];
+            }
+        }
+    } else {
+        const uint64_t* src = records + pos*N;
+        for (uint_fast32_t r = 0; r < count; r++) {
+            for (uint_fast32_t i = 0; i < N; i++) {
+                out[r].ids[i] = src[r*N + i];
+            }
+        }
+    }
+}
+
+
+template <std::size_t N>
+std::vector<std::array<uint64_t, N>> BPlusTreeLeaf<N>::get_all_records() const {
+    std::vector<std::array<uint64_t, N>> res;
+    const auto count = get_value_count();
+    res.reserve(count + 1);
+    for (uint_fast32_t i = 0; i < count; i++) {
+        res.push_back(get_ids(i));
+    }
+    return res;
+}
+
+
+template <std::size_t N>
+bool BPlusTreeLeaf<N>::fits_compressed(uint_fast32_t count,
+                                       const std::array<uint64_t, N>& min,
+                                       const std::array<uint64_t, N>& max)
+{
+    uint64_t bits = 0;
     for (uint_fast32_t i = 0; i < N; i++) {
-        ids[i] = records[pos*N + i];
+        bits += bits_for(max[i] - min[i]);
     }
-    return make_unique<Record<N>>(move(ids));
+    const auto packed_bytes = (count * bits + 7) / 8;
+    return COMPRESSED_HEADER_SIZE + packed_bytes + COMPRESSED_PADDING <= Page::MDB_PAGE_SIZE;
+}
+
+
+template <std::size_t N>
+void BPlusTreeLeaf<N>::write_records(const std::vector<std::array<uint64_t, N>>& new_records) {
+    std::array<uint64_t, N> min;
+    std::array<uint64_t, N> max;
+    for (uint_fast32_t i = 0; i < N; i++) {
+        min[i] = UINT64_MAX;
+        max[i] = 0;
+    }
+    for (const auto& record : new_records) {
+        for (uint_fast32_t i = 0; i < N; i++) {
+            min[i] = std::min(min[i], record[i]);
+            max[i] = std::max(max[i], record[i]);
+        }
+    }
+    // the value count and next leaf are kept at the begining of the page
+    std::memset(page.get_bytes() + 2*sizeof(uint32_t), 0, Page::MDB_PAGE_SIZE - 2*sizeof(uint32_t));
+
+    if (!new_records.empty() && fits_compressed(new_records.size(), min, max)) {
+        *value_count = new_records.size() | COMPRESSED_LEAF;
+        for (uint_fast32_t i = 0; i < N; i++) {
+            records[i]     = min[i];
+            column_bits[i] = bits_for(max[i] - min[i]);
+        }
+        set_record_bits();
+
+        uint64_t bit = 0;
+        for (const auto& record : new_records) {
+            for (uint_fast32_t i = 0; i < N; i++) {
+                write_bits(packed_records, bit, column_bits[i], record[i] - min[i]);
+                bit += column_bits[i];
+            }
+        }
+    } else {
+        if (new_records.size() > BPlusTree<N>::leaf_max_records) {
+            throw std::logic_error("Records don't fit into a BPlusTreeLeaf.");
+        }
+        *value_count = new_records.size();
+        set_record_bits();
+        for (uint_fast32_t r = 0; r < new_records.size(); r++) {
+            for (uint_fast32_t i = 0; i < N; i++) {
+                records[r*N + i] = new_records[r][i];
+            }
+        }
+    }
+    page.make_dirty();
 }
 
 
@@ -46,28 +209,52 @@ std::unique_ptr<BPlusTreeLeaf<N>>  BPlusTreeLeaf<N>::duplicate() const {
 
 
 template <std::size_t N>
-unique_ptr<BPlusTreeLeaf<N>> BPlusTreeLeaf<N>::get_next_leaf() const {
-    Page& new_page = buffer_manager.get_page(leaf_file_id, *next_leaf);
+unique_ptr<BPlusTreeLeaf<N>> BPlusTreeLeaf<N>::get_next_leaf(bool low_priority) const {
+    Page& new_page = buffer_manager.get_page(leaf_file_id, *next_leaf, low_priority);
     return make_unique<BPlusTreeLeaf<N>>(new_page);
 }
 
 
 template <std::size_t N>
-unique_ptr<BPlusTreeSplit<N>> BPlusTreeLeaf<N>::insert(const Record<N>& record) {
+void BPlusTreeLeaf<N>::read_ahead(uint_fast32_t& prefetched_until) const {
+    const auto read_ahead_pages = buffer_manager.get_read_ahead_pages();
+    const auto page_number = page.get_page_number();
+    if (read_ahead_pages == 0 || *next_leaf != page_number + 1) {
+        return;
+    }
+    // requests are made in batches of half the read-ahead window to avoid asking for pages one by one
+    if (prefetched_until > page_number && prefetched_until - page_number > read_ahead_pages / 2) {
+        return;
+    }
+    auto first = std::max(prefetched_until, page_number) + 1;
+    prefetched_until = page_number + read_ahead_pages;
+    for (auto i = first; i <= prefetched_until; i++) {
+        buffer_manager.prefetch(leaf_file_id, i);
+    }
+}
+
+
+template <std::size_t N>
+unique_ptr<BPlusTreeSplit<N>> BPlusTreeLeaf<N>::insert(const Record<N>& record, bool& inserted) {
     uint_fast32_t index = search_index(record);
     if (equal_record(record, index)) {
         for (uint_fast32_t i = 0; i < N; i++) {
             cout << record.ids[i] << " ";
         }
         cout << "\n";
+        auto ids = get_ids(index);
         for (uint_fast32_t i = 0; i < N; i++) {
-            cout << records[N*index + i] << " ";
+            cout << ids[i] << " ";
         }
         cout << "\n";
 
         throw std::logic_error("Inserting duplicated record into BPlusTree.");
     }
 
+    if (is_compressed()) {
+        return insert_compressed(record, index, inserted);
+    }
+
     if ((*value_count) < BPlusTree<N>::leaf_max_records) {
         shift_right_records(index, (*value_count)-1);
 
@@ -138,6 +325,72 @@ unique_ptr<BPlusTreeSplit<N>> BPlusTreeLeaf<N>::insert(const Record<N>& record)
 }
 
 
+// Compressed leaves are decoded and written again. When the records don't fit anymore the leaf is split in two
+// halves, or next to the new record when it is much different from the others (e.g. it needs more bits for
+// some column). If neither works the records of the leaf are split at the position of the new record, without
+// it, then inserting it again puts it at the end or at the begining of a leaf, which can always be split next
+// to it.
+template <std::size_t N>
+unique_ptr<BPlusTreeSplit<N>> BPlusTreeLeaf<N>::insert_compressed(const Record<N>& record,
+                                                                  uint_fast32_t index,
+                                                                  bool& inserted)
+{
+    auto all_records = get_all_records();
+    all_records.insert(all_records.begin() + index, record.ids);
+
+    auto fits = [&all_records](uint_fast32_t begin, uint_fast32_t end) {
+        if (end - begin <= BPlusTree<N>::leaf_max_records) {
+            return true;
+        }
+        std::array<uint64_t, N> min = all_records[begin];
+        std::array<uint64_t, N> max = all_records[begin];
+        for (auto r = begin; r < end; r++) {
+            for (uint_fast32_t i = 0; i < N; i++) {
+                min[i] = std::min(min[i], all_records[r][i]);
+                max[i] = std::max(max[i], all_records[r][i]);
+            }
+        }
+        return fits_compressed(end - begin, min, max);
+    };
+
+    const uint_fast32_t size = all_records.size();
+    if (fits(0, size)) {
+        write_records(all_records);
+        return nullptr;
+    }
+    for (auto split_index : { size / 2, index, index + 1 }) {
+        if (split_index > 0 && split_index < size && fits(0, split_index) && fits(split_index, size)) {
+            return split_compressed(all_records, split_index);
+        }
+    }
+    // 0 < index < size - 1, otherwise splitting next to the new record would have worked
+    all_records.erase(all_records.begin() + index);
+    inserted = false;
+    return split_compressed(all_records, index);
+}
+
+
+template <std::size_t N>
+unique_ptr<BPlusTreeSplit<N>> BPlusTreeLeaf<N>::split_compressed(
+    const std::vector<std::array<uint64_t, N>>& all_records,
+    uint_fast32_t split_index)
+{
+    std::vector<std::array<uint64_t, N>> left_records(all_records.begin(), all_records.begin() + split_index);
+    std::vector<std::array<uint64_t, N>> right_records(all_records.begin() + split_index, all_records.end());
+
+    auto& new_page = buffer_manager.append_page(leaf_file_id);
+    auto new_leaf = BPlusTreeLeaf<N>(new_page);
+
+    *new_leaf.next_leaf = *next_leaf;
+    *next_leaf = new_leaf.page.get_page_number();
+
+    write_records(left_records);
+    new_leaf.write_records(right_records);
+
+    return make_unique<BPlusTreeSplit<N>>(Record<N>(right_records.front()), new_page.get_page_number());
+}
+
+
 // template <std::size_t N>
 // void BPlusTreeLeaf<N>::create_new(const Record<N>& record) {
 //     for (uint_fast32_t i = 0; i < N; i++) {
@@ -148,38 +401,46 @@ unique_ptr<BPlusTreeSplit<N>> BPlusTreeLeaf<N>::insert(const Record<N>& record)
 // }
 
 
-// returns the position of the minimum key greater or equal than the record given.
-// if there is no such key, returns (to + 1)
 template <std::size_t N>
 uint_fast32_t BPlusTreeLeaf<N>::search_index(const Record<N>& record) const {
-    int from = 0;
-    int to = (*value_count)-1;
-search_index_begin:
-    if (from < to) {
-        auto middle = (from + to) / 2;
+    return lower_bound(0, get_value_count(), record);
+}
 
-        for (uint_fast32_t i = 0; i < N; i++) {
-            auto id = records[middle*N + i];
-            if (record.ids[i] < id) { // record is smaller
-                to = middle - 1;
-                goto search_index_begin;
-            } else if (record.ids[i] > id) { // record is greater
-                from = middle + 1;
-                goto search_index_begin;
-            }
+
+template <std::size_t N>
+uint_fast32_t BPlusTreeLeaf<N>::search_index_from(const Record<N>& record, uint_fast32_t from) const {
+    const uint_fast32_t value_count = get_value_count();
+    // probe from, from+1, from+3, from+7... until a record is not less than `record`, the result is between the
+    // last two probes
+    uint_fast32_t low  = from;
+    uint_fast32_t step = 1;
+    while (true) {
+        const auto probe = low + step - 1;
+        if (probe >= value_count) {
+            return lower_bound(low, value_count, record);
+        }
+        if (!(get_ids(probe) < record.ids)) {
+            return lower_bound(low, probe, record);
         }
-        // record is equal
-        return middle;
+        low = probe + 1;
+        step *= 2;
+    }
+}
+
+
+template <std::size_t N>
+uint_fast32_t BPlusTreeLeaf<N>::lower_bound(uint_fast32_t from, uint_fast32_t to, const Record<N>& record) const {
+    if (!is_compressed()) {
+        return from + record_search::lower_bound<N>(records + from*N, to - from, record.ids);
     }
-    // from >= to
-    for (uint_fast32_t i = 0; i < N; ++i) {
-        auto id = records[from*N + i];
-        if (record.ids[i] < id) {
-            return from;
-        } else if (record.ids[i] > id) {
-            return from + 1;
+    // records of compressed leaves are decoded as the binary search visits them
+    while (from < to) {
+        const auto middle = from + (to - from) / 2;
+        if (get_ids(middle) < record.ids) {
+            from = middle + 1;
+        } else {
+            to = middle;
         }
-        // continue if they were equal
     }
     return from;
 }
@@ -196,26 +457,20 @@ void BPlusTreeLeaf<N>::shift_right_records(int from, int to) {
 
 template <std::size_t N>
 bool BPlusTreeLeaf<N>::equal_record(const Record<N>& record, uint_fast32_t index) {
-    for (uint_fast32_t i = 0; i < N; i++) {
-        if (records[N*index + i] != record.ids[i]) {
-            return false;
-        }
+    if (index >= get_value_count()) {
+        return false;
     }
-    return true;
+    return get_ids(index) == record.ids;
 }
 
 
 template <std::size_t N>
 bool BPlusTreeLeaf<N>::check_range(const Record<N>& r) const {
-    if (*value_count == 0) {
+    if (get_value_count() == 0) {
         return false;
     }
-    std::array<uint64_t, N> min;
-    std::array<uint64_t, N> max;
-    for (uint_fast32_t i = 0; i < N; i++) {
-        min[i] = records[0*N + i];
-        max[i] = records[(*value_count-1)*N + i];
-    }
+    const auto min = get_ids(0);
+    const auto max = get_ids(get_value_count()-1);
 
     return min <= r.ids && r.ids <= max;
 }
@@ -224,12 +479,13 @@ bool BPlusTreeLeaf<N>::check_range(const Record<N>& r) const {
 template <std::size_t N>
 void BPlusTreeLeaf<N>::print() const {
     cout << "Printing Leaf:\n";
-    for (uint_fast32_t i = 0; i < (*value_count); i++) {
+    for (uint_fast32_t i = 0; i < get_value_count(); i++) {
+        const auto ids = get_ids(i);
         cout << "  (";
         for (uint_fast32_t j = 0; j < N; j++) {
             if (j != 0)
                 cout << ", ";
-            cout << records[i*N + j];
+            cout << ids[j];
         }
         cout << ")\n";
     }
@@ -238,7 +494,7 @@ void BPlusTreeLeaf<N>::print() const {
 
 template <std::size_t N>
 bool BPlusTreeLeaf<N>::check() const {
-    if ((*value_count) == 0) {
+    if (get_value_count() == 0) {
         if (page.get_page_number() == 0) {
             cout << "  WARNING: empty leaf. Ok only if the b+tree is empty.\n";
         } else {
@@ -247,23 +503,18 @@ bool BPlusTreeLeaf<N>::check() const {
         }
     } else {
         // check keys are ordered
-        std::array<uint64_t, N> x;
+        std::array<uint64_t, N> x = get_ids(0);
         std::array<uint64_t, N> y;
 
-        uint_fast32_t current_pos = 0;
-        while (current_pos < N) {
-            if (records[current_pos] == 0xFFFF'FFFF'FFFF'FFFF) {
+        for (uint_fast32_t i = 0; i < N; i++) {
+            if (x[i] == 0xFFFF'FFFF'FFFF'FFFF) {
                 cerr << "  ERROR: record not_found(0xFFFF'FFFF'FFFF'FFFF) at BPlusTreeLeaf\n";
                 return false;
             }
-            x[current_pos] = records[current_pos];
-            current_pos++;
         }
 
-        for (uint_fast32_t k = 1; k < (*value_count); k++) {
-            for (uint_fast32_t i = 0; i < N; i++) {
-                y[i] = records[current_pos++];
-            }
+        for (uint_fast32_t k = 1; k < get_value_count(); k++) {
+            y = get_ids(k);
             if (y <= x) {
                 cerr << "  ERROR: bad record order at BPlusTreeLeaf(page: " << page.get_page_number() << ")\n";
                 for (size_t n = 0; n < N; n++) {
@@ -1,7 +1,9 @@
 #ifndef STORAGE__B_PLUS_TREE_LEAF_H_
 #define STORAGE__B_PLUS_TREE_LEAF_H_
 
+#include <array>
 #include <memory>
+#include <vector>
 
 #include "storage/index/bplus_tree/bplus_tree_split.h"
 #include "storage/index/record.h"
@@ -24,18 +26,36 @@ struct SearchLeafResult {
 };
 
 
+// A leaf stores its records in one of two formats. Uncompressed leaves have an array of `N` uint64_t for each
+// record. Compressed leaves (marked with COMPRESSED_LEAF in the value count) store for each column the minimum
+// value in the leaf and the bits needed for the difference to the maximum, then each record is packed using
+// those bits. Columns that are equal in all the records of the leaf (e.g. the shared prefix of the records) use
+// no bits. Every record has the same size, so records can still be accessed by position and binary searched.
 template <std::size_t N>
 class BPlusTreeLeaf {
 friend class BPlusTreeDir<N>;
 friend class BPlusTree<N>;
 
 public:
+    static constexpr uint32_t COMPRESSED_LEAF = 1U << 31;
+
     BPlusTreeLeaf(Page& page);
     ~BPlusTreeLeaf();
 
     Page& get_page()           const noexcept { return page; }
-    uint32_t get_value_count() const { return *value_count; }
+    uint32_t get_value_count() const { return *value_count & ~COMPRESSED_LEAF; }
     bool has_next()            const { return *next_leaf != 0; }
+    bool is_compressed()       const { return (*value_count & COMPRESSED_LEAF) != 0; }
+
+    // returns true if `count` records with values between `min` and `max` (for each column) fit in a
+    // compressed leaf
+    static bool fits_compressed(uint_fast32_t count,
+                                const std::array<uint64_t, N>& min,
+                                const std::array<uint64_t, N>& max);
+
+    // replaces the records of the leaf, compressing them if they fit. `records` must be ordered and if they don't
+    // fit compressed there can't be more than BPlusTree<N>::leaf_max_records. Doesn't modify `next_leaf`
+    void write_records(const std::vector<std::array<uint64_t, N>>& records);
 
     // returns false if an error in this leaf is found
     bool check() const;
@@ -43,29 +63,78 @@ public:
     // only for debugging
     void print() const;
 
-    std::unique_ptr<BPlusTreeSplit<N>> insert(const Record<N>& record);
+    // `inserted` is set to false when the leaf is compressed and had to be split without the record (see
+    // insert_compressed), the record must be inserted again
+    std::unique_ptr<BPlusTreeSplit<N>> insert(const Record<N>& record, bool& inserted);
 
     std::unique_ptr<BPlusTreeLeaf<N>> duplicate() const;
-    std::unique_ptr<BPlusTreeLeaf<N>> get_next_leaf() const;
-    std::unique_ptr<Record<N>> get_record(uint_fast32_t pos) const; // asumes pos is valid
+    // scans going through many leaves should set `low_priority`, see BufferManager::get_page
+    std::unique_ptr<BPlusTreeLeaf<N>> get_next_leaf(bool low_priority = false) const;
+    Record<N> get_record(uint_fast32_t pos) const; // asumes pos is valid
+
+    // writes the records in [pos, pos + count) to `out`, decoding them sequentially if the leaf is compressed.
+    // Asumes the positions are valid
+    void get_records(uint_fast32_t pos, uint_fast32_t count, Record<N>* out) const;
+
+    // Called when a scan arrives to this leaf from the previous one. If the next leaf is the next page of
+    // the file (as leaves created by bulk_import are) the scan is considered sequential and the buffer
+    // manager is asked to prefetch the following leaves. `prefetched_until` is the last page the scan
+    // already asked for, and it is updated.
+    void read_ahead(uint_fast32_t& prefetched_until) const;
 
     // Search for the first record that is equal or greater than the parameter recived.
-    // May give an invalid index, meaning there is no such record is on this page.
+    // May give an invalid index (the value count), meaning there is no such record is on this page.
     // If the next leaf is not null, the desired record should be the first record of that leaf,
     // otherwise the record is not in the B+tree.
     uint_fast32_t search_index(const Record<N>& record) const;
 
+    // Same as search_index, but the records before `from` must be less than `record`. It's a galloping search:
+    // positions at increasing distances from `from` are probed before the binary search, so records close to
+    // `from` are found with few comparisons
+    uint_fast32_t search_index_from(const Record<N>& record, uint_fast32_t from) const;
+
     // returns true if min_record <= r <= max_record. If the leaf is empty will return false.
     // used in leapfrog to know if the search can be done from here or from a upper directory in the branch
     bool check_range(const Record<N>& r) const;
 
 private:
+    // value count, next leaf, and minimum and bits of each column of compressed leaves, aligned to 8 bytes
+    static constexpr std::size_t COMPRESSED_HEADER_SIZE = (2*sizeof(uint32_t) + N*sizeof(uint64_t) + N + 7) / 8 * 8;
+
+    // bytes not used at the end of compressed leaves, so a record can be decoded reading whole uint64_t
+    static constexpr std::size_t COMPRESSED_PADDING = 2*sizeof(uint64_t);
+
     Page& page;
     const FileId leaf_file_id;
     uint32_t* const value_count;
     uint32_t* const next_leaf;
+
+    // uncompressed records, or the minimum value of each column when the leaf is compressed
     uint64_t* const records;
 
+    // bits of each column when the leaf is compressed
+    uint8_t* const column_bits;
+
+    // packed records of compressed leaves
+    char* const packed_records;
+
+    // sum of the bits of all the columns of compressed leaves
+    uint_fast32_t record_bits;
+
+    // returns the record at `pos`, decoding it if the leaf is compressed
+    std::array<uint64_t, N> get_ids(uint_fast32_t pos) const;
+
+    // position of the first record in [from, to) greater or equal than `record`, `to` if there is none
+    uint_fast32_t lower_bound(uint_fast32_t from, uint_fast32_t to, const Record<N>& record) const;
+
+    void set_record_bits();
+    std::vector<std::array<uint64_t, N>> get_all_records() const;
+    std::unique_ptr<BPlusTreeSplit<N>> insert_compressed(const Record<N>& record, uint_fast32_t index, bool& inserted);
+
+    // moves the records from `split_index` to a new leaf
+    std::unique_ptr<BPlusTreeSplit<N>> split_compressed(const std::vector<std::array<uint64_t, N>>& all_records,
+                                                        uint_fast32_t split_index);
+
     bool equal_record(const Record<N>& record, uint_fast32_t index);
     void shift_right_records(int from, int to);
 };
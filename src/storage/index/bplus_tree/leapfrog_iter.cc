@@ -21,11 +21,9 @@ LeapfrogBptIter<N>::LeapfrogBptIter(bool*                         interruption_r
     LeapfrogIter (interruption_requested,
                   move(_initial_ranges),
                   move(_intersection_vars),
-                  move(_enumeration_vars))
+                  move(_enumeration_vars)),
+    btree        (btree)
 {
-    auto root = btree.get_root();
-    directory_stack.push( move(root) );
-
     // there is a border case when nothing is done, but enumeration, so we must
     // position at the first record
     array<uint64_t, N> min;
@@ -33,7 +31,13 @@ LeapfrogBptIter<N>::LeapfrogBptIter(bool*                         interruption_r
         min[i] = 0;
     }
 
-    auto leaf_and_pos = directory_stack.top()->search_leaf(directory_stack, min);
+    SearchLeafResult<N> leaf_and_pos = [&] {
+        if (btree.has_dir_cache()) {
+            return btree.search_leaf(Record<N>(min));
+        }
+        directory_stack.push(btree.get_root());
+        return directory_stack.top()->search_leaf(directory_stack, min);
+    }();
     current_leaf = move(leaf_and_pos.leaf);
     assert(current_leaf != nullptr);
     current_pos_in_leaf = leaf_and_pos.result_index;
@@ -42,18 +46,15 @@ LeapfrogBptIter<N>::LeapfrogBptIter(bool*                         interruption_r
     if (current_pos_in_leaf < current_leaf->get_value_count()) {
         current_tuple = current_leaf->get_record(current_pos_in_leaf);
     } else {
-        array<uint64_t, N> max;
         for (size_t i = 0; i < N; i++) {
-            min[i] = UINT64_MAX;
+            current_tuple.ids[i] = UINT64_MAX;
         }
-        current_tuple = make_unique<Record<N>>(max);
     }
 }
 
 
 template <size_t N>
 void LeapfrogBptIter<N>::down() {
-    assert(current_tuple != nullptr);
     level++;
 
     array<uint64_t, N> min;
@@ -61,8 +62,8 @@ void LeapfrogBptIter<N>::down() {
 
     // before the level min and max must be equal to the current_record
     for (int_fast32_t i = 0; i < level; i++) {
-        min[i] = (*current_tuple)[i];
-        max[i] = (*current_tuple)[i];
+        min[i] = current_tuple[i];
+        max[i] = current_tuple[i];
     }
 
     // from level until the end is an open range [0, MAX]
@@ -77,18 +78,17 @@ void LeapfrogBptIter<N>::down() {
 
 template <size_t N>
 bool LeapfrogBptIter<N>::next() {
-    assert(current_tuple != nullptr);
     array<uint64_t, N> min;
     array<uint64_t, N> max;
 
     // before level min and max are equal to the current_record
     for (int_fast32_t i = 0; i < level; i++) {
-        min[i] = (*current_tuple)[i];
-        max[i] = (*current_tuple)[i];
+        min[i] = current_tuple[i];
+        max[i] = current_tuple[i];
     }
 
     // at the same level min is 1 grater than the current record and max is unbound
-    min[level] = (*current_tuple)[level] + 1;
+    min[level] = current_tuple[level] + 1;
     max[level] = UINT64_MAX;
 
     // after level min is 0 and max is unbound
@@ -103,14 +103,13 @@ bool LeapfrogBptIter<N>::next() {
 
 template <size_t N>
 bool LeapfrogBptIter<N>::seek(uint64_t key) {
-    assert(current_tuple != nullptr);
     array<uint64_t, N> min;
     array<uint64_t, N> max;
 
     // before level min and max are equal to the current_record
     for (int_fast32_t i = 0; i < level; i++) {
-        min[i] = (*current_tuple)[i];
-        max[i] = (*current_tuple)[i];
+        min[i] = current_tuple[i];
+        max[i] = current_tuple[i];
     }
 
     min[level] = key;
@@ -130,15 +129,46 @@ template <std::size_t N>
 bool LeapfrogBptIter<N>::internal_search(const Record<N>& min, const Record<N>& max) {
     assert(current_leaf != nullptr);
 
+    // Leapfrog joins usually search records close after the current one. Those are searched galloping
+    // from the current position and then in the next leaf, before going down through the directory
+    if (current_tuple < min) {
+        const auto value_count = current_leaf->get_value_count();
+        auto new_current_pos_in_leaf = current_leaf->search_index_from(min, current_pos_in_leaf + 1);
+        if (new_current_pos_in_leaf < value_count) {
+            search_counters.in_leaf++;
+            auto new_current_tuple = current_leaf->get_record(new_current_pos_in_leaf);
+            if (new_current_tuple <= max) {
+                current_tuple       = new_current_tuple;
+                current_pos_in_leaf = new_current_pos_in_leaf;
+                return true;
+            } else {
+                return false;
+            }
+        }
+        if (!current_leaf->has_next()) {
+            search_counters.in_leaf++;
+            return false;
+        }
+        auto next_leaf = current_leaf->get_next_leaf(true);
+        const auto next_value_count = next_leaf->get_value_count();
+        if (next_value_count > 0 && min <= next_leaf->get_record(next_value_count - 1)) {
+            search_counters.next_leaf++;
+            next_leaf->read_ahead(prefetched_until);
+            const auto pos = next_leaf->search_index(min);
+            return set_current(move(next_leaf), pos, max);
+        }
+        // the record is further, go down through the directory
+    }
     // if leaf.min <= min <= leaf.max, search inside the leaf and return
-    if (current_leaf->check_range(min)) {
+    else if (current_leaf->check_range(min)) {
+        search_counters.in_leaf++;
         auto new_current_pos_in_leaf = current_leaf->search_index(min);
         // check new_current_pos_in_leaf is a valid position
         if (new_current_pos_in_leaf < current_leaf->get_value_count()) {
             auto new_current_tuple = current_leaf->get_record(new_current_pos_in_leaf);
-            if ((*new_current_tuple) <= max) {
+            if (new_current_tuple <= max) {
                 // current_leaf stays the same
-                current_tuple       = move(new_current_tuple);
+                current_tuple       = new_current_tuple;
                 current_pos_in_leaf = new_current_pos_in_leaf;
                 return true;
             } else {
@@ -147,7 +177,14 @@ bool LeapfrogBptIter<N>::internal_search(const Record<N>& min, const Record<N>&
         } else {
             return false;
         }
-    } else {
+    }
+
+    search_counters.directory++;
+    SearchLeafResult<N> leaf_and_pos = [&] {
+        // the cached directory is searched from the root, it doesn't use the buffer
+        if (btree.has_dir_cache()) {
+            return btree.search_leaf(min);
+        }
         // else search in the stack for a dir where dir.min <= min <= dir.max
         // a dir may not have records (i.e when having one leaf as child), in that case it will return the a record with zeros
         // and conditions will be false, so its ok
@@ -159,43 +196,53 @@ bool LeapfrogBptIter<N>::internal_search(const Record<N>& min, const Record<N>&
         }
 
         // then search until reaching the leaf_number and index of the record.
-        auto leaf_and_pos = directory_stack.top()->search_leaf(directory_stack, min);
-        auto new_current_leaf = move(leaf_and_pos.leaf);
-        auto new_current_pos_in_leaf = leaf_and_pos.result_index;
-
-        // check new_current_pos_in_leaf is a valid position
-        // we may need to go to the first record of the next leaf
-        if (new_current_pos_in_leaf >= new_current_leaf->get_value_count()) {
-            if (new_current_leaf->has_next()) {
-                new_current_leaf = new_current_leaf->get_next_leaf();
-                new_current_pos_in_leaf = 0;
-            } else {
-                return false;
+        return directory_stack.top()->search_leaf(directory_stack, min);
+    }();
+    auto new_current_leaf = move(leaf_and_pos.leaf);
+    auto new_current_pos_in_leaf = leaf_and_pos.result_index;
+
+    // check new_current_pos_in_leaf is a valid position
+    // we may need to go to the first record of the next leaf
+    if (new_current_pos_in_leaf >= new_current_leaf->get_value_count()) {
+        if (new_current_leaf->has_next()) {
+            // moving from the current leaf to the next one is a sequential scan
+            const bool sequential = new_current_leaf->get_page().get_page_number()
+                                    == current_leaf->get_page().get_page_number();
+            new_current_leaf = new_current_leaf->get_next_leaf(sequential);
+            new_current_pos_in_leaf = 0;
+            if (sequential) {
+                new_current_leaf->read_ahead(prefetched_until);
             }
-        }
-
-        auto new_current_tuple = new_current_leaf->get_record(new_current_pos_in_leaf);
-        if ((*new_current_tuple) <= max) {
-            current_tuple       = move(new_current_tuple);
-            current_leaf        = move(new_current_leaf);
-            current_pos_in_leaf = new_current_pos_in_leaf;
-            return true;
         } else {
             return false;
         }
     }
+    return set_current(move(new_current_leaf), new_current_pos_in_leaf, max);
+}
+
+
+template <std::size_t N>
+bool LeapfrogBptIter<N>::set_current(unique_ptr<BPlusTreeLeaf<N>> leaf, uint_fast32_t pos, const Record<N>& max) {
+    auto new_current_tuple = leaf->get_record(pos);
+    if (new_current_tuple <= max) {
+        current_tuple       = new_current_tuple;
+        current_leaf        = move(leaf);
+        current_pos_in_leaf = pos;
+        return true;
+    } else {
+        return false;
+    }
 }
 
 
 template <size_t N>
 void LeapfrogBptIter<N>::enum_no_intersection(TupleBuffer& buffer) {
     assert(current_leaf != nullptr);
-    assert(current_tuple != nullptr);
     buffer.reset();
     array<uint64_t, N> max;
 
     for (int_fast32_t i = 0; i <= level; i++) {
-        max[i] = (*current_tuple)[i];
+        max[i] = current_tuple[i];
     }
     for (size_t i = level+1; i < N; i++) {
         max[i] = UINT64_MAX;
@@ -205,21 +252,25 @@ void LeapfrogBptIter<N>::enum_no_intersection(TupleBuffer& buffer) {
                SearchLeafResult<N>(current_leaf->duplicate(), current_pos_in_leaf),
                Record<N>(max));
 
-    auto record = it.next();
-    while (record != nullptr) {
-        vector<ObjectId> tuple;
-        for (size_t i = 0; i < enumeration_vars.size(); i++) {
-            tuple.push_back( ObjectId(record->ids[initial_ranges.size() + intersection_vars.size() + i]) );
+    const auto first_enum_pos = initial_ranges.size() + intersection_vars.size();
+    vector<ObjectId> tuple(enumeration_vars.size());
+    array<Record<N>, BptIter<N>::BATCH_SIZE> records;
+    for (auto count = it.next_batch(records.data(), records.size());
+         count > 0;
+         count = it.next_batch(records.data(), records.size()))
+    {
+        for (uint_fast32_t r = 0; r < count; r++) {
+            for (size_t i = 0; i < enumeration_vars.size(); i++) {
+                tuple[i] = ObjectId(records[r].ids[first_enum_pos + i]);
+            }
+            buffer.append_tuple(tuple);
         }
-        buffer.append_tuple(tuple);
-        record = it.next();
     }
 }
 
 
 template <size_t N>
 bool LeapfrogBptIter<N>::open_terms(BindingId& input_binding) {
-    assert(current_tuple != nullptr);
     array<uint64_t, N> min;
     array<uint64_t, N> max;
 
@@ -12,12 +12,28 @@
 #include "storage/index/bplus_tree/bplus_tree_leaf.h"
 #include "storage/index/tuple_buffer/tuple_buffer.h"
 
+// how the searches of a LeapfrogIter found their position, shown by LeapfrogJoin::analyze
+struct LeapfrogSearchCounters {
+    uint64_t in_leaf   = 0; // in the current leaf
+    uint64_t next_leaf = 0; // in the leaf after the current one
+    uint64_t directory = 0; // going down through the directory
+
+    inline void operator+=(const LeapfrogSearchCounters& other) {
+        in_leaf   += other.in_leaf;
+        next_leaf += other.next_leaf;
+        directory += other.directory;
+    }
+};
+
+
 class LeapfrogIter {
 public:
     virtual ~LeapfrogIter() = default;
 
     bool* const interruption_requested;
 
+    LeapfrogSearchCounters search_counters;
+
     virtual void up() { level--; }
     virtual void down() = 0;
     virtual bool open_terms(BindingId& input_binding) = 0;
@@ -60,7 +76,7 @@ public:
 
     ~LeapfrogBptIter() = default;
 
-    inline uint64_t get_key() const override { return (*current_tuple)[level]; }
+    inline uint64_t get_key() const override { return current_tuple[level]; }
 
     // Increases the level and sets the current_tuple
     void down() override;
@@ -80,16 +96,25 @@ public:
     bool open_terms(BindingId& input_binding) override;
 
 private:
-    std::unique_ptr<Record<N>> current_tuple;
+    const BPlusTree<N>& btree;
+
+    Record<N> current_tuple;
 
     std::unique_ptr<BPlusTreeLeaf<N>> current_leaf;
 
     uint32_t current_pos_in_leaf;
 
+    // branch of the directory of the current leaf, not used when the B+tree has the directory cache loaded
     std::stack<std::unique_ptr<BPlusTreeDir<N>>> directory_stack;
 
+    // last leaf page asked to the buffer manager for read-ahead
+    uint_fast32_t prefetched_until = 0;
+
     // search a record in the interval [min, max]
     bool internal_search(const Record<N>& min, const Record<N>& max);
+
+    // sets the current record if the record at `pos` of `leaf` is less or equal than max
+    bool set_current(std::unique_ptr<BPlusTreeLeaf<N>> leaf, uint_fast32_t pos, const Record<N>& max);
 };
 
 
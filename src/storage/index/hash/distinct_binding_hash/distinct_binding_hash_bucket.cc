@@ -1,5 +1,6 @@
 #include "distinct_binding_hash_bucket.h"
 
+#include <algorithm>
 #include <cstring>
 
 #include "storage/buffer_manager.h"
@@ -16,8 +17,11 @@ DistinctBindingHashBucket<T>::DistinctBindingHashBucket(const TmpFileId file_id,
                                                         const uint_fast32_t bucket_number,
                                                         std::size_t _tuple_size) :
     page        (buffer_manager.get_tmp_page(file_id, bucket_number)),
-    MAX_TUPLES  ( (Page::MDB_PAGE_SIZE - sizeof(*tuple_size) - sizeof(*tuple_count) - sizeof(local_depth))
-                  / (2*sizeof(*hashes) + _tuple_size*sizeof(T) ) ),
+    // tuple_count limits the tuples of a bucket when pages are big
+    MAX_TUPLES  ( std::min<std::size_t>(
+                      (Page::MDB_PAGE_SIZE - sizeof(*tuple_size) - sizeof(*tuple_count) - sizeof(local_depth))
+                      / (2*sizeof(*hashes) + _tuple_size*sizeof(T) ),
+                      UINT8_MAX) ),
     tuples      (reinterpret_cast<T*>(page.get_bytes())),
     hashes      (reinterpret_cast<uint64_t*>(page.get_bytes() + _tuple_size*MAX_TUPLES*sizeof(T))),
     tuple_size  (reinterpret_cast<uint16_t*>(reinterpret_cast<uint8_t*>(hashes) + 2*MAX_TUPLES*sizeof(*hashes))),
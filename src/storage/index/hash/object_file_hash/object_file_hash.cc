@@ -54,6 +54,9 @@ ObjectFileHash::ObjectFileHash(ObjectFile& object_file, const std::string& filen
 
 
 ObjectFileHash::~ObjectFileHash() {
+    if (file_manager.is_read_only()) {
+        return;
+    }
     auto& dir_file = file_manager.get_file(dir_file_id);
     dir_file.seekg(0, dir_file.beg);
 
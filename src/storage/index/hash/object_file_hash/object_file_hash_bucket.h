@@ -1,6 +1,7 @@
 #ifndef STORAGE__OBJECT_FILE_HASH_BUCKET_H_
 #define STORAGE__OBJECT_FILE_HASH_BUCKET_H_
 
+#include <algorithm>
 #include <cstdint>
 #include <map>
 #include <string>
@@ -15,8 +16,12 @@ friend class ObjectFileHash;
 // 2 bytes needed for key_count and local_depth, 2*8 bytes for the hash
 // and 6 bytes for the id (it assumes the other 2 bytes of the id are 0x00)
 // TODO: maybe 5 bytes is enough => ~1TB for object_file
+// With pages bigger than 4KB the keys are limited by key_count, the rest of the page is not used
 static constexpr auto BYTES_FOR_ID = 6U;
-static constexpr auto MAX_KEYS = (Page::MDB_PAGE_SIZE - 2*sizeof(uint8_t)) / (2*sizeof(uint64_t) + BYTES_FOR_ID);
+static constexpr auto MAX_KEYS = std::min<std::size_t>(
+    (Page::MDB_PAGE_SIZE - 2*sizeof(uint8_t)) / (2*sizeof(uint64_t) + BYTES_FOR_ID),
+    UINT8_MAX
+);
 static_assert(MAX_KEYS <= UINT8_MAX, "ObjectFileHashBucket KEY_COUNT(UINT8) CAN'T REACH MAX_KEYS");
 
 public:
@@ -0,0 +1,167 @@
+#include "lz4_block.h"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+constexpr std::size_t MIN_MATCH     = 4;
+constexpr std::size_t LAST_LITERALS = 5;
+constexpr std::size_t MF_LIMIT      = 12;
+constexpr std::size_t MAX_OFFSET    = 65535;
+constexpr int         HASH_BITS     = 12;
+
+inline uint32_t read32(const uint8_t* bytes) {
+    uint32_t res;
+    std::memcpy(&res, bytes, sizeof(res));
+    return res;
+}
+
+inline uint32_t hash(uint32_t sequence) {
+    return (sequence * 2654435761U) >> (32 - HASH_BITS);
+}
+
+// writes the bytes of a length that didn't fit in the token, `len` is the length minus 15
+inline uint8_t* write_length(uint8_t* out, std::size_t len) {
+    while (len >= 255) {
+        *out++ = 255;
+        len -= 255;
+    }
+    *out++ = static_cast<uint8_t>(len);
+    return out;
+}
+
+inline uint8_t* write_literals(uint8_t* out, uint8_t* token, const uint8_t* literals, std::size_t count) {
+    if (count >= 15) {
+        *token = 15 << 4;
+        out = write_length(out, count - 15);
+    } else {
+        *token = static_cast<uint8_t>(count << 4);
+    }
+    std::memcpy(out, literals, count);
+    return out + count;
+}
+
+// adds the extra bytes of a length read from a token. Returns false if the input ends before
+inline bool read_length(const uint8_t*& in, const uint8_t* in_end, std::size_t& len) {
+    uint8_t byte;
+    do {
+        if (in >= in_end) {
+            return false;
+        }
+        byte = *in++;
+        len += byte;
+    } while (byte == 255);
+    return true;
+}
+
+} // namespace
+
+
+std::size_t lz4_block::compress(const char* src_chars, std::size_t size, char* dst_chars) {
+    const auto src = reinterpret_cast<const uint8_t*>(src_chars);
+    const auto dst = reinterpret_cast<uint8_t*>(dst_chars);
+    uint8_t* out = dst;
+    std::size_t anchor = 0; // first byte not written yet
+
+    if (size > MF_LIMIT) {
+        std::array<uint32_t, 1 << HASH_BITS> last_position;
+        last_position.fill(0);
+
+        for (std::size_t pos = 0; pos + MF_LIMIT <= size; ) {
+            const auto sequence  = read32(src + pos);
+            const auto h         = hash(sequence);
+            const auto candidate = last_position[h];
+            last_position[h] = pos;
+
+            if (candidate >= pos || pos - candidate > MAX_OFFSET || read32(src + candidate) != sequence) {
+                pos++;
+                continue;
+            }
+            // the match can't include the last literals
+            const std::size_t max_len = size - LAST_LITERALS - pos;
+            std::size_t len = MIN_MATCH;
+            while (len < max_len && src[candidate + len] == src[pos + len]) {
+                len++;
+            }
+
+            uint8_t* token = out++;
+            out = write_literals(out, token, src + anchor, pos - anchor);
+
+            const auto offset = pos - candidate;
+            *out++ = offset & 0xFF;
+            *out++ = offset >> 8;
+
+            const auto match_len = len - MIN_MATCH;
+            if (match_len >= 15) {
+                *token |= 15;
+                out = write_length(out, match_len - 15);
+            } else {
+                *token |= match_len;
+            }
+            pos += len;
+            anchor = pos;
+        }
+    }
+    uint8_t* token = out++;
+    out = write_literals(out, token, src + anchor, size - anchor);
+    return out - dst;
+}
+
+
+bool lz4_block::decompress(const char* src_chars, std::size_t compressed_size, char* dst_chars, std::size_t size) {
+    const uint8_t* in     = reinterpret_cast<const uint8_t*>(src_chars);
+    const uint8_t* in_end = in + compressed_size;
+    uint8_t* const dst     = reinterpret_cast<uint8_t*>(dst_chars);
+    uint8_t*       out     = dst;
+    uint8_t* const out_end = dst + size;
+
+    while (in < in_end) {
+        const auto token = *in++;
+
+        std::size_t literals = token >> 4;
+        if (literals == 15 && !read_length(in, in_end, literals)) {
+            return false;
+        }
+        if (literals > static_cast<std::size_t>(in_end - in) || literals > static_cast<std::size_t>(out_end - out)) {
+            return false;
+        }
+        std::memcpy(out, in, literals);
+        in  += literals;
+        out += literals;
+
+        // the last sequence doesn't have a match
+        if (in == in_end) {
+            return out == out_end;
+        }
+        if (in_end - in < 2) {
+            return false;
+        }
+        const std::size_t offset = in[0] | (in[1] << 8);
+        in += 2;
+        if (offset == 0 || offset > static_cast<std::size_t>(out - dst)) {
+            return false;
+        }
+
+        std::size_t len = token & 15;
+        if (len == 15 && !read_length(in, in_end, len)) {
+            return false;
+        }
+        len += MIN_MATCH;
+        if (len > static_cast<std::size_t>(out_end - out)) {
+            return false;
+        }
+        const uint8_t* match = out - offset;
+        if (offset >= len) {
+            std::memcpy(out, match, len);
+        } else {
+            // the match overlaps the bytes it writes (e.g. a repeated character)
+            for (std::size_t i = 0; i < len; i++) {
+                out[i] = match[i];
+            }
+        }
+        out += len;
+    }
+    return false;
+}
@@ -0,0 +1,36 @@
+/*
+ * Compression and decompression of single blocks in the LZ4 block format, used by the compressed ObjectFile.
+ *
+ * A block is a list of sequences. Each sequence has a token byte (4 bits for the number of literals and 4 bits
+ * for the length of the match minus 4), extra bytes for lengths that don't fit in the token, the literals, and
+ * the offset of the match (2 bytes, little endian) with its extra length bytes. The last sequence only has
+ * literals. The last 5 bytes of a block are always literals and the last match starts at least 12 bytes before
+ * the end.
+ *
+ * The compressor is greedy: it looks for matches of 4 bytes with a hash table of the last position where each
+ * hash was seen, so it's fast and compresses text reasonably well.
+ */
+
+#ifndef STORAGE__LZ4_BLOCK_H_
+#define STORAGE__LZ4_BLOCK_H_
+
+#include <cstddef>
+
+namespace lz4_block {
+
+// bytes needed by `compress` in the worst case
+constexpr std::size_t max_compressed_size(std::size_t size) {
+    return size + size / 255 + 16;
+}
+
+// compresses `size` bytes of `src` into `dst`, that must have `max_compressed_size(size)` bytes.
+// Returns the compressed size
+std::size_t compress(const char* src, std::size_t size, char* dst);
+
+// decompresses the `compressed_size` bytes of `src` into the `size` bytes of `dst`.
+// Returns false if the compressed data is not valid or doesn't decompress into exactly `size` bytes
+bool decompress(const char* src, std::size_t compressed_size, char* dst, std::size_t size);
+
+} // namespace lz4_block
+
+#endif // STORAGE__LZ4_BLOCK_H_
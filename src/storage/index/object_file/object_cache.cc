@@ -0,0 +1,192 @@
+#include "object_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// copies given by ObjectCache::insert without caching them, they are only seen by the Readers of the thread that
+// asked for them. There is one ObjectCache, the one of the model
+struct ThreadCopies {
+    uint_fast32_t readers = 0; // Readers of the thread alive
+    std::vector<std::unique_ptr<char[]>> copies;
+    uint64_t bytes = 0;
+};
+
+thread_local ThreadCopies thread_copies;
+
+} // namespace
+
+
+void ObjectCacheStats::print(std::ostream& os, int indent) const {
+    const auto requests = hits + misses;
+    os << string(indent, ' ') << "hits: " << hits << ", misses: " << misses << ", hit rate: "
+       << (requests == 0 ? 0.0 : 100.0 * hits / requests) << "%\n";
+    os << string(indent, ' ') << "objects: " << objects << ", bytes: " << bytes << " / " << max_bytes
+       << ", evictions: " << evictions << ", retired bytes: " << retired_bytes << "\n";
+}
+
+
+ObjectCache::Reader::Reader(ObjectCache* cache) :
+    cache (cache),
+    epoch (cache == nullptr ? 0 : cache->begin_read())
+{
+    if (cache != nullptr) {
+        thread_copies.readers++;
+    }
+}
+
+
+ObjectCache::Reader::~Reader() {
+    if (cache != nullptr) {
+        cache->end_read(epoch);
+        if (--thread_copies.readers == 0) {
+            cache->free_thread_copies();
+        }
+    }
+}
+
+
+ObjectCache::ObjectCache(uint64_t max_bytes) :
+    max_bytes       (max_bytes),
+    max_shard_bytes (std::max<uint64_t>(max_bytes / SHARDS, 1)),
+    shards          (make_unique<Shard[]>(SHARDS)),
+    hits            (0),
+    misses          (0),
+    evictions       (0),
+    cached_bytes    (0),
+    current_epoch   (0),
+    retired_bytes   (0) { }
+
+
+const char* ObjectCache::get(uint64_t id) {
+    auto& shard = get_shard(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.entries.find(id);
+    if (it == shard.entries.end()) {
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    hits.fetch_add(1, std::memory_order_relaxed);
+    return it->second->bytes.get();
+}
+
+
+const char* ObjectCache::insert(uint64_t id, const char* str) {
+    const uint64_t size = strlen(str) + 1;
+    auto bytes = make_unique<char[]>(size);
+    std::memcpy(bytes.get(), str, size);
+
+    auto& shard = get_shard(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    // other thread may have inserted it after our miss
+    auto it = shard.entries.find(id);
+    if (it != shard.entries.end()) {
+        return it->second->bytes.get();
+    }
+
+    if (cached_bytes.load(std::memory_order_relaxed) + retired_bytes.load(std::memory_order_relaxed) > max_bytes) {
+        const char* res = bytes.get();
+        if (thread_copies.readers > 0) {
+            retired_bytes.fetch_add(size, std::memory_order_relaxed);
+            thread_copies.bytes += size;
+            thread_copies.copies.push_back(move(bytes));
+        } else {
+            std::lock_guard<std::mutex> epoch_lock(epoch_mutex);
+            retire(size, move(bytes));
+        }
+        return res;
+    }
+
+    shard.lru.push_front(Entry { id, size, move(bytes) });
+    shard.entries.insert({ id, shard.lru.begin() });
+    shard.bytes += size;
+    cached_bytes.fetch_add(size, std::memory_order_relaxed);
+
+    // the object just inserted is kept even if it is bigger than the shard
+    if (shard.bytes > max_shard_bytes && shard.lru.size() > 1) {
+        std::lock_guard<std::mutex> epoch_lock(epoch_mutex);
+        while (shard.bytes > max_shard_bytes && shard.lru.size() > 1) {
+            auto& evicted = shard.lru.back();
+            shard.bytes -= evicted.size;
+            cached_bytes.fetch_sub(evicted.size, std::memory_order_relaxed);
+            shard.entries.erase(evicted.id);
+            retire(evicted.size, move(evicted.bytes));
+            shard.lru.pop_back();
+            evictions.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    return shard.lru.front().bytes.get();
+}
+
+
+void ObjectCache::retire(uint64_t size, std::unique_ptr<char[]> bytes) {
+    retired_bytes.fetch_add(size, std::memory_order_relaxed);
+    retired.push_back(Retired { current_epoch, size, move(bytes) });
+    // readers starting from now can't see the retired objects
+    ++current_epoch;
+}
+
+
+uint64_t ObjectCache::begin_read() {
+    std::lock_guard<std::mutex> lock(epoch_mutex);
+    active_epochs[current_epoch]++;
+    return current_epoch;
+}
+
+
+void ObjectCache::end_read(uint64_t epoch) {
+    std::lock_guard<std::mutex> lock(epoch_mutex);
+    auto it = active_epochs.find(epoch);
+    if (--it->second == 0) {
+        // only the end of the oldest readers can free retired objects
+        const bool oldest = it == active_epochs.begin();
+        active_epochs.erase(it);
+        if (oldest) {
+            reclaim();
+        }
+    }
+}
+
+
+void ObjectCache::free_thread_copies() {
+    retired_bytes.fetch_sub(thread_copies.bytes, std::memory_order_relaxed);
+    thread_copies.copies.clear();
+    thread_copies.bytes = 0;
+}
+
+
+void ObjectCache::reclaim() {
+    // an object retired in epoch e may be used by readers that started in an epoch <= e
+    const auto min_active = active_epochs.empty() ? current_epoch : active_epochs.begin()->first;
+
+    while (!retired.empty() && retired.front().epoch < min_active) {
+        retired_bytes.fetch_sub(retired.front().size, std::memory_order_relaxed);
+        retired.pop_front();
+    }
+}
+
+
+ObjectCacheStats ObjectCache::get_stats() const {
+    ObjectCacheStats stats;
+    stats.hits      = hits.load(std::memory_order_relaxed);
+    stats.misses    = misses.load(std::memory_order_relaxed);
+    stats.evictions = evictions.load(std::memory_order_relaxed);
+    stats.objects   = 0;
+    stats.bytes     = 0;
+    stats.max_bytes = max_bytes;
+    for (uint_fast32_t i = 0; i < SHARDS; i++) {
+        std::lock_guard<std::mutex> lock(shards[i].mutex);
+        stats.objects += shards[i].lru.size();
+        stats.bytes   += shards[i].bytes;
+    }
+    stats.retired_bytes = retired_bytes.load(std::memory_order_relaxed);
+    return stats;
+}
@@ -0,0 +1,141 @@
+/*
+ * ObjectCache keeps copies of objects of the ObjectFile (external strings and identifiers) in memory, so
+ * the objects that appear in many results are materialized once. It is shared by all the queries and bounded by
+ * the bytes of the copies.
+ *
+ * The cache is divided in SHARDS by the object id, each one with its own mutex, map and LRU list, so threads
+ * materializing different objects don't wait for each other. A shard evicts its least recently used objects
+ * when its bytes exceed `max_bytes / SHARDS`.
+ *
+ * GraphObjects keep pointers to the strings and queries keep GraphObjects until they end (e.g. OrderBy), so an
+ * evicted object can't be freed right away. Queries use the cache inside an ObjectCache::Reader, that takes the
+ * current epoch when it is created. Evicted objects are retired with the current epoch, which is then
+ * incremented, and they are freed when every Reader alive started after they were retired. They are freed in
+ * batches, when the oldest Reader alive ends.
+ *
+ * Retired objects count in `max_bytes` too: while the objects cached and retired use more than `max_bytes`
+ * (e.g. a long query keeps old objects retired) new objects are not cached, so the cache doesn't evict more
+ * objects that can't be freed. The copy given to the caller is only seen by the Readers of its thread, it is
+ * counted as retired and freed when they end.
+ *
+ * Hits, misses and evictions are counted since the cache was created (see ObjectCacheStats).
+ */
+
+#ifndef STORAGE__OBJECT_CACHE_H_
+#define STORAGE__OBJECT_CACHE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+
+struct ObjectCacheStats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t objects;
+    uint64_t bytes;
+    uint64_t max_bytes;
+    uint64_t retired_bytes; // evicted objects that readers may still be using
+
+    void print(std::ostream& os, int indent = 0) const;
+};
+
+class ObjectCache {
+public:
+    static constexpr uint_fast32_t SHARDS = 64;
+
+    // size of the cache of a compressed object file when no size is given
+    static constexpr uint64_t DEFAULT_MAX_BYTES = 64 * 1024 * 1024;
+
+    // Pointers returned by `get` and `insert` are valid while the Reader that was alive when they were returned
+    // is alive. A Reader with a null cache does nothing
+    class Reader {
+    public:
+        Reader(ObjectCache* cache);
+        ~Reader();
+
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+    private:
+        ObjectCache* const cache;
+        const uint64_t epoch;
+    };
+
+    ObjectCache(uint64_t max_bytes);
+    ~ObjectCache() = default;
+
+    // returns the copy of the object `id`, or nullptr if it isn't in the cache
+    const char* get(uint64_t id);
+
+    // copies the null-terminated `str` as the object `id` and returns the copy
+    const char* insert(uint64_t id, const char* str);
+
+    ObjectCacheStats get_stats() const;
+
+private:
+    struct Entry {
+        uint64_t id;
+        uint64_t size;
+        std::unique_ptr<char[]> bytes;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::list<Entry> lru; // most recently used first
+        std::unordered_map<uint64_t, std::list<Entry>::iterator> entries;
+        uint64_t bytes = 0;
+    };
+
+    struct Retired {
+        uint64_t epoch;
+        uint64_t size;
+        std::unique_ptr<char[]> bytes;
+    };
+
+    const uint64_t max_bytes;
+    const uint64_t max_shard_bytes;
+
+    std::unique_ptr<Shard[]> shards;
+
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+    std::atomic<uint64_t> evictions;
+
+    // bytes of the objects in the shards
+    std::atomic<uint64_t> cached_bytes;
+
+    // protects the epochs and the retired objects. When both are needed, the mutex of the shard is taken first
+    mutable std::mutex epoch_mutex;
+    uint64_t current_epoch;
+    std::map<uint64_t, uint_fast32_t> active_epochs; // epoch -> readers alive that started in it
+    std::deque<Retired> retired; // sorted by epoch
+    std::atomic<uint64_t> retired_bytes; // also counts the copies that were not cached
+
+    inline Shard& get_shard(uint64_t id) noexcept {
+        // ids are positions in the file, multiplying spreads consecutive objects between the shards
+        return shards[(id * 0x9E3779B97F4A7C15UL) >> 58];
+    }
+
+    uint64_t begin_read();
+    void end_read(uint64_t epoch);
+
+    // frees the copies that were not cached for the Readers of the calling thread, that ended
+    void free_thread_copies();
+
+    // retires `bytes` with the current epoch, that is then incremented. epoch_mutex must be locked
+    void retire(uint64_t size, std::unique_ptr<char[]> bytes);
+
+    // frees the retired objects no reader can be using. epoch_mutex must be locked
+    void reclaim();
+};
+
+static_assert(ObjectCache::SHARDS == 64, "get_shard uses the 6 highest bits of the hash");
+
+#endif // STORAGE__OBJECT_CACHE_H_
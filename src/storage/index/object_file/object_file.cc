@@ -1,43 +1,162 @@
 #include "object_file.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cerrno>
 #include <cstring>
+#include <fstream>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "storage/file_manager.h"
+#include "storage/index/object_file/lz4_block.h"
 
 using namespace std;
 
 
+// magic, block size, size of the uncompressed objects and number of blocks
+static constexpr uint64_t COMPRESSED_HEADER_WORDS = 4;
+
+
 ObjectFile::ObjectFile(const string& filename) :
-    file (file_manager.get_file(file_manager.get_file_id(filename)))
+    compressed (file_manager.exists(filename + COMPRESSED_SUFFIX)),
+    file_id    (file_manager.get_file_id(compressed ? filename + COMPRESSED_SUFFIX : filename)),
+    read_only  (file_manager.is_read_only()),
+    fd         (file_manager.get_file_descriptor(file_id))
 {
-    file.seekg (0, file.end);
-    auto end_pos = file.tellg();
+    if (compressed) {
+        if (read_only) {
+            objects  = file_manager.get_mapped_bytes(file_id);
+            capacity = file_manager.get_mapped_size(file_id);
+        } else {
+            struct stat file_stat;
+            if (fstat(fd, &file_stat) == -1) {
+                throw runtime_error("Could not get the size of the object file: " + string(strerror(errno)));
+            }
+            capacity = file_stat.st_size;
+            void* bytes = mmap(nullptr, capacity, PROT_READ, MAP_SHARED, fd, 0);
+            if (bytes == MAP_FAILED) {
+                throw runtime_error("Could not map the object file: " + string(strerror(errno)));
+            }
+            objects = reinterpret_cast<char*>(bytes);
+        }
+        if (!valid_compressed_header()) {
+            if (!read_only) {
+                munmap(objects, capacity);
+            }
+            throw runtime_error("The compressed object file is not valid.");
+        }
+        return;
+    }
+
+    if (read_only) {
+        objects     = file_manager.get_mapped_bytes(file_id);
+        current_end = file_manager.get_mapped_size(file_id);
+        capacity    = current_end;
+        return;
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == -1) {
+        throw runtime_error("Could not get the size of the object file: " + string(strerror(errno)));
+    }
+    uint64_t end_pos = file_stat.st_size;
 
     // If the file is empty, write a trash byte to prevent the ID = 0
     if (end_pos == 0) {
-        capacity = INITIAL_SIZE;
-        objects = new char[INITIAL_SIZE];
+        objects  = nullptr;
+        capacity = 0;
+        grow(INITIAL_SIZE);
         objects[0] = '\0';
         current_end = 1;
     } else {
-        capacity = end_pos;
-        objects = new char[end_pos];
-        file.seekg(0, file.beg);
-        file.read(objects, end_pos);
+        // the file is extended only when an object is written, so opening it doesn't modify it
+        void* bytes = mmap(nullptr, end_pos, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (bytes == MAP_FAILED) {
+            throw runtime_error("Could not map the object file: " + string(strerror(errno)));
+        }
+        objects     = reinterpret_cast<char*>(bytes);
+        capacity    = end_pos;
         current_end = end_pos;
     }
 }
 
 
+bool ObjectFile::valid_compressed_header() {
+    const auto header = reinterpret_cast<const uint64_t*>(objects);
+    if (capacity < COMPRESSED_HEADER_WORDS * sizeof(uint64_t) || header[0] != COMPRESSED_MAGIC) {
+        return false;
+    }
+    block_size      = header[1];
+    current_end     = header[2];
+    block_positions = header + COMPRESSED_HEADER_WORDS;
+    const auto block_count = header[3];
+    if (block_size == 0
+        || block_count != current_end / block_size + (current_end % block_size == 0 ? 0 : 1)
+        || block_count >= capacity / sizeof(uint64_t)) // the positions would not fit in the file
+    {
+        return false;
+    }
+    const auto positions_end = (COMPRESSED_HEADER_WORDS + block_count + 1) * sizeof(uint64_t);
+    if (capacity < positions_end) {
+        return false;
+    }
+
+    // get_block reads the bytes between 2 positions, so they must be in order and inside the file
+    if (block_positions[0] < positions_end || block_positions[block_count] > capacity) {
+        return false;
+    }
+    for (uint64_t i = 0; i < block_count; i++) {
+        if (block_positions[i] > block_positions[i + 1]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
 ObjectFile::~ObjectFile() {
-    file.seekg(0, file.beg);
-    file.write(objects, current_end);
-    delete[] objects;
+    if (read_only) {
+        return;
+    }
+    if (compressed) {
+        munmap(objects, capacity);
+        return;
+    }
+    munmap(objects, capacity);
+    // if the truncation fails the file keeps zeros at the end, and objects written after opening it again
+    // go after them, so it's still valid
+    [[maybe_unused]] auto res = ftruncate(fd, current_end);
+}
+
+
+void ObjectFile::grow(uint64_t min_capacity) {
+    auto new_capacity = std::max<uint64_t>(capacity, INITIAL_SIZE);
+    while (new_capacity < min_capacity) {
+        new_capacity *= 2;
+    }
+    // the new bytes of the file are zeros, they don't use disk until they are written
+    if (ftruncate(fd, new_capacity) == -1) {
+        throw runtime_error("Could not extend the object file to " + to_string(new_capacity) + " bytes: "
+                            + strerror(errno));
+    }
+    void* bytes = objects == nullptr
+        ? mmap(nullptr, new_capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+        : mremap(objects, capacity, new_capacity, MREMAP_MAYMOVE);
+    if (bytes == MAP_FAILED) {
+        throw runtime_error("Could not map the object file: " + string(strerror(errno)));
+    }
+    objects  = reinterpret_cast<char*>(bytes);
+    capacity = new_capacity;
 }
 
 
 const char* ObjectFile::read(uint64_t id) {
+    if (compressed) {
+        return read_compressed(id);
+    }
     assert(id > 0);
     assert(objects[id-1] == '\0');
     if (id >= current_end) {
@@ -48,22 +167,17 @@ const char* ObjectFile::read(uint64_t id) {
 
 
 uint64_t ObjectFile::write(vector<unsigned char>& bytes) {
-    assert(bytes.size() >= 8); // 7 or less bytes can be inlined
+    if (read_only) {
+        throw std::logic_error("Cannot write into the object file in read-only mode.");
+    }
+    if (compressed) {
+        throw std::logic_error("Cannot write into a compressed object file.");
+    }
 
     uint64_t write_pos = current_end;
     // check the is enough space
-    while (current_end + bytes.size() + 1 >= capacity) {
-        // duplicate buffer
-        char* new_objects = new char[capacity*2];
-        std::memcpy(
-            new_objects,
-            objects,
-            capacity
-        );
-        capacity *= 2;
-
-        delete[] objects;
-        objects = new_objects;
+    if (current_end + bytes.size() + 1 >= capacity) {
+        grow(current_end + bytes.size() + 2);
     }
     // write
     std::memcpy(
@@ -77,3 +191,119 @@ uint64_t ObjectFile::write(vector<unsigned char>& bytes) {
 
     return write_pos;
 }
+
+
+const char* ObjectFile::read_compressed(uint64_t id) {
+    if (id == 0 || id >= current_end) {
+        throw ObjectFileOutOfBounds("OBJECT FILE ERROR: tried to read inexistent object (id: " + std::to_string(id)+ ")");
+    }
+    thread_local std::string object;
+    object.clear();
+
+    auto block_number = id / block_size;
+    auto pos          = id % block_size;
+    while (true) {
+        auto block = get_block(block_number);
+        const char* begin = block->data() + pos;
+        const auto len    = block->size() - pos;
+        auto end = static_cast<const char*>(memchr(begin, '\0', len));
+        if (end != nullptr) {
+            object.append(begin, end);
+            return object.c_str();
+        }
+        // the object continues in the next block
+        object.append(begin, len);
+        block_number++;
+        pos = 0;
+    }
+}
+
+
+ObjectFile::Block ObjectFile::get_block(uint64_t block_number) {
+    {
+        std::lock_guard<std::mutex> lock(block_cache_mutex);
+        auto it = cached_blocks.find(block_number);
+        if (it != cached_blocks.end()) {
+            block_lru.splice(block_lru.begin(), block_lru, it->second);
+            return it->second->second;
+        }
+    }
+
+    const auto block_count = (current_end + block_size - 1) / block_size;
+    if (block_number >= block_count) {
+        throw ObjectFileOutOfBounds("OBJECT FILE ERROR: tried to read inexistent block " + to_string(block_number));
+    }
+    const auto size            = std::min(block_size, current_end - block_number * block_size);
+    const auto position        = block_positions[block_number];
+    const auto compressed_size = block_positions[block_number + 1] - position;
+
+    // decompressed without the lock, other threads may be decompressing other blocks
+    auto bytes = make_shared<vector<char>>(size);
+    if (compressed_size == size) {
+        std::memcpy(bytes->data(), objects + position, size);
+    } else if (!lz4_block::decompress(objects + position, compressed_size, bytes->data(), size)) {
+        throw runtime_error("OBJECT FILE ERROR: block " + to_string(block_number) + " is corrupted");
+    }
+
+    std::lock_guard<std::mutex> lock(block_cache_mutex);
+    auto it = cached_blocks.find(block_number);
+    if (it != cached_blocks.end()) {
+        return it->second->second;
+    }
+    block_lru.emplace_front(block_number, bytes);
+    cached_blocks.insert({ block_number, block_lru.begin() });
+    if (block_lru.size() > std::max<uint64_t>(BLOCK_CACHE_SIZE / block_size, 1)) {
+        cached_blocks.erase(block_lru.back().first);
+        block_lru.pop_back();
+    }
+    return bytes;
+}
+
+
+uint64_t ObjectFile::compress(const string& path, const string& compressed_path) {
+    ifstream in(path, ios::in | ios::binary);
+    if (in.fail()) {
+        throw runtime_error("Could not open the object file " + path);
+    }
+    in.seekg(0, ios::end);
+    const uint64_t size = in.tellg();
+    in.seekg(0, ios::beg);
+
+    const uint64_t block_count = (size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    vector<uint64_t> header { COMPRESSED_MAGIC, BLOCK_SIZE, size, block_count };
+    vector<uint64_t> block_positions(block_count + 1);
+
+    ofstream out(compressed_path, ios::out | ios::binary | ios::trunc);
+    if (out.fail()) {
+        throw runtime_error("Could not create the compressed object file " + compressed_path);
+    }
+    // the blocks are written after the header and their positions
+    uint64_t position = (COMPRESSED_HEADER_WORDS + block_count + 1) * sizeof(uint64_t);
+    out.seekp(position);
+
+    vector<char> block(BLOCK_SIZE);
+    vector<char> compressed_block(lz4_block::max_compressed_size(BLOCK_SIZE));
+    for (uint64_t i = 0; i < block_count; i++) {
+        const auto raw_size = std::min(BLOCK_SIZE, size - i * BLOCK_SIZE);
+        in.read(block.data(), raw_size);
+        const auto compressed_size = lz4_block::compress(block.data(), raw_size, compressed_block.data());
+
+        block_positions[i] = position;
+        if (compressed_size < raw_size) {
+            out.write(compressed_block.data(), compressed_size);
+            position += compressed_size;
+        } else {
+            out.write(block.data(), raw_size);
+            position += raw_size;
+        }
+    }
+    block_positions[block_count] = position;
+
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(header.data()), header.size() * sizeof(uint64_t));
+    out.write(reinterpret_cast<const char*>(block_positions.data()), block_positions.size() * sizeof(uint64_t));
+    if (in.fail() || out.fail()) {
+        throw runtime_error("Could not compress the object file " + path);
+    }
+    return position;
+}
@@ -9,18 +9,35 @@
  *
  * Because the ID=0 is special (represents the null object), we need to write a trash byte when creating the
  * file so the first object will have the ID=1.
+ *
+ * The file is memory-mapped, so objects are read from disk when they are first accessed and opening the file
+ * doesn't depend on its size. When the FileManager is in read-only mode the mapping of the FileManager is used.
+ * Otherwise the file is mapped shared and writable: when it is full the file is extended with ftruncate and
+ * remapped (pointers returned by `read` are invalidated by a `write`), and the destructor truncates the file to
+ * the bytes used, so the file only contains the objects.
+ *
+ * The object file can be compressed once the database is created (see `compress`), then `filename` +
+ * COMPRESSED_SUFFIX is used instead and the database can't add objects. The objects are split into blocks of
+ * BLOCK_SIZE bytes, each one is compressed with lz4_block (or stored as is if it doesn't get smaller), and the
+ * file starts with a header and the position of each block. Ids don't change, they are positions in the
+ * uncompressed objects, so an object may continue in the next block. The blocks used most recently are kept
+ * decompressed in memory (up to BLOCK_CACHE_SIZE bytes). In this mode `read` copies the object into a buffer of
+ * the calling thread, so the result is only valid until the thread reads another object.
  * */
 
 #ifndef STORAGE__OBJECT_FILE_H_
 #define STORAGE__OBJECT_FILE_H_
 
-#include <fstream>
+#include <list>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "base/ids/object_id.h"
+#include "storage/file_id.h"
 
 struct ObjectFileOutOfBounds : public std::runtime_error {
 	ObjectFileOutOfBounds(std::string msg)
@@ -31,17 +48,52 @@ class ObjectFile {
 public:
     static constexpr auto INITIAL_SIZE = 4096*1024;
 
+    static constexpr auto COMPRESSED_SUFFIX = ".lz";
+    static constexpr uint64_t COMPRESSED_MAGIC = 0x4F424A4C5A340001UL;
+    static constexpr uint64_t BLOCK_SIZE       = 16*1024;
+    static constexpr uint64_t BLOCK_CACHE_SIZE = 64*1024*1024;
+
     ObjectFile(const std::string& filename);
     ~ObjectFile();
 
     const char* read(uint64_t id);
     uint64_t write(std::vector<unsigned char>& bytes);
 
+    inline bool is_compressed() const noexcept { return compressed; }
+
+    // writes the compressed version of the object file `path` into `compressed_path`.
+    // Returns the size of the compressed file
+    static uint64_t compress(const std::string& path, const std::string& compressed_path);
+
 private:
+    using Block = std::shared_ptr<const std::vector<char>>;
+
+    const bool compressed;
+    const FileId file_id;
+    const bool read_only;
+    const int fd;
     uint64_t current_end;
-    uint64_t capacity;
-    std::fstream& file;
-    char* objects; // All objects separated by '\0'
+    uint64_t capacity; // size of the file and the mapping while it is writable
+    char* objects; // All objects separated by '\0', or the compressed file
+
+    // only used when the file is compressed
+    uint64_t block_size;
+    const uint64_t* block_positions; // block_count + 1 positions in the compressed file
+    std::mutex block_cache_mutex;
+    std::list<std::pair<uint64_t, Block>> block_lru; // most recently used first
+    std::unordered_map<uint64_t, std::list<std::pair<uint64_t, Block>>::iterator> cached_blocks;
+
+    // reads the header and the block positions of a compressed file, returns false if they are not consistent
+    // with the size of the file
+    bool valid_compressed_header();
+
+    // extends the file and the mapping to at least `min_capacity` bytes
+    void grow(uint64_t min_capacity);
+
+    // decompressed block, from the block cache if it's there
+    Block get_block(uint64_t block_number);
+
+    const char* read_compressed(uint64_t id);
 };
 
 #endif // STORAGE__OBJECT_FILE_H_
@@ -52,23 +52,10 @@ void OrderedFile<N>::begin_read() noexcept {
 
 
 template <std::size_t N>
-void OrderedFile<N>::copy_to_bpt_leaf(BPlusTreeLeaf<N>& leaf, uint_fast32_t page_number) const noexcept {
-    assert(page_number <= last_page);
-
-    OrderedFilePage<N> ordered_file_page(buffer_manager.get_page(*file_id, page_number));
-    // copy the entire page, but `leaf.next_leaf` needs to be setted outside
-    std::memcpy(
-        leaf.get_page().get_bytes(),
-        ordered_file_page.get_page().get_bytes(),
-        Page::MDB_PAGE_SIZE
-    );
-}
-
-
-template <std::size_t N>
-std::unique_ptr<Record<N>> OrderedFile<N>::next_record() noexcept {
-    if (current_page <= last_page) {
-        auto arr = io_buffer->get(current_pos_in_current_page);
+const Record<N>* OrderedFile<N>::next_record() noexcept {
+    // the last page may be empty when the file has no records
+    if (current_page <= last_page && current_pos_in_current_page < io_buffer->get_size()) {
+        current_record.ids = io_buffer->get(current_pos_in_current_page);
         ++current_pos_in_current_page;
         if (current_pos_in_current_page >= io_buffer->get_size()) {
             ++current_page;
@@ -78,7 +65,7 @@ std::unique_ptr<Record<N>> OrderedFile<N>::next_record() noexcept {
                 io_buffer = make_unique<OrderedFilePage<N>>(buffer_manager.get_page(*file_id, current_page));
             }
         }
-        return make_unique<Record<N>>(arr);
+        return &current_record;
     } else {
         return nullptr;
     }
@@ -116,7 +103,10 @@ constexpr uint_fast32_t division_round_up(uint_fast32_t a, uint_fast32_t b) {
 
 
 template <std::size_t N>
-void OrderedFile<N>::order(const std::array<uint_fast8_t, N>& column_order) noexcept {
+void OrderedFile<N>::order(const std::array<uint_fast8_t, N>& column_order,
+                           uint_fast32_t max_threads,
+                           uint_fast32_t max_buffer_pages) noexcept
+{
     bool need_column_reorder = false;
     for (size_t n = 0; n < N; n++) {
         if (column_order[n] != n) {
@@ -124,7 +114,7 @@ void OrderedFile<N>::order(const std::array<uint_fast8_t, N>& column_order) noex
         }
     }
 
-    const uint32_t MAX_THREADS = 8; // TODO: extract to config file
+    const uint_fast32_t MAX_THREADS = max_threads > 0 ? max_threads : 1;
     const auto total_pages = last_page + 1;
 
     // First step: order each page
@@ -172,13 +162,17 @@ void OrderedFile<N>::order(const std::array<uint_fast8_t, N>& column_order) noex
         }
     }
 
-    auto pool_size = buffer_manager.get_shared_buffer_pool_size() / (2*MAX_THREADS);
+    if (max_buffer_pages == 0) {
+        max_buffer_pages = buffer_manager.get_shared_buffer_pool_size() / 2;
+    }
+    // each merge pins one page of each run and the output page
+    auto pool_size = max_buffer_pages / MAX_THREADS;
     unsigned int max_runs;
 
     for (unsigned r = 2; true; r++) {
         double root = ceil( pow(last_page+1, 1.0/r) );
-        if (root < pool_size) {
-            max_runs = root;
+        if (root < pool_size || root <= 2) {
+            max_runs = root < 2 ? 2 : root;
             break;
         }
     }
@@ -292,18 +286,19 @@ template <std::size_t N>
 bool OrderedFile<N>::check_order() {
     begin_read();
 
-    auto a = next_record();
-    if (a == nullptr)  {
+    auto first = next_record();
+    if (first == nullptr)  {
         return true;
     }
+    Record<N> a = *first;
     auto b = next_record();
 
     int errors = 0;
     for (int i = 0; b != nullptr; i++, b=next_record() ) {
-        if (!(*a < *b)) {
+        if (!(a < *b)) {
             cerr << "Bad ordering at tuples " << i << " and " << i+1 << "\n";
             for (size_t n = 0; n < N; n++) {
-                cerr << "\t" << a->ids[n];
+                cerr << "\t" << a.ids[n];
             }
             cerr << "\n";
             for (size_t n = 0; n < N; n++) {
@@ -312,7 +307,7 @@ bool OrderedFile<N>::check_order() {
             cerr << "\n";
             cerr << "\tdiff: ";
             for (size_t n = 0; n < N; n++) {
-                cerr << "\t" << a->ids[n] - b->ids[n];
+                cerr << "\t" << a.ids[n] - b->ids[n];
             }
             cerr << "\n";
 
@@ -322,7 +317,7 @@ bool OrderedFile<N>::check_order() {
                 return false;
             }
         }
-        a = move(b);
+        a = *b;
     }
     return errors == 0;
 }
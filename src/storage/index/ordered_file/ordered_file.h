@@ -26,11 +26,18 @@ public:
     OrderedFile(const std::string& filename);
     ~OrderedFile();
 
+    static constexpr uint_fast32_t DEFAULT_ORDER_THREADS = 8;
+
     void append_record(const std::array<uint64_t, N>& record) noexcept;
-    void order(const std::array<uint_fast8_t, N>& column_order) noexcept;
+
+    // Orders the records using up to `max_threads` threads. The merge keeps at most `max_buffer_pages` pages of
+    // the shared buffer pinned at the same time, 0 means half of the shared buffer. Files ordered concurrently
+    // must divide the buffer between them, otherwise the buffer may run out of pages.
+    void order(const std::array<uint_fast8_t, N>& column_order,
+               uint_fast32_t max_threads = DEFAULT_ORDER_THREADS,
+               uint_fast32_t max_buffer_pages = 0) noexcept;
 
     void begin_read() noexcept;
-    void copy_to_bpt_leaf(BPlusTreeLeaf<N>& leaf, uint_fast32_t page_number) const noexcept;
 
     // next_record() is used to get all the records one by one. begin_read() must be called at first.
     // example:
@@ -38,7 +45,8 @@ public:
     // for (auto record = ordered_file.next_record(); record != nullptr; record = ordered_file.next_record()) {
     //     // do something with record
     // }
-    std::unique_ptr<Record<N>> next_record() noexcept;
+    // The record returned is valid until the next call
+    const Record<N>* next_record() noexcept;
 
     inline uint_fast32_t get_last_page() const noexcept { return last_page; }
 
@@ -60,6 +68,9 @@ private:
 
     // used in append_record and next_record
     std::unique_ptr<OrderedFilePage<N>> io_buffer;
+
+    // last record returned by next_record
+    Record<N> current_record;
 };
 
 #endif // STORAGE__ORDERED_FILE_H_
@@ -16,8 +16,7 @@ template <std::size_t N>
 OrderedFilePage<N>::OrderedFilePage(Page& page) noexcept :
     page    (page),
     size    (reinterpret_cast<uint32_t*>(page.get_bytes())),
-    // OrderedFilePage must be coherent with the alignment of a BPlusTreeLeaf so then we can copy the
-    // entire page at bulk import, so we skiped space for next_leaf when setting records
+    // the same layout of an uncompressed BPlusTreeLeaf, skipping the space of next_leaf
     records (reinterpret_cast<uint64_t*>(page.get_bytes() + (2*sizeof(uint32_t)) ))
 {
     assert(*size <= MAX_RECORDS);
@@ -10,6 +10,9 @@ class Record {
 public:
     std::array<uint64_t, N> ids;
 
+    // ids are not initialized, used for buffers of records that are written later
+    Record() noexcept = default;
+
     Record(const std::array<uint64_t, N> ids) noexcept :
         ids(ids) { }
 
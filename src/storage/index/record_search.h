@@ -0,0 +1,224 @@
+/*
+ * Search functions over arrays of records stored as `N` consecutive uint64_t each (e.g. the keys of a
+ * BPlusTreeDir or the records of an uncompressed BPlusTreeLeaf), ordered lexicographically.
+ *
+ * The search is a branchless binary search until a few records are left, followed by a linear pass.
+ * Records are compared with SIMD instructions when the build has them: a whole record is compared against the
+ * key at once (SSE4.2 for N=2, AVX2 for N=3 and N=4) and records with N=1 are compared 4 at a time (AVX2).
+ * Otherwise scalar comparisons are used.
+ */
+
+#ifndef STORAGE__RECORD_SEARCH_H_
+#define STORAGE__RECORD_SEARCH_H_
+
+#include <array>
+#include <cstdint>
+
+#if defined(__AVX2__) || defined(__SSE4_2__)
+#include <immintrin.h>
+#endif
+
+namespace record_search {
+
+// records left when the binary search ends and the linear pass begins
+constexpr uint_fast32_t LINEAR_SEARCH_RECORDS = 4;
+
+// Compares records against a fixed key. SIMD registers are initialized once for each search.
+template <std::size_t N>
+class KeyComparator {
+public:
+    KeyComparator(const std::array<uint64_t, N>& key) : key(key) { }
+
+    // record < key
+    inline bool record_less(const uint64_t* record) const {
+        for (std::size_t i = 0; i < N; i++) {
+            if (record[i] != key[i]) {
+                return record[i] < key[i];
+            }
+        }
+        return false;
+    }
+
+    // key < record
+    inline bool key_less(const uint64_t* record) const {
+        for (std::size_t i = 0; i < N; i++) {
+            if (record[i] != key[i]) {
+                return key[i] < record[i];
+            }
+        }
+        return false;
+    }
+
+private:
+    const std::array<uint64_t, N> key;
+};
+
+
+#if defined(__AVX2__) || defined(__SSE4_2__)
+// `less_mask` and `greater_mask` have a bit for each column, column 0 in the lowest bit. The first column that
+// is different decides the comparison
+inline bool first_difference_is_less(unsigned less_mask, unsigned greater_mask) {
+    const unsigned diff = less_mask | greater_mask;
+    return (less_mask & diff & (0U - diff)) != 0;
+}
+#endif
+
+
+#if defined(__SSE4_2__)
+template <>
+class KeyComparator<2> {
+public:
+    KeyComparator(const std::array<uint64_t, 2>& key) :
+        sign (_mm_set1_epi64x(INT64_MIN)),
+        key  (_mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(key.data())), sign)) { }
+
+    inline bool record_less(const uint64_t* record) const {
+        const auto r = load(record);
+        return first_difference_is_less(mask(_mm_cmpgt_epi64(key, r)), mask(_mm_cmpgt_epi64(r, key)));
+    }
+
+    inline bool key_less(const uint64_t* record) const {
+        const auto r = load(record);
+        return first_difference_is_less(mask(_mm_cmpgt_epi64(r, key)), mask(_mm_cmpgt_epi64(key, r)));
+    }
+
+private:
+    // comparisons are signed, flipping the sign bit makes them behave as unsigned
+    const __m128i sign;
+    const __m128i key;
+
+    inline __m128i load(const uint64_t* record) const {
+        return _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(record)), sign);
+    }
+
+    static inline unsigned mask(__m128i cmp) {
+        return _mm_movemask_pd(_mm_castsi128_pd(cmp));
+    }
+};
+#endif
+
+
+#if defined(__AVX2__)
+// base of the comparators of records with 3 and 4 columns
+template <std::size_t N>
+class AvxKeyComparator {
+public:
+    AvxKeyComparator(const std::array<uint64_t, N>& key) :
+        sign      (_mm256_set1_epi64x(INT64_MIN)),
+        load_mask (_mm256_setr_epi64x(-1, -1, -1, N == 4 ? -1 : 0)),
+        key       (load(key.data())) { }
+
+    inline bool record_less(const uint64_t* record) const {
+        const auto r = load(record);
+        return first_difference_is_less(mask(_mm256_cmpgt_epi64(key, r)), mask(_mm256_cmpgt_epi64(r, key)));
+    }
+
+    inline bool key_less(const uint64_t* record) const {
+        const auto r = load(record);
+        return first_difference_is_less(mask(_mm256_cmpgt_epi64(r, key)), mask(_mm256_cmpgt_epi64(key, r)));
+    }
+
+private:
+    // comparisons are signed, flipping the sign bit makes them behave as unsigned
+    const __m256i sign;
+
+    // records with 3 columns load only 3 lanes, the last one is 0 in both the key and the record
+    const __m256i load_mask;
+
+    const __m256i key;
+
+    inline __m256i load(const uint64_t* record) const {
+        const auto r = N == 4 ? _mm256_loadu_si256(reinterpret_cast<const __m256i*>(record))
+                              : _mm256_maskload_epi64(reinterpret_cast<const long long*>(record), load_mask);
+        return _mm256_xor_si256(r, sign);
+    }
+
+    static inline unsigned mask(__m256i cmp) {
+        return _mm256_movemask_pd(_mm256_castsi256_pd(cmp));
+    }
+};
+
+template <>
+class KeyComparator<3> : public AvxKeyComparator<3> {
+    using AvxKeyComparator<3>::AvxKeyComparator;
+};
+
+template <>
+class KeyComparator<4> : public AvxKeyComparator<4> {
+    using AvxKeyComparator<4>::AvxKeyComparator;
+};
+#endif
+
+
+// number of records in `records[0, count)` that go before the key: records less than the key when `UPPER` is
+// false, records less or equal than the key when `UPPER` is true
+template <std::size_t N, bool UPPER>
+inline uint_fast32_t linear_count(const uint64_t* records,
+                                  uint_fast32_t count,
+                                  const std::array<uint64_t, N>& key,
+                                  const KeyComparator<N>& comparator)
+{
+    uint_fast32_t res = 0;
+#if defined(__AVX2__)
+    if constexpr (N == 1) {
+        const auto sign      = _mm256_set1_epi64x(INT64_MIN);
+        const auto key_lanes = _mm256_xor_si256(_mm256_set1_epi64x(key[0]), sign);
+        for (; res + 4 <= count; res += 4) {
+            const auto r = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(records + res)),
+                                            sign);
+            // lanes where the record doesn't go before the key
+            const unsigned after_mask = UPPER
+                ? _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(r, key_lanes)))
+                : ~_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(key_lanes, r))) & 0xF;
+            if (after_mask != 0) {
+                return res + __builtin_ctz(after_mask);
+            }
+        }
+    }
+#else
+    (void) key;
+#endif
+    for (; res < count; res++) {
+        const bool before = UPPER ? !comparator.key_less(records + res*N)
+                                  : comparator.record_less(records + res*N);
+        if (!before) {
+            break;
+        }
+    }
+    return res;
+}
+
+
+template <std::size_t N, bool UPPER>
+inline uint_fast32_t search(const uint64_t* records, uint_fast32_t count, const std::array<uint64_t, N>& key) {
+    const KeyComparator<N> comparator(key);
+    const uint64_t* base = records;
+    uint_fast32_t len = count;
+    // every record before `base` goes before the key, and the result is at most `base + len`
+    while (len > LINEAR_SEARCH_RECORDS) {
+        const auto half = len / 2;
+        const uint64_t* middle = base + half*N;
+        const bool before = UPPER ? !comparator.key_less(middle) : comparator.record_less(middle);
+        base = before ? middle : base;
+        len -= half;
+    }
+    return (base - records) / N + linear_count<N, UPPER>(base, len, key, comparator);
+}
+
+
+// position of the first record greater or equal than `key`, `count` if there is none
+template <std::size_t N>
+inline uint_fast32_t lower_bound(const uint64_t* records, uint_fast32_t count, const std::array<uint64_t, N>& key) {
+    return search<N, false>(records, count, key);
+}
+
+
+// position of the first record greater than `key`, `count` if there is none
+template <std::size_t N>
+inline uint_fast32_t upper_bound(const uint64_t* records, uint_fast32_t count, const std::array<uint64_t, N>& key) {
+    return search<N, true>(records, count, key);
+}
+
+} // namespace record_search
+
+#endif // STORAGE__RECORD_SEARCH_H_
@@ -5,7 +5,15 @@
 using namespace std;
 
 TupleBuffer::TupleBuffer(const vector<VarId>& enumeration_vars) :
-    file_id          (file_manager.get_tmp_file_id()),
+    TupleBuffer(file_manager.get_tmp_file_id(), enumeration_vars) { }
+
+
+TupleBuffer::TupleBuffer(const vector<VarId>& enumeration_vars, uint_fast32_t private_buffer_pos) :
+    TupleBuffer(file_manager.get_tmp_file_id(private_buffer_pos), enumeration_vars) { }
+
+
+TupleBuffer::TupleBuffer(TmpFileId file_id, const vector<VarId>& enumeration_vars) :
+    file_id          (file_id),
     enumeration_vars (enumeration_vars),
     tuple_size       (enumeration_vars.size()),
     max_tuples       (TupleBufferBlock::get_max_tuples(tuple_size))
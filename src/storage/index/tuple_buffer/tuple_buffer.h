@@ -12,6 +12,11 @@
 class TupleBuffer {
 public:
     TupleBuffer(const std::vector<VarId>& enumeration_vars);
+
+    // the temporary file uses the private buffer `private_buffer_pos` (see FileManager::reserve_private_buffer)
+    // instead of the one of the calling thread
+    TupleBuffer(const std::vector<VarId>& enumeration_vars, uint_fast32_t private_buffer_pos);
+
     ~TupleBuffer();
 
     inline uint_fast32_t get_tuple_count() const noexcept { return tuple_count; }
@@ -34,6 +39,7 @@ private:
     std::unique_ptr<TupleBufferBlock> current_block;
     std::unique_ptr<TupleBufferBlock> last_block;
 
+    TupleBuffer(TmpFileId file_id, const std::vector<VarId>& enumeration_vars);
 };
 
 #endif // STORAGE__TUPLE_BUFFER_H_
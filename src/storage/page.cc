@@ -9,22 +9,28 @@ Page::Page(PageId page_id, char* bytes) noexcept :
     page_id(page_id),
     pins(1),
     bytes(bytes),
-    dirty(false) { }
+    dirty(false),
+    ready(true),
+    usage(0) { }
 
 
 Page::Page() noexcept :
     page_id(FileId(FileId::UNASSIGNED), 0),
     pins(0),
     bytes(nullptr),
-    dirty(false) { }
+    dirty(false),
+    ready(true),
+    usage(0) { }
 
 
 void Page::operator=(const Page& other) noexcept {
     assert(pins == 0 && "Cannot reassign page if it is pinned");
     this->flush();
     this->page_id = other.page_id;
-    this->pins    = other.pins;
+    this->pins    = other.pins.load();
     this->dirty   = other.dirty;
+    this->ready   = other.ready;
+    this->usage   = other.usage.load();
     this->bytes   = other.bytes;
 }
 
@@ -34,7 +40,9 @@ void Page::reset() {
     this->page_id = PageId(FileId(FileId::UNASSIGNED), 0);
     this->pins    = 0;
     this->dirty   = false;
-    this->bytes   = nullptr;
+    this->ready   = true;
+    this->usage   = 0;
+    // bytes are not cleared, the shared buffer assigns them to each frame only once
 }
 
 
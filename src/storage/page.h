@@ -1,18 +1,29 @@
 /* Page represents the content of a disk block in memory.
  * A page is treated as an array of `MDB_PAGE_SIZE` bytes (pointed by `bytes`).
  * For better performance, `MDB_PAGE_SIZE` should be multiple of the operating system's page size.
+ * `MDB_PAGE_SIZE` is chosen when building (e.g. `cmake -DMDB_PAGE_SIZE=16384`), all the structures stored in pages
+ * (B+tree leaves and directories, hash buckets, tuple buffers, ordered files) take their layout from it. The
+ * page size of a database is saved in its catalog, so a database can only be opened by a build with the same size.
  * BufferManager is the only class who can construct a Page object. Other classes must get a Page
  * through BufferManager.
  */
 #ifndef STORAGE__PAGE_H_
 #define STORAGE__PAGE_H_
 
+#include <atomic>
+
 #include "storage/page_id.h"
 
+#ifndef MILLENNIUMDB_PAGE_SIZE
+#define MILLENNIUMDB_PAGE_SIZE 4096
+#endif
+
 class Page {
 friend class BufferManager; // needed to access private constructor
 public:
-    static constexpr auto MDB_PAGE_SIZE = 4096;
+    static constexpr auto MDB_PAGE_SIZE = MILLENNIUMDB_PAGE_SIZE;
+    static_assert(MDB_PAGE_SIZE == 4096 || MDB_PAGE_SIZE == 16384 || MDB_PAGE_SIZE == 65536,
+                  "MDB_PAGE_SIZE must be 4096, 16384 or 65536");
 
     // contains file_id and page_number of this page
     PageId page_id;
@@ -30,9 +41,13 @@ public:
     inline uint_fast32_t get_page_number() const noexcept { return page_id.page_number; };
 
 private:
-    uint_fast32_t pins;             // count of objects using this page, modified only by buffer_manager
-    char* bytes;                    // start memory address of the page, of size `MDB_PAGE_SIZE`
-    bool dirty;                     // true if data in memory is different from disk
+    std::atomic<uint_fast32_t> pins; // count of objects using this page, modified only by buffer_manager
+    char* bytes;                     // start memory address of the page, of size `MDB_PAGE_SIZE`
+    bool dirty;                      // true if data in memory is different from disk
+    bool ready;                      // false while the page is being read from disk (only used in shared buffer)
+
+    // recent uses of the page, used by the replacement policy of the shared buffer
+    std::atomic<uint_fast8_t> usage;
 
     Page() noexcept;
     Page(PageId page_id, char* bytes) noexcept;
@@ -15,11 +15,14 @@ using namespace std;
 TupleCollection::TupleCollection(Page&                            page,
                                  const map<VarId, uint_fast32_t>& saved_vars,
                                  const vector<VarId>&             order_vars,
-                                 const vector<bool>&              ascending) :
+                                 const vector<bool>&              ascending,
+                                 bool                             order_ids) :
     page        (page),
     saved_vars  (saved_vars),
     order_vars  (order_vars),
     ascending   (ascending),
+    order_ids   (order_ids),
+    tuple_size  (saved_vars.size() + (order_ids ? order_vars.size() : 0)),
     tuples      (reinterpret_cast<GraphObject*>(page.get_bytes())),
     tuple_count (reinterpret_cast<uint64_t*>(page.get_bytes() + Page::MDB_PAGE_SIZE - sizeof(uint64_t)))
     { }
@@ -33,8 +36,8 @@ TupleCollection::~TupleCollection() {
 
 void TupleCollection::add(std::vector<GraphObject> new_tuple) {
     // Add a new tuple in the last position of the page
-    const size_t bytes_used = (*tuple_count) * saved_vars.size();
-    for (size_t i = 0; i < saved_vars.size(); i++) {
+    const size_t bytes_used = (*tuple_count) * tuple_size;
+    for (size_t i = 0; i < tuple_size; i++) {
         tuples[bytes_used + i] = new_tuple[i];
     }
   	(*tuple_count)++;
@@ -43,9 +46,9 @@ void TupleCollection::add(std::vector<GraphObject> new_tuple) {
 
 std::vector<GraphObject> TupleCollection::get(uint64_t id) const {
     // Return the n-th tuple of the page
-    std::vector<GraphObject> res(saved_vars.size());
-    size_t tuple_position = id * saved_vars.size();
-    for (size_t i = 0; i < saved_vars.size(); i++) {
+    std::vector<GraphObject> res(tuple_size);
+    size_t tuple_position = id * tuple_size;
+    for (size_t i = 0; i < tuple_size; i++) {
         res[i] = tuples[tuple_position + i];
     }
     return res;
@@ -55,8 +58,8 @@ std::vector<GraphObject> TupleCollection::get(uint64_t id) const {
 void TupleCollection::override_tuple(const std::vector<GraphObject>& tuple, int position) {
     // Write a tuple in the specific position. tuple_count don't increase because
     // this method assume that is overriding a tuple
-    const auto position_to_override = position * saved_vars.size();
-    for (size_t i = 0; i < saved_vars.size(); i++) {
+    const auto position_to_override = position * tuple_size;
+    for (size_t i = 0; i < tuple_size; i++) {
         tuples[position_to_override + i] = tuple[i];
     }
 }
@@ -99,6 +102,19 @@ bool TupleCollection::has_priority(const std::vector<GraphObject>& lhs,
 {
     assert(order_vars.size() == ascending.size());
     for (size_t i = 0; i < order_vars.size(); i++) {
+        if (order_ids) {
+            const auto& left_id  = lhs[saved_vars.size() + i].value;
+            const auto& right_id = rhs[saved_vars.size() + i].value;
+            if (std::holds_alternative<int64_t>(left_id) && std::holds_alternative<int64_t>(right_id)) {
+                if (std::get<int64_t>(left_id) < std::get<int64_t>(right_id)) {
+                    return ascending[i];
+                } else if (std::get<int64_t>(right_id) < std::get<int64_t>(left_id)) {
+                    return !ascending[i];
+                }
+                continue;
+            }
+        }
+
         uint_fast32_t index;
         auto search = saved_vars.find(order_vars[i]);
         if (search != saved_vars.end()) {
@@ -148,11 +164,13 @@ int TupleCollection::partition(int i, int f) {
 MergeOrderedTupleCollection::MergeOrderedTupleCollection(const map<VarId, uint_fast32_t>& saved_vars,
                                                          const vector<VarId>&             order_vars,
                                                          const vector<bool>&              ascending,
-                                                         bool*                            interruption_requested) :
+                                                         bool*                            interruption_requested,
+                                                         bool                             order_ids) :
     saved_vars             (saved_vars),
     order_vars             (order_vars),
     ascending              (ascending),
-    interruption_requested (interruption_requested) { }
+    interruption_requested (interruption_requested),
+    order_ids              (order_ids) { }
 
 
 void MergeOrderedTupleCollection::merge(uint64_t left_start,
@@ -238,5 +256,5 @@ void MergeOrderedTupleCollection::copy_page(uint64_t source_page,
 
 
 std::unique_ptr<TupleCollection> MergeOrderedTupleCollection::get_run(Page& run_page) {
-    return make_unique<TupleCollection>(run_page, saved_vars, order_vars, ascending);
+    return make_unique<TupleCollection>(run_page, saved_vars, order_vars, ascending, order_ids);
 }
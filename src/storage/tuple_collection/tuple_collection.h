@@ -4,6 +4,10 @@
 
 // TupleCollection asumes that all the arrays of GraphObject have the same size
 
+// When `order_ids` is set each tuple has, after the objects of the saved vars, one object for each order var
+// with its id as an int64_t, or null. When the ids of two tuples are not null they are compared instead of
+// the objects, so they must have the same order as the objects (see GraphModel::is_ordered_id)
+
 
 #ifndef STORAGE__TUPLE_COLLECTION_H_
 #define STORAGE__TUPLE_COLLECTION_H_
@@ -25,11 +29,12 @@ public:
     TupleCollection(Page& page,
                     const std::map<VarId, uint_fast32_t>& saved_vars,
                     const std::vector<VarId>& order_vars,
-                    const std::vector<bool>& ascending);
+                    const std::vector<bool>& ascending,
+                    bool order_ids = false);
     ~TupleCollection();
 
     bool is_full() const {
-        return sizeof(tuple_count) + (sizeof(GraphObject)*saved_vars.size()*(1 + *tuple_count)) > Page::MDB_PAGE_SIZE;
+        return sizeof(tuple_count) + (sizeof(GraphObject)*tuple_size*(1 + *tuple_count)) > Page::MDB_PAGE_SIZE;
     }
 
     inline uint64_t get_tuple_count() const noexcept { return *tuple_count; }
@@ -48,6 +53,8 @@ private:
     const std::map<VarId, uint_fast32_t>& saved_vars;
     const std::vector<VarId>& order_vars;
     const std::vector<bool>& ascending;
+    const bool order_ids;
+    const uint_fast32_t tuple_size;
     GraphObject* const tuples;
     uint64_t* const tuple_count;
 
@@ -65,7 +72,8 @@ public:
     MergeOrderedTupleCollection(const std::map<VarId, uint_fast32_t>& saved_vars,
                                 const std::vector<VarId>&             order_vars,
                                 const std::vector<bool>&              ascending,
-                                bool*                                 interruption_requested);
+                                bool*                                 interruption_requested,
+                                bool                                  order_ids = false);
 
     void merge(uint64_t  left_start,
                uint64_t  left_end,
@@ -83,6 +91,7 @@ private:
     const std::vector<VarId>&             order_vars;
     const std::vector<bool>&              ascending;
     bool const *                          interruption_requested;
+    const bool                            order_ids;
 
     std::unique_ptr<TupleCollection> get_run(Page& run_page);
 };
@@ -0,0 +1,153 @@
+/*
+ * bench_buffer_pool measures the throughput of queries with the pages already in the shared buffer, to compare
+ * the memory options of the buffer (huge pages and NUMA policy) and the directory cache of the B+trees. Each
+ * query is executed once to load its pages and then it's executed `--repetitions` times, printing the execution
+ * plan of the first run and the results per second of the repetitions.
+ *
+ * A query with one pattern (executed with an IndexScan) and a query joining many patterns (executed with
+ * a LeapfrogJoin) show the effect on both kinds of access, e.g:
+ *   bench_buffer_pool DB_FOLDER scan.txt join.txt --huge-pages none
+ *   bench_buffer_pool DB_FOLDER scan.txt join.txt --huge-pages transparent --numa interleave
+ *   bench_buffer_pool DB_FOLDER scan.txt join.txt --dir-cache-levels 4
+ */
+
+#include <chrono>
+#include <experimental/filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include <boost/program_options.hpp>
+
+#include "base/parser/query_parser.h"
+#include "base/thread/thread_info.h"
+#include "relational_model/models/quad_model/quad_model.h"
+#include "storage/buffer_manager.h"
+
+using namespace std;
+namespace po = boost::program_options;
+
+uint64_t execute(QuadModel& model, string& query, bool print_plan) {
+    ThreadInfo thread_info(chrono::system_clock::now() + chrono::hours(24));
+    auto logical_plan  = QueryParser::get_query_plan(query);
+    auto physical_plan = model.exec(*logical_plan, &thread_info);
+
+    uint64_t result_count = 0;
+    physical_plan->begin();
+    while (physical_plan->next()) {
+        result_count++;
+    }
+    if (print_plan) {
+        physical_plan->analyze(cout, 2);
+    }
+    return result_count;
+}
+
+
+int main(int argc, char **argv) {
+    string db_folder;
+    vector<string> query_files;
+    int buffer_size;
+    int repetitions;
+    int numa_node;
+    int dir_cache_levels;
+    string huge_pages;
+    string numa_policy;
+
+    // Parse arguments
+    po::options_description desc("Allowed options");
+    desc.add_options()
+        ("help,h", "show this help message")
+        ("db-folder,d", po::value<string>(&db_folder)->required(), "set database folder path")
+        ("query-file,q", po::value<vector<string>>(&query_files)->required(), "query file, can be repeated")
+        ("buffer-size,b", po::value<int>(&buffer_size)->default_value(BufferManager::DEFAULT_SHARED_BUFFER_POOL_SIZE),
+                "set shared buffer pool size")
+        ("repetitions,r", po::value<int>(&repetitions)->default_value(10), "times each query is executed")
+        ("huge-pages,", po::value<string>(&huge_pages)->default_value("none"), "none, transparent, 2mb or 1gb")
+        ("numa,", po::value<string>(&numa_policy)->default_value("none"), "none, interleave or bind")
+        ("numa-node,", po::value<int>(&numa_node)->default_value(0), "set the NUMA node used by --numa bind")
+        ("dir-cache-levels,", po::value<int>(&dir_cache_levels)->default_value(0),
+                "levels of the B+tree directories kept in memory")
+    ;
+
+    po::positional_options_description p;
+    p.add("db-folder", 1);
+    p.add("query-file", -1);
+
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).positional(p).run(), vm);
+
+    if (vm.count("help")) {
+        cout << "Usage: bench_buffer_pool ./path/to/db-folder QUERY_FILE... [OPTIONS]\n";
+        cout << desc << "\n";
+        return 0;
+    }
+    po::notify(vm);
+
+    if (buffer_size <= 0 || repetitions <= 0 || dir_cache_levels < 0) {
+        cerr << "Buffer size and repetitions must be positive numbers, directory cache levels can't be negative.\n";
+        return 1;
+    }
+
+    { // check if db_folder is empty or does not exists
+        namespace fs = std::experimental::filesystem;
+        if (!fs::exists(db_folder) ) {
+            cerr << "Database folder doesn't exists.\n";
+            return 1;
+        } else if (fs::is_empty(db_folder)) {
+            cerr << "Database folder is empty.\n";
+            return 1;
+        }
+    }
+
+    try {
+        BufferMemoryOptions memory_options;
+        memory_options.huge_pages  = BufferMemoryOptions::parse_huge_pages(huge_pages);
+        memory_options.numa_policy = BufferMemoryOptions::parse_numa_policy(numa_policy);
+        memory_options.numa_node   = numa_node;
+
+        QuadModel model(db_folder, buffer_size, BufferManager::DEFAULT_PRIVATE_BUFFER_POOL_SIZE, 1, false,
+                        memory_options);
+
+        auto cached_pages = model.cache_directories(dir_cache_levels);
+
+        cout << "huge pages: " << huge_pages << ", numa: " << numa_policy
+             << ", directory pages cached: " << cached_pages << "\n";
+        for (const auto& query_file : query_files) {
+            ifstream file(query_file);
+            if (file.fail()) {
+                cerr << "Could not open " << query_file << "\n";
+                return 1;
+            }
+            stringstream query_stream;
+            query_stream << file.rdbuf();
+            string query = query_stream.str();
+
+            cout << "---------------------------------------\n";
+            cout << query_file << ":\n";
+            // first execution reads the pages from disk
+            auto result_count = execute(model, query, true);
+
+            auto stats_before = buffer_manager.get_stats();
+            auto start = chrono::steady_clock::now();
+            for (int i = 0; i < repetitions; i++) {
+                execute(model, query, false);
+            }
+            chrono::duration<double> duration = chrono::steady_clock::now() - start;
+            auto stats = buffer_manager.get_stats() - stats_before;
+
+            uint64_t misses = 0;
+            for (const auto& file_counters : stats.files) {
+                misses += file_counters[MISSES];
+            }
+            cout << "  results: " << result_count << "\n";
+            cout << "  average time: " << duration.count() * 1000 / repetitions << " ms\n";
+            cout << "  results per second: " << result_count * repetitions / duration.count() << "\n";
+            cout << "  buffer misses: " << misses << "\n";
+        }
+    } catch (exception& e) {
+        cerr << "Exception: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
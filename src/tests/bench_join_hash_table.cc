@@ -0,0 +1,153 @@
+/*
+ * bench_join_hash_table compares JoinHashTable with the std::unordered_multimap of vectors that
+ * HashJoinInMemory used before, with random rows where many keys are repeated and with keys of 1 to 5 ids.
+ * It checks both find the same values for every probe (also when JoinHashTable is built by many threads)
+ * and prints the nanoseconds per row of the build, per probe and the bytes used by JoinHashTable.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "relational_model/execution/binding_id_iter/hash_join/join_hash_table.h"
+#include "relational_model/execution/binding_id_iter/hash_join/key_value_pair_hasher.h"
+
+using namespace std;
+
+using MultiMap = unordered_multimap<vector<ObjectId>, vector<ObjectId>, KeyValuePairHasher>;
+
+constexpr uint_fast32_t ROWS       = 1'000'000;
+constexpr uint_fast32_t PROBES     = 2'000'000;
+constexpr uint_fast32_t VALUE_SIZE = 2;
+
+// values of `key` in the multimap, sorted
+vector<ObjectId> multimap_values(const MultiMap& map, const vector<ObjectId>& key) {
+    vector<ObjectId> res;
+    auto range = map.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it) {
+        res.insert(res.end(), it->second.begin(), it->second.end());
+    }
+    sort(res.begin(), res.end());
+    return res;
+}
+
+
+// values of `key` in the table, sorted
+vector<ObjectId> table_values(const JoinHashTable& table, const vector<ObjectId>& key) {
+    auto match = table.find(key.data());
+    vector<ObjectId> res(match.values, match.values + match.count * table.get_value_size());
+    sort(res.begin(), res.end());
+    return res;
+}
+
+
+bool bench(uint_fast32_t key_size) {
+    mt19937_64 gen(key_size);
+    // each key is repeated 4 times on average, the first ids of a key have few values as the ids of the nodes
+    // of a graph with many edges per node
+    auto random_key = [&]() {
+        vector<ObjectId> key(key_size);
+        for (uint_fast32_t i = 0; i < key_size; i++) {
+            key[i] = ObjectId(i + 1 < key_size ? gen() % 64 : gen() % (ROWS / 4));
+        }
+        return key;
+    };
+
+    vector<vector<ObjectId>> keys;
+    vector<vector<ObjectId>> values;
+    for (uint_fast32_t i = 0; i < ROWS; i++) {
+        keys.push_back(random_key());
+        vector<ObjectId> value(VALUE_SIZE);
+        for (auto& id : value) {
+            id = ObjectId(gen());
+        }
+        values.push_back(move(value));
+    }
+
+    // half of the probes are keys of the rows
+    vector<vector<ObjectId>> probes;
+    for (uint_fast32_t i = 0; i < PROBES; i++) {
+        probes.push_back(i % 2 == 0 ? keys[gen() % ROWS] : random_key());
+    }
+
+    auto start = chrono::steady_clock::now();
+    MultiMap map;
+    for (uint_fast32_t i = 0; i < ROWS; i++) {
+        map.insert({ keys[i], values[i] });
+    }
+    chrono::duration<double, nano> map_build_time = chrono::steady_clock::now() - start;
+
+    uint64_t map_matches = 0;
+    start = chrono::steady_clock::now();
+    for (const auto& probe : probes) {
+        auto range = map.equal_range(probe);
+        for (auto it = range.first; it != range.second; ++it) {
+            map_matches += it->second[0].id;
+        }
+    }
+    chrono::duration<double, nano> map_probe_time = chrono::steady_clock::now() - start;
+
+    bool same_results = true;
+    chrono::duration<double, nano> table_build_time(0);
+    chrono::duration<double, nano> table_probe_time(0);
+    uint64_t table_bytes = 0;
+
+    // the second time it is built with 4 threads
+    for (uint_fast32_t threads : { 1, 4 }) {
+        JoinHashTable table(key_size, VALUE_SIZE);
+        start = chrono::steady_clock::now();
+        for (uint_fast32_t i = 0; i < ROWS; i++) {
+            auto row = table.new_row();
+            copy(keys[i].begin(), keys[i].end(), row);
+            copy(values[i].begin(), values[i].end(), row + key_size);
+        }
+        table.build(threads);
+        if (threads == 1) {
+            table_build_time = chrono::steady_clock::now() - start;
+            table_bytes = table.get_bytes();
+        }
+
+        uint64_t table_matches = 0;
+        start = chrono::steady_clock::now();
+        for (const auto& probe : probes) {
+            auto match = table.find(probe.data());
+            for (uint_fast32_t r = 0; r < match.count; r++) {
+                table_matches += match.values[r * VALUE_SIZE].id;
+            }
+        }
+        if (threads == 1) {
+            table_probe_time = chrono::steady_clock::now() - start;
+        }
+
+        if (table_matches != map_matches || table.size() != ROWS) {
+            same_results = false;
+        }
+        for (uint_fast32_t i = 0; i < 10'000; i++) {
+            if (multimap_values(map, probes[i]) != table_values(table, probes[i])) {
+                same_results = false;
+            }
+        }
+    }
+
+    cout << "key size " << key_size << ": "
+         << "unordered_multimap build " << map_build_time.count() / ROWS << " ns, "
+         << "probe " << map_probe_time.count() / PROBES << " ns; "
+         << "JoinHashTable build " << table_build_time.count() / ROWS << " ns, "
+         << "probe " << table_probe_time.count() / PROBES << " ns, "
+         << table_bytes / ROWS << " bytes per row"
+         << (same_results ? "" : "  ERROR: different results") << "\n";
+    return same_results;
+}
+
+
+int main() {
+    bool ok = true;
+    // 5 uses the table that isn't specialized by the key size
+    for (uint_fast32_t key_size = 1; key_size <= JoinHashTable::MAX_FIXED_KEY_SIZE + 1; key_size++) {
+        ok = bench(key_size) && ok;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,171 @@
+/*
+ * bench_record_search compares the search functions of record_search.h with the scalar binary searches that
+ * BPlusTreeLeaf::search_index and BPlusTreeDir::search_child_index used before, over arrays of random
+ * records with the sizes of leaves and directories. It checks both give the same results and prints the
+ * nanoseconds per search.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "storage/index/bplus_tree/bplus_tree.h"
+#include "storage/index/record_search.h"
+
+using namespace std;
+
+// previous BPlusTreeLeaf::search_index
+template <std::size_t N>
+uint_fast32_t scalar_lower_bound(const uint64_t* records, uint_fast32_t count, const array<uint64_t, N>& key) {
+    int from = 0;
+    int to = count-1;
+search_index_begin:
+    if (from < to) {
+        auto middle = (from + to) / 2;
+
+        for (uint_fast32_t i = 0; i < N; i++) {
+            auto id = records[middle*N + i];
+            if (key[i] < id) {
+                to = middle - 1;
+                goto search_index_begin;
+            } else if (key[i] > id) {
+                from = middle + 1;
+                goto search_index_begin;
+            }
+        }
+        return middle;
+    }
+    for (uint_fast32_t i = 0; i < N; ++i) {
+        auto id = records[from*N + i];
+        if (key[i] < id) {
+            return from;
+        } else if (key[i] > id) {
+            return from + 1;
+        }
+    }
+    return from;
+}
+
+
+// previous BPlusTreeDir::search_child_index
+template <std::size_t N>
+uint_fast32_t scalar_upper_bound(const uint64_t* keys, int dir_from, int dir_to, const array<uint64_t, N>& key) {
+search_child_index_begin:
+    if (dir_from == dir_to) {
+        return dir_from;
+    }
+    int middle_dir = (dir_from + dir_to + 1) / 2;
+    int middle_record = middle_dir-1;
+
+    for (uint_fast32_t i = 0; i < N; i++) {
+        auto id = keys[middle_record*N + i];
+        if (key[i] < id) {
+            dir_to = middle_record;
+            goto search_child_index_begin;
+        } else if (key[i] > id) {
+            dir_from = middle_record+1;
+            goto search_child_index_begin;
+        }
+    }
+    dir_from = middle_record+1;
+    goto search_child_index_begin;
+}
+
+
+template <std::size_t N>
+bool bench(const string& name, uint_fast32_t count, bool upper) {
+    constexpr uint_fast32_t SEARCHES = 2'000'000;
+    mt19937_64 gen(count * N);
+
+    // leading columns have few values, so consecutive records share prefixes as in the B+trees
+    vector<array<uint64_t, N>> sorted;
+    while (sorted.size() < count) {
+        array<uint64_t, N> record;
+        for (uint_fast32_t i = 0; i < N; i++) {
+            record[i] = i + 1 < N ? gen() % 16 : gen();
+        }
+        sorted.push_back(record);
+    }
+    sort(sorted.begin(), sorted.end());
+    sorted.erase(unique(sorted.begin(), sorted.end()), sorted.end());
+    count = sorted.size();
+
+    vector<uint64_t> records;
+    for (const auto& record : sorted) {
+        records.insert(records.end(), record.begin(), record.end());
+    }
+
+    // half of the keys are in the array
+    vector<array<uint64_t, N>> keys;
+    for (uint_fast32_t i = 0; i < SEARCHES; i++) {
+        if (i % 2 == 0) {
+            keys.push_back(sorted[gen() % count]);
+        } else {
+            array<uint64_t, N> key;
+            for (uint_fast32_t c = 0; c < N; c++) {
+                key[c] = c + 1 < N ? gen() % 16 : gen();
+            }
+            keys.push_back(key);
+        }
+    }
+
+    uint64_t scalar_sum = 0;
+    auto start = chrono::steady_clock::now();
+    for (const auto& key : keys) {
+        scalar_sum += upper ? scalar_upper_bound<N>(records.data(), 0, count, key)
+                            : scalar_lower_bound<N>(records.data(), count, key);
+    }
+    chrono::duration<double, nano> scalar_time = chrono::steady_clock::now() - start;
+
+    uint64_t simd_sum = 0;
+    start = chrono::steady_clock::now();
+    for (const auto& key : keys) {
+        simd_sum += upper ? record_search::upper_bound<N>(records.data(), count, key)
+                          : record_search::lower_bound<N>(records.data(), count, key);
+    }
+    chrono::duration<double, nano> simd_time = chrono::steady_clock::now() - start;
+
+    bool same_results = true;
+    for (uint_fast32_t i = 0; i < 10'000; i++) {
+        const auto& key = keys[i];
+        auto expected = upper ? scalar_upper_bound<N>(records.data(), 0, count, key)
+                              : scalar_lower_bound<N>(records.data(), count, key);
+        auto res = upper ? record_search::upper_bound<N>(records.data(), count, key)
+                         : record_search::lower_bound<N>(records.data(), count, key);
+        if (expected != res) {
+            same_results = false;
+        }
+    }
+
+    cout << "N=" << N << " " << name << " (" << count << " records): "
+         << "scalar " << scalar_time.count() / SEARCHES << " ns, "
+         << "record_search " << simd_time.count() / SEARCHES << " ns"
+         << (same_results && scalar_sum == simd_sum ? "" : "  ERROR: different results") << "\n";
+    return same_results && scalar_sum == simd_sum;
+}
+
+
+template <std::size_t N>
+bool bench_all() {
+    bool ok = bench<N>("leaf lower bound", BPlusTree<N>::leaf_max_records, false);
+    ok = bench<N>("dir upper bound", BPlusTree<N>::dir_max_records, true) && ok;
+    return ok;
+}
+
+
+int main() {
+#if defined(__AVX2__)
+    cout << "record_search compiled with AVX2\n";
+#elif defined(__SSE4_2__)
+    cout << "record_search compiled with SSE4.2\n";
+#else
+    cout << "record_search compiled without SIMD\n";
+#endif
+    bool ok = bench_all<1>();
+    ok = bench_all<2>() && ok;
+    ok = bench_all<3>() && ok;
+    ok = bench_all<4>() && ok;
+    return ok ? 0 : 1;
+}